@@ -0,0 +1,47 @@
+/* This program is part of the math interpreter, it is a arena (bump) allocator used by the lexer, the parser and the evaluator.
+   All the memory of one evaluation is taken from the arena and released at once by Arena_reset, which is O(1). */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct{
+
+  char *data;           // Main block, where the allocations are made
+  size_t used;          // Number of bytes already used in the main block
+  size_t cap;           // Size of the main block
+  size_t last;          // Offset of the last allocation (so it can grow in place)
+  size_t start;         // Offset of the first aligned byte of the main block
+  bool owns_data;       // False when the main block was given by the user (Arena_init with a buffer)
+  ArenaBlock *overflow; // Blocks allocated when the main block was full, merged into the main block in Arena_reset
+  size_t overflow_size; // Total of bytes of the overflow blocks
+} Arena;
+
+/* Function to create and initialize the arena
+   It receives a reference to the arena and a optional buffer (can be NULL) with its size, that will be used as the first block */
+void Arena_init(Arena *arena, void *buffer, size_t size);
+
+/* Function to free all the memory of the arena
+   It receives a reference to the arena */
+void Arena_free(Arena *arena);
+
+/* Function to allocate memory from the arena, aligned to 16 bytes
+   It returns a pointer to the memory or NULL if the allocation failed
+   It receives a reference to the arena and the number of bytes */
+void *Arena_alloc(Arena *arena, size_t size);
+
+/* Function to grow a area of the arena, it grows in place when the area was the last allocation
+   It returns a pointer to the new area (with the old content) or NULL if the allocation failed
+   It receives a reference to the arena, the old area (can be NULL), its old size and the new size */
+void *Arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size);
+
+/* Function to release all the allocations at once, the memory stays in the arena to be reused
+   If the main block was not enough, it is replaced by one big enough, so the next evaluations do not call malloc
+   It receives a reference to the arena */
+void Arena_reset(Arena *arena);
+
+#endif
@@ -0,0 +1,83 @@
+/* This program is part of the math interpreter, it implements decimal numbers with arbitrary precision (big numbers)
+   and a evaluator of the bytecode that uses them instead of doubles. */
+
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bytecode.h"
+
+#define BIGNUM_TEXT_SIZE(digits) ((size_t) (digits) + 32) // Chars needed by Bignum_to_text, including the NULL terminator
+
+typedef enum{
+
+  BIGNUM_FINITE,   // Number stored in the limbs
+  BIGNUM_NAN,      // Not a number, like the result of sqrt(-2)
+  BIGNUM_INFINITE  // Infinity (with sign), like the result of a operation with a infinite operand
+} BignumKind;
+
+typedef struct{
+
+  BignumKind kind;    // What the number is
+  int sign;           // 1 or -1 (only meaningful when the number is not 0)
+  long exponent;      // Exponent of the first limb, value = sign * sum of limbs[i] * 10^(9*(exponent+i))
+  unsigned int size;  // Number of limbs (0 means that the number is 0)
+  uint32_t *limbs;    // Limbs in base 10^9, the least significant first, the first and the last are never 0
+} BigNum;
+
+/* Function to tell how many limbs are needed to keep a number of significant digits (with some digits more as guard)
+   It returns the precision used by the other functions, and receives the number of digits */
+unsigned int Bignum_precision(unsigned int digits);
+
+/* Function to initialize a big number with the value 0
+   It receives a reference to the big number */
+void Bignum_init(BigNum *num);
+
+/* Function to free the memory of a big number, it is 0 after it
+   It receives a reference to the big number */
+void Bignum_free(BigNum *num);
+
+/* Function to convert the text of a number (see number.h) into a big number, decimal numbers are converted exactly
+   (rounded to the precision), hex numbers go through their double value
+   It returns false if memory allocation failed
+   It receives the first char, the number of chars, the big number to write and the precision (see Bignum_precision) */
+bool Bignum_from_text(const char *text, size_t length, BigNum *num, unsigned int precision);
+
+/* Function to convert a double into a big number, the conversion is exact unless it needs more than the precision
+   It returns false if memory allocation failed
+   It receives the double, the big number to write and the precision (see Bignum_precision) */
+bool Bignum_from_double(double value, BigNum *num, unsigned int precision);
+
+/* Function to convert a big number into the nearest double (approximately, the error may be of some units in the last place)
+   It returns the double and receives a reference to the big number */
+double Bignum_to_double(const BigNum *num);
+
+/* Function to write a big number rounded to a number of significant digits, without the trailing zeros
+   Numbers with exponent from -6 to digits-1 are written without exponent (like 0.001 or 123.25), the others in scientific notation (like 1e+100)
+   It returns the number of chars written (without the NULL terminator), or 0 if memory allocation failed
+   It receives the big number, the number of digits and the array where the text is written (at least BIGNUM_TEXT_SIZE(digits) chars) */
+size_t Bignum_to_text(const BigNum *num, unsigned int digits, char *buffer);
+
+/* Functions of the arithmetic operations on finite big numbers (results that are not finite are NAN, like x/0, x%0 and the square root
+   of a negative number, the same as the double evaluation)
+   The result is rounded to the precision, and it can be one of the operands
+   They return false if memory allocation failed
+   They receive the operands, the big number where the result is written and the precision (see Bignum_precision) */
+bool Bignum_add(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision);
+bool Bignum_sub(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision);
+bool Bignum_mul(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision);
+bool Bignum_div(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision);
+bool Bignum_mod(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision);
+bool Bignum_pow(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision);
+bool Bignum_sqrt(const BigNum *a, BigNum *out, unsigned int precision);
+
+/* Function to evaluate the bytecode with big numbers, the result of each operation is rounded to the precision
+   The bytecode must not be optimized (the optimizer folds constants as doubles) and must not have variables
+   It returns false if the bytecode has variables or memory allocation failed
+   It receives a reference to the bytecode, its constant pool as big numbers, the precision (see Bignum_precision) and the big number where the result is written */
+bool Bignum_evaluate(const Bytecode *bytecode, const BigNum *constants, unsigned int precision, BigNum *result);
+
+#endif
@@ -0,0 +1,101 @@
+/* This program is part of the math interpreter, it lowers an expression in RPN into a compact bytecode (opcodes + constant pool)
+   and implements the interpreter loop that evaluates it. */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "token.h"
+#include "arena.h"
+
+typedef enum{
+
+  OP_CONST, // Push the constant of the pool at index arg
+  OP_VAR,   // Push the value of the variable at index arg
+  OP_DUP,   // Push a copy of the value of the top of the stack
+  OP_NEG,   // Unary minus
+  OP_SQRT,  // Square root
+  OP_ADD,   // +
+  OP_SUB,   // -
+  OP_MUL,   // *
+  OP_DIV,   // /
+  OP_MOD,   // %
+  OP_POW    // ^
+} Opcode;
+
+typedef struct{
+
+  Opcode op;        // Operation to execute
+  unsigned int arg; // Operand of the operation (index in the constant pool for OP_CONST, index of the variable for OP_VAR)
+} Instruction;
+
+typedef struct{
+
+  Instruction *code;          // Array of instructions
+  unsigned int size;          // Number of instructions
+  double *constants;          // Constant pool, numbers already converted to double
+  unsigned int constant_count; // Number of constants in the pool
+  char **variables;           // Names of the variables, in the order of their indexes
+  unsigned int variable_count; // Number of different variables
+  unsigned int max_depth;     // Maximum number of values in the stack during the evaluation
+  Arena *arena;               // Arena where the memory comes from (NULL if it was allocated with malloc)
+} Bytecode;
+
+/* Constant value of the optimizer, the exact integer is kept next to the double so integer operations are exact beyond 2^53 */
+typedef struct{
+
+  double value;    // The value
+  bool is_integer; // True if the value is a integer that fits in 64 bits
+  int64_t integer; // The exact integer, if it is one (it can be beyond 2^53, where the double is rounded)
+} BytecodeConstant;
+
+/* Function to return the opcode of an operator or function token
+   It returns true if the token is known
+   It receives the kind of the token and a reference to where the opcode is written */
+bool Bytecode_opcode_of(TokenKind tok, Opcode *op);
+
+/* Function to make the constant of a number
+   It returns the constant and receives the number */
+BytecodeConstant Bytecode_constant(double value);
+
+/* Function to execute one operation over constants like the constant folding of Bytecode_optimize
+   (so a expression that only has constants has the same result as its compiled bytecode)
+   It returns the result and receives the opcode and the operands (b is ignored by unary operations) */
+BytecodeConstant Bytecode_fold_constant(Opcode op, BytecodeConstant a, BytecodeConstant b);
+
+/* Function to convert a TOK_END terminated array of tokens in RPN into bytecode
+   It returns true if the conversion succeeded (false if there is a unknown token or memory allocation failed)
+   It receives a TOK_END terminated array in RPN, the expression the tokens came from (needed for the names of the variables, can be NULL if there is no variable),
+   a reference to the bytecode to fill and the arena to allocate from (NULL to use malloc) */
+bool Bytecode_from_rpn(const Token *rpn, const char *expression, Bytecode *bytecode, Arena *arena);
+
+/* Function to optimize the bytecode (constant folding, identities like x*1 and strength reduction like x^3 -> x*x*x)
+   It returns true if the optimization succeeded (false if memory allocation failed, the bytecode is not changed)
+   It receives a reference to the bytecode */
+bool Bytecode_optimize(Bytecode *bytecode);
+
+/* Function to return the index of a variable in the bytecode
+   It returns the index or -1 if the bytecode does not use the variable
+   It receives a reference to the bytecode and the name of the variable */
+int Bytecode_variable_index(const Bytecode *bytecode, const char *name);
+
+/* Function to evaluate the bytecode
+   It returns the result of the expression in double format
+   It receives a reference to the bytecode, the values of the variables (by index, can be NULL if there is no variable)
+   and the arena used for the stack of values (NULL to use malloc) */
+double Bytecode_evaluate(const Bytecode *bytecode, const double *variables, Arena *arena);
+
+/* Function to evaluate the bytecode for many rows at once, each operation is executed for a whole block of rows before the next one
+   It returns true if the evaluation succeeded (false if memory allocation failed)
+   It receives a reference to the bytecode, one column of values per variable (by index), the number of rows,
+   the array where the results are written (one per row) and the arena used for the stack of blocks (NULL to use malloc) */
+bool Bytecode_evaluate_batch(const Bytecode *bytecode, const double *const *columns, size_t rows, double *out, Arena *arena);
+
+/* Function to free the memory of the bytecode (memory of a arena is only released by Arena_reset)
+   It receives a reference to the bytecode */
+void Bytecode_free(Bytecode *bytecode);
+
+#endif
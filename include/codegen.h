@@ -0,0 +1,32 @@
+/* This program is part of the math interpreter, it writes the bytecode of expressions as standalone C functions,
+   that can be compiled ahead of time (for example into a shared library loaded with dlopen, see mathc.c).
+   The generated code only depends on math.h and has the same results as the bytecode interpreter. */
+
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "bytecode.h"
+
+/* Function to tell if a text can be the name of a generated function (a C identifier that is not reserved: C keywords,
+   names of math.h and stddef.h, main, names starting with "math_" and the local variables of the generated code)
+   It returns true if it can, and receives the text */
+bool Codegen_is_name(const char *name);
+
+/* Function to write the start of a C file of generated functions: the includes and the helper functions with the semantics of the interpreter
+   (division and mod by 0 and the square root of negative numbers are NAN, integer powers use a squaring loop)
+   It returns false if the writing failed, and receives the stream */
+bool Codegen_write_prelude(FILE *stream);
+
+/* Function to write the C functions of a expression (after Codegen_write_prelude), for a name like f they are:
+   - const char *const f_variables[]: names of the variables in the order of their indexes, terminated by NULL
+   - double f(const double *variables): value of the expression, with the values of the variables by index
+   - void f_batch(const double *const *columns, size_t rows, double *out): out[i] = f of the row i of one column per variable
+   It returns false if the bytecode is empty (the expression has no tokens), the name is not valid or the writing failed
+   It receives the stream, the optimized bytecode of the expression, the name of the functions (see Codegen_is_name)
+   and the text of the expression, that is written as a comment (can be NULL) */
+bool Codegen_write_function(FILE *stream, const Bytecode *bytecode, const char *name, const char *expression);
+
+#endif
@@ -3,20 +3,27 @@
 
 #include <stdbool.h>
 
+#include "token.h"
+#include "arena.h"
+
+#define STACK_INLINE_SIZE 32 // Number of elements stored inside the stack itself, the memory is only allocated when a stack has more
+
 // ------------------------------------------------ Tokens Stack ------------------------------------------------
                                                   
 typedef struct{
   
-  char **data; // Pointer to the tokens array
+  Token *data; // Pointer to the tokens array (inline_data until it is full)
   unsigned int size; // Current number of tokens stored
   unsigned int cap; // Numbers of tokens that can be stored without realloc
+  Arena *arena; // Arena where the memory comes from (NULL to use malloc)
+  Token inline_data[STACK_INLINE_SIZE]; // First tokens, so small stacks do not allocate memory
 } TokenStack;
   
-/* Function to create and initialize the stack
-   It receives a reference to the stack */
-void Stack_init(TokenStack *stack);
+/* Function to create and initialize the stack (the stack points to itself, so it can not be copied after this)
+   It receives a reference to the stack and the arena to allocate from (NULL to use malloc) */
+void Stack_init(TokenStack *stack, Arena *arena);
 
-/* Function to free the stack
+/* Function to free the stack (memory of a arena is only released by Arena_reset)
    It receives a reference to the stack to free */
 void Stack_free(TokenStack *stack);
 
@@ -27,32 +34,34 @@ bool Stack_is_empty(TokenStack *stack);
 
 /* Function to insert an element in the top of the stack, do the realloc if necessary
    It receives a reference to the stack and the token to push */
-void Stack_push(TokenStack *stack, char *tok);
+void Stack_push(TokenStack *stack, Token tok);
 
 /* Function to remove the element of the top of the stack
-   It returns the token popped
+   It returns the token popped, or a TOK_END token if empty
    It receives a reference to the stack */
-char *Stack_pop(TokenStack *stack);
+Token Stack_pop(TokenStack *stack);
    
 /* Function to return the value of the element of the top of the stack 
-   It returns the token
+   It returns a reference to the token, or NULL if empty
    It receives a reference to the stack */
-char *Stack_peek(TokenStack *stack);
+Token *Stack_peek(TokenStack *stack);
 
 // ------------------------------------------------ Token Queue ------------------------------------------------
 
 typedef struct{
   
-  char **data; // Pointer to the tokens array
+  Token *data; // Pointer to the tokens array, used as a circular buffer
+  unsigned int head; // Index of the front of the queue
   unsigned int size; // Current number of tokens stored
-  unsigned int cap; // Numbers of tokens that can be stored without realloc
+  unsigned int cap; // Numbers of tokens that can be stored without realloc (a power of 2)
+  Arena *arena; // Arena where the memory comes from (NULL to use malloc)
 } TokenQueue;
   
 /* Function to create and initialize the queue
-   It receives a reference to the queue */
-void Queue_init(TokenQueue *queue);
+   It receives a reference to the queue and the arena to allocate from (NULL to use malloc) */
+void Queue_init(TokenQueue *queue, Arena *arena);
 
-/* Function to free the queue
+/* Function to free the queue (memory of a arena is only released by Arena_reset)
    It receives a reference to the queue to free */
 void Queue_free(TokenQueue *queue);
 
@@ -63,35 +72,43 @@ bool Queue_is_empty(TokenQueue *queue);
 
 /* Function to insert an element at the end of the queue, do the realloc if necessary
    It receives a reference to the queue and the token to push */
-void Queue_enqueue(TokenQueue *queue, char *tok);
+void Queue_enqueue(TokenQueue *queue, Token tok);
 
-/* Function to remove the element of the front of the queue and move the others
-   It returns the token dequeued
+/* Function to remove the element of the front of the queue, the queue is a circular buffer so nothing is moved
+   It returns the token dequeued, or a TOK_END token if empty
    It receives a reference to the queue */
-char *Queue_dequeue(TokenQueue *queue);
+Token Queue_dequeue(TokenQueue *queue);
    
-/* Function to convert the current content into a NULL-terminated array (Required to the function that will evaluate the RPN)
-   It returns a new malloc
+/* Function to convert the current content into a TOK_END terminated array (Required to the function that will evaluate the RPN)
+   The array of the queue is given to the caller without copying the tokens, so the queue is empty after it
+   It returns the array, that must be released with free (if the queue has no arena)
    It receives a reference to the queue */
-char **Queue_to_array(TokenQueue *queue);
+Token *Queue_to_array(TokenQueue *queue);
 
 // ------------------------------------------------ Double Stack ------------------------------------------------
 
 typedef struct{
 
-  double *data; // Dynamic array of double values
+  double *data; // Dynamic array of double values (inline_data until it is full)
   unsigned int size; // Current number of values stored
   unsigned int cap; // Numbers of values that can be stored without realloc
+  Arena *arena; // Arena where the memory comes from (NULL to use malloc)
+  double inline_data[STACK_INLINE_SIZE]; // First values, so small stacks do not allocate memory
 } DoubleStack;
 
-/* Function to create and initialize the stack
-   It receives a reference to the stack */
-void DoubleStack_init(DoubleStack *dstack);
+/* Function to create and initialize the stack (the stack points to itself, so it can not be copied after this)
+   It receives a reference to the stack and the arena to allocate from (NULL to use malloc) */
+void DoubleStack_init(DoubleStack *dstack, Arena *arena);
 
-/* Function to free the stack
+/* Function to free the stack (memory of a arena is only released by Arena_reset)
    It receives a reference to the stack to free */
 void DoubleStack_free(DoubleStack *dstack);
    
+/* Function to make sure the stack can store a number of values, so the pushes after it never allocate memory
+   It returns false if memory allocation failed
+   It receives a reference to the stack and the number of values */
+bool DoubleStack_reserve(DoubleStack *dstack, unsigned int cap);
+
 /* Function to tell whether the stack is empty or not
    It returns true if is empty
    It receives a reference to the stack */
@@ -0,0 +1,24 @@
+/* This program is part of the math interpreter, it converts doubles into the shortest text that is read back as the same double (Grisu2 algorithm, with a slower search for the few doubles it can not decide, like 1e23).
+   It is used by the GUI and by the command-line evaluator. */
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+
+#define FORMAT_DOUBLE_SIZE 32 // Chars needed by Format_double, including the NULL terminator
+
+/* Function to write a double with the fewest digits that are read back (by strtod) as the same double
+   The text always reads back as the same double, and there is no shorter text that does (1e23 is written as 1e+23, not as 9.999999999999999e+22)
+   Numbers with exponent from -4 to 16 are written without exponent (like 0.001 or 123.25), the others in scientific notation (like 1e+21),
+   NAN is written as nan and infinity as inf or -inf
+   It returns the number of chars written (without the NULL terminator)
+   It receives the double and the array where the text is written (at least FORMAT_DOUBLE_SIZE chars) */
+size_t Format_double(double value, char *buffer);
+
+/* Function to write many doubles like Format_double into the same array, each one followed by a separator (like a new line)
+   It returns the number of chars written (without the NULL terminator)
+   It receives the doubles, how many there are, the separator and the array where the text is written (at least count*FORMAT_DOUBLE_SIZE+1 chars) */
+size_t Format_doubles(const double *values, size_t count, char separator, char *buffer);
+
+#endif
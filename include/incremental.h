@@ -0,0 +1,111 @@
+/* This program is part of the math interpreter, it evaluates a expression while it is typed (like the live result of the calculator).
+   The Shunting-yard state (stacks of operators and of values) is kept between changes, and each change only lexes again the
+   number or name at the end of the expression, so typing or erasing a char does not depend on the length of the expression.
+   Operators are applied as soon as the Shunting-yard pops them, with the constant folding of the optimizer, so the result is the same
+   as the one of Math_interpreter_evaluate_expression for the whole text. */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "token.h"
+#include "parser.h"
+#include "bytecode.h"
+
+/* Value of the stack of values */
+typedef struct{
+
+  bool is_known;             // False if the value depends on a variable (the expression has no result then)
+  BytecodeConstant constant; // The value, if it is known
+} IncrementalValue;
+
+/* State of the parser that is not in the stacks */
+typedef struct{
+
+  bool expect_operand;          // True if the next token must be a operand (number, variable, '(', function or unary '-')
+  bool expect_open_paren;       // True if the last token was a function, that must be followed by '('
+  bool after_negate;            // True if the last token was a unary '-', that can not be followed by another '-'
+  unsigned int negate_position; // Position of that unary '-'
+  TokenKind previous;           // Kind of the last token of the lexer (TOK_END if none), to add the implicit '*'
+  ParseError error;             // First syntax error (PARSE_OK if none), the tokens after it are ignored
+} IncrementalState;
+
+/* Change of one of the stacks, kept so the changes of a token can be undone */
+typedef struct{
+
+  bool pushed;            // True if a item was pushed (the undo pops it), false if the item below was popped
+  Token token;            // Popped operator (only in the log of the operator stack)
+  IncrementalValue value; // Popped value (only in the log of the value stack)
+} IncrementalChange;
+
+/* Token applied to the parser, with what is needed to undo it */
+typedef struct{
+
+  unsigned int offset;     // Position of the first char of the token (of the next token for the implicit '*')
+  size_t operator_changes; // Changes of the operator stack before the token
+  size_t value_changes;    // Changes of the value stack before the token
+  IncrementalState state;  // State before the token
+} IncrementalStep;
+
+typedef struct{
+
+  char *text;      // The expression, with NULL terminator
+  size_t length;   // Chars of the expression
+  size_t text_cap; // Allocated chars of text
+
+  Token *operators;          // Stack of operators, '(' and functions
+  size_t operator_count;
+  size_t operator_cap;
+  IncrementalValue *values;  // Stack of values
+  size_t value_count;
+  size_t value_cap;
+
+  IncrementalChange *operator_log; // Changes of the operator stack, in order
+  size_t operator_log_count;
+  size_t operator_log_cap;
+  IncrementalChange *value_log;    // Changes of the value stack, in order
+  size_t value_log_count;
+  size_t value_log_cap;
+
+  IncrementalStep *steps; // Tokens applied, in order
+  size_t step_count;
+  size_t step_cap;
+
+  IncrementalState state; // State after the last token
+  bool out_of_memory;     // True if a change could not be applied (until Incremental_clear)
+} IncrementalExpr;
+
+/* Function to initialize a empty expression
+   It receives the expression */
+void Incremental_init(IncrementalExpr *expr);
+
+/* Function to add chars to the end of the expression
+   It returns false if memory allocation failed (the result is PARSE_OUT_OF_MEMORY until Incremental_clear)
+   It receives the expression, the chars and their number */
+bool Incremental_append(IncrementalExpr *expr, const char *chars, size_t count);
+
+/* Function to remove chars from the end of the expression
+   It returns false if memory allocation failed (the result is PARSE_OUT_OF_MEMORY until Incremental_clear)
+   It receives the expression and the number of chars (at most its length) */
+bool Incremental_remove(IncrementalExpr *expr, size_t count);
+
+/* Function to make the expression empty again, keeping its memory
+   It receives the expression */
+void Incremental_clear(IncrementalExpr *expr);
+
+/* Function to return the text of the expression (with NULL terminator, valid until the next change)
+   It receives the expression */
+const char *Incremental_text(const IncrementalExpr *expr);
+
+/* Function to return the result of the expression, its work only depends on the depth of the open operators and parentheses
+   It returns true if the expression has a result, false if it has a syntax error or variables (error->kind is PARSE_OK then)
+   It receives the expression, where the result is written and a reference to the error (can be NULL) */
+bool Incremental_result(const IncrementalExpr *expr, double *result, ParseError *error);
+
+/* Function to free the memory of the expression
+   It receives the expression */
+void Incremental_free(IncrementalExpr *expr);
+
+#endif
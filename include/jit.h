@@ -0,0 +1,35 @@
+/* This program is part of the math interpreter, it compiles the bytecode into native x86-64 machine code (JIT).
+   The stack of the bytecode lives in the SSE registers and the loop over the rows is part of the code, so there is no interpreter dispatch.
+   On other architectures (or when built with MATH_NO_JIT) nothing is compiled and the bytecode interpreter is used. */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bytecode.h"
+
+#define JIT_MAX_DEPTH 16 // Deepest stack that fits in the registers (xmm0 to xmm15), deeper bytecode is not compiled
+
+/* Native function of a expression, it writes out[i] = expression evaluated with the variables columns[variable][i], for each row */
+typedef void (*JitFunction)(const double *const *columns, size_t rows, double *out);
+
+typedef struct{
+
+  JitFunction function; // Entry point of the code (NULL if the bytecode was not compiled)
+  void *memory;         // Executable pages with the constants and the code
+  size_t size;          // Bytes of the pages
+} JitCode;
+
+/* Function to compile optimized bytecode into native code, with the same results as Bytecode_evaluate_batch
+   It returns false if there is no JIT for this architecture, the stack of the bytecode is deeper than JIT_MAX_DEPTH
+   or memory allocation failed (jit->function is NULL then)
+   It receives a reference to the bytecode and the native code to fill */
+bool Jit_compile(const Bytecode *bytecode, JitCode *jit);
+
+/* Function to free the native code
+   It receives a reference to the native code */
+void Jit_free(JitCode *jit);
+
+#endif
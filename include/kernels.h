@@ -0,0 +1,50 @@
+/* This program is part of the math interpreter, it implements the kernels used by the batch evaluation (one operation over a block of rows).
+   There is one version of the kernels for each instruction set (AVX-512, AVX2, SSE2, NEON and scalar), the best one is chosen at runtime. */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#define KERNELS_MAX_SQUARING_EXPONENT 64 // Biggest integer exponent whose power is calculated with multiplications instead of pow
+
+typedef enum{
+
+  KERNELS_SCALAR,
+  KERNELS_SSE2,
+  KERNELS_AVX2,
+  KERNELS_AVX512,
+  KERNELS_NEON,
+  KERNELS_TOTAL
+} KernelIsa;
+
+typedef void (*UnaryKernel)(double *out, const double *a, unsigned int count);
+typedef void (*BinaryKernel)(double *out, const double *a, const double *b, unsigned int count);
+
+/* Struct with the kernels of one instruction set, out can be the same array as a or b */
+typedef struct{
+
+  const char *name; // Name of the instruction set
+  UnaryKernel neg;  // out[i] = -a[i]
+  UnaryKernel sqrt; // out[i] = sqrt(a[i]), NAN if a[i] is negative
+  BinaryKernel add; // out[i] = a[i] + b[i]
+  BinaryKernel sub; // out[i] = a[i] - b[i]
+  BinaryKernel mul; // out[i] = a[i] * b[i]
+  BinaryKernel div; // out[i] = a[i] / b[i], NAN if b[i] is 0
+  BinaryKernel mod; // out[i] = fmod(a[i], b[i]), NAN if b[i] is 0
+  BinaryKernel pow; // out[i] = a[i] ^ b[i] (see Kernels_pow)
+} KernelTable;
+
+/* Function to raise a number to a power, integer exponents up to KERNELS_MAX_SQUARING_EXPONENT use a squaring loop instead of pow
+   (the result may differ from pow in the last digits)
+   It returns the power and receives the base and the exponent */
+double Kernels_pow(double a, double b);
+
+/* Function to return the kernels of a instruction set
+   It returns NULL if the instruction set is not supported by this CPU (or by this build)
+   It receives the instruction set */
+const KernelTable *Kernels_table(KernelIsa isa);
+
+/* Function to return the kernels of the best instruction set supported by this CPU
+   It returns the kernels (the scalar ones if there is no SIMD support) */
+const KernelTable *Kernels_best(void);
+
+#endif
@@ -4,9 +4,65 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "token.h"
+#include "arena.h"
+
+#define LEXER_STREAM_RUN_SIZE 64 // Initial chars of the buffer of a number or name that is split between chunks
+
+/* Function that receives the tokens of a streaming lexer, in order (the last one is TOK_END)
+   It returns false to stop the lexer, and receives the context given to Lexer_stream_init and the token */
+typedef bool (*LexerTokenSink)(void *context, const Token *token);
+
+/* Lexer of a expression that arrives in chunks (for example read from a pipe or a socket), it only keeps the chars of the
+   number or name that is not complete yet, so the memory does not grow with the expression */
+typedef struct{
+
+  LexerTokenSink sink;      // Function that receives the tokens
+  void *context;            // Context of the sink
+  char *run;                // Chars of the current number or name (the tokens of the run are known when it ends)
+  size_t run_length;        // Chars in run (0 if there is no number or name pending)
+  size_t run_cap;           // Allocated chars of run
+  unsigned long run_offset; // Position of the first char of run in the expression
+  unsigned long position;   // Chars of the expression received before the current chunk
+  TokenKind previous;       // Kind of the last token given to the sink (TOK_END if none), to add the implicit '*'
+} LexerStream;
+
+/* Function to tell if the lexer should add a '*' between two tokens, like in 2(3), (2)sqrt(9) or 2x
+   It returns true if the '*' is needed, and receives the kind of the previous and of the current token */
+bool Lexer_needs_multiply(TokenKind previous, TokenKind current);
+
 /* Function to tokenize a mathematical expression.
-   It receives a array of char (should be without spacing between chars)
-   and returns a array of string */
-   char **Lexer_tokenize(char *expression);
+   It receives a array of char (should be without spacing between chars) and the arena to allocate from (NULL to use malloc)
+   and returns a array of tokens terminated by a TOK_END token (a single allocation, release it with free if there is no arena) */
+   Token *Lexer_tokenize(const char *expression, Arena *arena);
+
+/* Function to tokenize the first chars of a array, like Lexer_tokenize but the expression does not need a NULL terminator
+   (for example a line of a file mapped in memory, that can not be changed)
+   It receives the first char of the expression, its lenght and the arena to allocate from (NULL to use malloc)
+   and returns a array of tokens terminated by a TOK_END token (a single allocation, release it with free if there is no arena) */
+Token *Lexer_tokenize_span(const char *expression, size_t length, Arena *arena);
+
+/* Function to start a lexer of a expression that arrives in chunks
+   It receives the lexer to initialize, the function that receives the tokens and its context */
+void Lexer_stream_init(LexerStream *stream, LexerTokenSink sink, void *context);
+
+/* Function to tokenize the next chunk of the expression, the chunk can end in the middle of a number or name
+   (its chars are kept until the chunk where it ends), every other token is given to the sink before it returns
+   The tokens are the same as the ones of Lexer_tokenize_span for the whole expression, with offsets from its first char
+   It returns false if the sink stopped the lexer or memory allocation failed
+   It receives the lexer, the chars of the chunk (without NULL terminator) and their number */
+bool Lexer_stream_feed(LexerStream *stream, const char *chunk, size_t length);
+
+/* Function to end the expression: the last number or name and a TOK_END token are given to the sink
+   The lexer can then receive the chunks of another expression (the offsets of its tokens start again at 0)
+   It returns false if the sink stopped the lexer, and receives the lexer */
+bool Lexer_stream_finish(LexerStream *stream);
+
+/* Function to free the memory of the lexer (the sink is not called)
+   It receives the lexer */
+void Lexer_stream_free(LexerStream *stream);
 
-#endif
\ No newline at end of file
+#endif
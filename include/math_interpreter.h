@@ -7,6 +7,165 @@
 #include "datastructures.h"
 #include "lexer.h"
 #include "parser.h"
+#include "bytecode.h"
+#include "arena.h"
+#include "threadpool.h"
+#include "bignum.h"
+#include "rational.h"
+#include "jit.h"
+
+#include <stdatomic.h>
+
+/* Struct that holds an expression already validated and converted to bytecode,
+   so it can be evaluated many times without lexing and parsing it again */
+typedef struct{
+
+  Bytecode bytecode;       // RPN of the expression lowered into bytecode
+  JitCode jit;             // Native code of the bytecode (its function is NULL if the expression was not compiled with Math_compile_native)
+  atomic_uint references;  // Number of owners (the caller and the expression cache), the memory is released when it reaches 0
+} CompiledExpr;
+
+/* Struct that binds a variable of a expression to a column of values, used by Math_eval_batch */
+typedef struct{
+
+  const char *name;     // Name of the variable
+  const double *values; // One value per row
+} MathBinding;
+
+/* Function that compiles a math expression, it does the lexing, the parsing and the bytecode lowering parts only once
+   It returns a new CompiledExpr (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the expression as a array of chars and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_compile(const char *expression, ParseError *error);
+
+/* Function that compiles a math expression like Math_compile, and then compiles its bytecode into native machine code (see jit.h)
+   The evaluations of the compiled expression run the native code, without interpreter dispatch. Where there is no JIT
+   (other architectures, builds with MATH_NO_JIT or very deep expressions) the bytecode interpreter is used, with the same results
+   It returns a new CompiledExpr (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the expression as a array of chars and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_compile_native(const char *expression, ParseError *error);
+
+/* Function to tell if a compiled expression runs native code (see Math_compile_native)
+   It receives a reference to the compiled expression */
+bool Math_is_native(const CompiledExpr *compiled);
+
+/* Function that evaluates a compiled expression, it only runs the bytecode interpreter (or the native code)
+   It returns the result as a double (NAN if the expression has variables, use Math_eval_batch for them)
+   It receives a reference to the compiled expression */
+double Math_eval(const CompiledExpr *compiled);
+
+/* Function that evaluates a compiled expression for many rows, the variables of the expression take their values from columns
+   For example, a*x^2+b*x+c with the bindings {{"a", a}, {"b", b}, {"c", c}, {"x", x}, {NULL, NULL}} writes out[i] = a[i]*x[i]^2+b[i]*x[i]+c[i]
+   It returns true if the evaluation succeeded (false if a variable of the expression has no binding or memory allocation failed)
+   It receives a reference to the compiled expression, a array of bindings terminated by a binding with NULL name,
+   the number of rows and the array where the results are written (one per row) */
+bool Math_eval_batch(const CompiledExpr *compiled, const MathBinding *bindings, size_t n, double *out);
+
+/* Function that evaluates a compiled expression for many rows like Math_eval_batch, but the rows are split in chunks evaluated by the workers of a thread pool
+   Each chunk writes its own rows of out, so the output is the same as the one of Math_eval_batch whatever the number of threads
+   It returns true if the evaluation succeeded (false if a variable of the expression has no binding or memory allocation failed)
+   It receives a reference to the compiled expression, a array of bindings terminated by a binding with NULL name,
+   the number of rows, the array where the results are written (one per row) and the thread pool (see threadpool.h) */
+bool Math_eval_batch_parallel(const CompiledExpr *compiled, const MathBinding *bindings, size_t n, double *out, ThreadPool *pool);
+
+/* Function to return the number of different variables of a compiled expression
+   It receives a reference to the compiled expression */
+unsigned int Math_variable_count(const CompiledExpr *compiled);
+
+/* Function to return the name of a variable of a compiled expression
+   It returns the name, or NULL if the index is not valid
+   It receives a reference to the compiled expression and the index of the variable (from 0 to Math_variable_count-1) */
+const char *Math_variable_name(const CompiledExpr *compiled, unsigned int index);
+
+/* Function to free a compiled expression (the memory is only released when the expression cache does not use it anymore)
+   It receives a reference to the compiled expression (can be NULL) */
+void Math_free_compiled(CompiledExpr *compiled);
+
+/* Counters of the expression cache, see Math_cache_stats */
+typedef struct{
+
+  unsigned long hits;      // Lookups that found the expression
+  unsigned long misses;    // Lookups that had to compile the expression
+  unsigned long evictions; // Entries removed to respect the memory limit
+  size_t entries;          // Number of expressions in the cache
+  size_t bytes;            // Memory used by the entries
+  size_t max_bytes;        // Memory limit (0 means that the cache is disabled)
+} MathCacheStats;
+
+/* Function that compiles a math expression like Math_compile, but the compiled expression is taken from the expression cache when possible
+   Expressions that only differ in spaces (like "2 + 3" and "2+3") share the same entry
+   It returns a compiled expression (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the expression as a array of chars and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_cache_compile(const char *expression, ParseError *error);
+
+/* Function to change the memory limit of the expression cache, entries are evicted until it is respected
+   It receives the limit in bytes (0 disables the cache) */
+void Math_cache_set_limit(size_t max_bytes);
+
+/* Function to read the counters of the expression cache
+   It receives a reference to the struct to fill */
+void Math_cache_stats(MathCacheStats *stats);
+
+/* Function to remove every entry of the expression cache (the counters are kept) */
+void Math_cache_clear(void);
+
+/* Configuration of a context, see Math_context_create */
+typedef struct{
+
+  size_t cache_bytes;   // Memory limit of the expression cache of the context (0 disables it)
+  size_t scratch_bytes; // Size of the first block of the scratch memory (it grows if a expression needs more)
+} MathConfig;
+
+/* Everything a thread needs to evaluate expressions: scratch memory, expression cache and configuration */
+typedef struct MathContext MathContext;
+
+/* Function to create a context, the context owns its scratch memory, its expression cache and its configuration
+   A context must only be used by one thread at a time, but different threads can use different contexts at the same time without sharing anything
+   It returns the new context (must be released with Math_context_destroy) or NULL if memory allocation failed
+   It receives the configuration (NULL for the default one, see MathConfig) */
+MathContext *Math_context_create(const MathConfig *config);
+
+/* Function to free a context and everything it owns (compiled expressions returned by Math_context_compile stay valid)
+   It receives the context (can be NULL) */
+void Math_context_destroy(MathContext *context);
+
+/* Function that compiles a math expression using the memory and the expression cache of a context
+   It returns a compiled expression (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the context, the expression and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_context_compile(MathContext *context, const char *expression, ParseError *error);
+
+/* Function that evaluates a math expression using the memory and the expression cache of a context
+   It returns the result as a double
+   It receives the context, the expression, a flag that is set to true if there is a syntax error (or a variable)
+   and a reference to the error that tells what is wrong and where when there is a syntax error (can be NULL) */
+double Math_context_evaluate(MathContext *context, const char *expression, bool *flag_err, ParseError *error);
+
+/* Function that evaluates the first chars of a array like Math_context_evaluate, but the expression does not need a NULL terminator
+   (for example a line of a file mapped in memory), so it is not copied
+   It returns the result as a double
+   It receives the context, the first char of the expression, its lenght, a flag that is set to true if there is a syntax error (or a variable)
+   and a reference to the error that tells what is wrong and where when there is a syntax error (can be NULL) */
+double Math_context_evaluate_span(MathContext *context, const char *expression, size_t length, bool *flag_err, ParseError *error);
+
+/* Function to read the counters of the expression cache of a context
+   It receives the context and a reference to the struct to fill */
+void Math_context_stats(MathContext *context, MathCacheStats *stats);
+
+/* Function that evaluates a math expression with arbitrary precision (big numbers, see bignum.h) instead of doubles
+   The expression goes through the same lexer, parser and bytecode, but the bytecode is not optimized (its constants would be folded as doubles)
+   and the numbers are read again from their text, exactly (even 0.1 and numbers with more digits than the result)
+   It returns the number of chars of the result (0 if there is a syntax error, a variable or memory allocation failed)
+   It receives the expression and its lenght (it does not need a NULL terminator), the number of significant digits of the result,
+   the array where the result is written as text (at least BIGNUM_TEXT_SIZE(digits) chars)
+   and a reference to the error that tells what is wrong and where when 0 is returned (PARSE_OK for variables, can be NULL) */
+size_t Math_evaluate_precise(const char *expression, size_t length, unsigned int digits, char *result, ParseError *error);
+
+/* Function that evaluates a math expression with exact fractions (rationals, see rational.h) instead of doubles, so .1*10 is exactly 1
+   Numbers are read again from their text, + - * / % and integer powers are exact while the fractions fit in 64 bits,
+   sqrt and other powers are exact when their result is rational, and the rest falls back to doubles (the result is then not exact)
+   It returns false if there is a syntax error, a variable or memory allocation failed
+   It receives the expression and its lenght (it does not need a NULL terminator), where the result is written
+   and a reference to the error that tells what is wrong and where when false is returned (PARSE_OK for variables, can be NULL) */
+bool Math_evaluate_rational(const char *expression, size_t length, Rational *result, ParseError *error);
 
 /* Function that evaluates a math expression, it does the lexing and parsing (Shunting-Yard+RPN evaluation) parts
    As this function receives an array of chars (with NULL terminator at the end), 
@@ -15,4 +174,10 @@
    It receives the expression as a array of chars */
 double Math_interpreter_evaluate_expression(char *expression,  bool *flag_err);
 
+/* Function that evaluates a math expression taking all the scratch memory from a arena, that is reset at the end
+   Repeated expressions are found in the expression cache, without lexing nor parsing them again and without any malloc/free
+   It returns the result as a double
+   It receives the expression as a array of chars, the arena and a flag that is set to true if there is a syntax error (or a variable) */
+double Math_interpreter_evaluate_expression_arena(const char *expression, Arena *arena, bool *flag_err);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,17 @@
+/* This program is part of the math interpreter, it converts the text of a number into a correctly rounded double (Eisel-Lemire algorithm).
+   It does not depend on the locale, so the decimal separator is always a dot. */
+
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stddef.h>
+
+/* Function to read the number at the start of a array of chars (the array does not need a NULL terminator)
+   Supports decimal numbers (12, 0.5, .5), exponent notation (1e-9, 2.5E+3), hex numbers and hex floats (0xff, 0x1.8p3)
+   and '_' between two digits as separator (1_000_000). Signs are not read, they are operators of the expression
+   The value is the nearest double to the number (ties to even), like strtod in the "C" locale
+   It returns the number of chars read (0 if the array does not start with a number)
+   It receives the first char, the number of chars that can be read and where the value is stored */
+size_t Number_parse(const char *text, size_t length, double *value);
+
+#endif
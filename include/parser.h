@@ -1,11 +1,12 @@
-/* This program is part of the math interpreter, it is a parser that implements an expression syntax verifier, Shunting-yard algorithm
-   and a RPN evaluator. All of those functions depends on the infix expression being already tokenized by the lexer and in a array of string format.
+/* This program is part of the math interpreter, it is a parser that implements a Shunting-yard algorithm that also verifies the syntax of the expression
+   and a RPN evaluator. All of those functions depends on the infix expression being already tokenized by the lexer into a TOK_END terminated array of tokens.
    It was made by Pedro Arthur Marchi [github.com/PAMarchi]. */
 
 #ifndef PARSER_H
 #define PARSER_H
 
 #include "datastructures.h"
+#include "token.h"
 #include <stdbool.h>
 #include <math.h>
 
@@ -15,58 +16,76 @@ typedef enum{
   RIGHT
 } Associativity;
 
+typedef enum{
+
+  PARSE_OK,                    // No error
+  PARSE_INVALID_TOKEN,         // Malformed number (like 1.5.2) or unknown symbol
+  PARSE_MISSING_OPERAND,       // Operator, ')' or end of the expression where a operand was expected (like 5% or 2*)
+  PARSE_MISSING_OPERATOR,      // Operand where a operator was expected
+  PARSE_MISSING_OPEN_PAREN,    // Function not followed by '('
+  PARSE_UNMATCHED_OPEN_PAREN,  // '(' that is never closed
+  PARSE_UNMATCHED_CLOSE_PAREN, // ')' without '('
+  PARSE_OUT_OF_MEMORY          // Memory allocation failed
+} ParseErrorKind;
+
+typedef struct{
+
+  ParseErrorKind kind;   // What is wrong
+  unsigned int position; // Index of the char of the expression where the error was found (the length of the expression if it is at the end)
+} ParseError;
+
 /* Function to return the precendence of a operator 
    It returns the precedence in form of a int
-   It receives the operator to evaluate */
-int Parser_precedence_of(const char *op);
+   It receives the kind of the operator to evaluate */
+int Parser_precedence_of(TokenKind op);
 
 /* Function to return the associativity of a operator
    It returns if the operator has RIGHT or LEFT associativity 
-   It receives a operator */
-Associativity Parser_assoc_of(const char *op);
+   It receives the kind of a operator */
+Associativity Parser_assoc_of(TokenKind op);
 
 /* Function to tell if a token is a operator or not
    It returns true if the token is a operator
-   It receives the token */
-bool Parser_is_operator(const char *tok);
+   It receives the kind of the token */
+bool Parser_is_operator(TokenKind tok);
 
 /* Similar to Parser_is_operator, but considers unary operator as such 
    It returns true if the token is a operator
-   It receives the token */
-bool Parser_is_any_operator(const char *tok);
+   It receives the kind of the token */
+bool Parser_is_any_operator(TokenKind tok);
 
 /* Function to tell if a token is a number or not
    It returns true if the token is a number
-   It receives the token */
-bool Parser_is_number(const char *tok);
+   It receives the kind of the token */
+bool Parser_is_number(TokenKind tok);
+
+/* Function to tell if a token is a operand (number or variable) or not
+   It returns true if the token is a operand
+   It receives the kind of the token */
+bool Parser_is_operand(TokenKind tok);
 
 /* Function to tell if a token is a function or not
    It returns true if the token is a function
-   It receives the token */
-bool Parser_is_function(const char *tok);
+   It receives the kind of the token */
+bool Parser_is_function(TokenKind tok);
 
 /* Function to return the arity of an operator 
    It returns 1 if is unary or 2 for binary */
-int Parser_arity_of(const char *op);
-
-/* Function to allocate memory for a string 
-   It returns a pointer to the string 
-   It receives a string */
-char *Parser_add_token(const char *src);
+int Parser_arity_of(TokenKind op);
 
-/* Function to analyse the syntax of the array representing the expression
-   It returns true if the syntax is correct
-   It receives the whole expression array */
-bool Parser_is_syntax_correct(char **expression);
+/* Function to return a message that describes a kind of error of the parser
+   It receives the kind of the error */
+const char *Parser_error_message(ParseErrorKind kind);
 
-/* Function to convert infix (The infix is the NULL terminated array of tokens) tokens in RPN 
-   It returns a new NULL terminated array of tokens in Reverse Polish Notation (RPN)
-   It receives an NULL terminated array of tokens */
-char **Parser_Shunting_yard(char **infix);
+/* Function to validate infix (The infix is the TOK_END terminated array of tokens) tokens and convert them in RPN, in a single pass
+   It returns a new TOK_END terminated array of tokens in Reverse Polish Notation (RPN), or NULL if the syntax is not correct
+   It receives an TOK_END terminated array of tokens, the arena to allocate from (NULL to use malloc)
+   and a reference to the error that is filled when NULL is returned (can be NULL) */
+Token *Parser_Shunting_yard(const Token *infix, Arena *arena, ParseError *error);
 
-/* Function to evaluete a NULL terminated array of tokens in RPN 
+/* Function to evaluete a TOK_END terminated array of tokens in RPN 
    It returns the result of the expression in double format
-   It receives a NULL terminated array in RPN */
-double Parser_evaluate_rpn(char **rpn);
+   It receives a TOK_END terminated array in RPN */
+double Parser_evaluate_rpn(const Token *rpn);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+/* This program is part of the math interpreter, it implements exact fractions of 64 bits integers (rational numbers)
+   and a evaluator of the bytecode that uses them instead of doubles. */
+
+#ifndef RATIONAL_H
+#define RATIONAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bytecode.h"
+
+#define RATIONAL_TEXT_SIZE 48 // Chars needed by Rational_to_text, including the NULL terminator
+
+/* Number that is a exact fraction num/den while it fits in 64 bits, or a double when it is not exact
+   (because of a overflow or of a operation like sqrt(2) that has no exact result) */
+typedef struct{
+
+  bool exact;   // True if the value is num/den, false if it is only known as value
+  int64_t num;  // Numerator, with the sign of the number (the fraction is only reduced when needed)
+  int64_t den;  // Denominator, always positive
+  double value; // Value when the number is not exact
+} Rational;
+
+/* Function to make a exact fraction
+   It returns the rational (not exact if den is 0), and receives the numerator and the denominator */
+Rational Rational_make(int64_t num, int64_t den);
+
+/* Function to convert a double into a rational, exact when the double is a fraction of 64 bits integers (like 0.5 or 3)
+   It returns the rational and receives the double */
+Rational Rational_from_double(double value);
+
+/* Function to convert the text of a number (see number.h) into a rational, decimals are exact (like 0.1 = 1/10) if they fit in 64 bits
+   It returns the rational, and receives the first char, the number of chars and the value of the number as a double (used when it does not fit) */
+Rational Rational_from_text(const char *text, size_t length, double value);
+
+/* Function to reduce a fraction to its lowest terms (binary GCD)
+   It returns the reduced rational and receives the rational */
+Rational Rational_reduce(Rational r);
+
+/* Function to convert a rational into a double
+   It returns the double and receives the rational */
+double Rational_to_double(Rational r);
+
+/* Function to write a rational, exact ones as a reduced fraction (like 1/3 or 2) and the others as a double (like 1.4142135623730951)
+   It returns the number of chars written (without the NULL terminator)
+   It receives the rational and the array where the text is written (at least RATIONAL_TEXT_SIZE chars) */
+size_t Rational_to_text(Rational r, char *buffer);
+
+/* Functions of the operations on rationals, the result is exact when the operands are exact and it fits in 64 bits
+   sqrt and ^ are exact when the result is rational (like sqrt(9/4) or 8^(1/3)), % is the remainder of the truncated division (like fmod)
+   x/0, x%0 and the roots of negative numbers (also odd ones, like (-8)^(1/3)) are NAN, the same as the double evaluation
+   They return the result and receive the operands */
+Rational Rational_add(Rational a, Rational b);
+Rational Rational_sub(Rational a, Rational b);
+Rational Rational_mul(Rational a, Rational b);
+Rational Rational_div(Rational a, Rational b);
+Rational Rational_mod(Rational a, Rational b);
+Rational Rational_pow(Rational a, Rational b);
+Rational Rational_sqrt(Rational a);
+
+/* Function to evaluate the bytecode with rationals
+   The bytecode must not be optimized (the optimizer folds constants as doubles) and must not have variables
+   It returns false if the bytecode has variables or memory allocation failed
+   It receives a reference to the bytecode, its constant pool as rationals and where the result is written */
+bool Rational_evaluate(const Bytecode *bytecode, const Rational *constants, Rational *result);
+
+#endif
@@ -0,0 +1,34 @@
+/* This program is part of the math interpreter, it is a thread pool used by the parallel batch evaluation.
+   The tasks of a run are split between the workers, and a worker that finishes its part steals half of the remaining tasks of another. */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct ThreadPool ThreadPool;
+
+/* Function executed for each task of a run
+   It receives the context given to ThreadPool_run, the index of the worker (from 0 to ThreadPool_size-1) and the index of the task */
+typedef void (*ThreadTask)(void *context, unsigned int worker, size_t task);
+
+/* Function to create the pool and start its threads
+   It returns the pool or NULL if it could not be created
+   It receives the number of workers (0 to use one per CPU), the thread that calls ThreadPool_run is also one of the workers */
+ThreadPool *ThreadPool_create(unsigned int threads);
+
+/* Function to stop the threads and free the pool
+   It receives a reference to the pool (can be NULL) */
+void ThreadPool_destroy(ThreadPool *pool);
+
+/* Function to return the number of workers of the pool
+   It receives a reference to the pool */
+unsigned int ThreadPool_size(const ThreadPool *pool);
+
+/* Function to execute the tasks 0 to task_count-1 in the workers of the pool, it only returns when all of them are done
+   It can not be called by more than one thread at the same time for the same pool
+   It receives a reference to the pool, the number of tasks, the function to execute and the context passed to it */
+void ThreadPool_run(ThreadPool *pool, size_t task_count, ThreadTask task, void *context);
+
+#endif
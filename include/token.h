@@ -0,0 +1,33 @@
+/* This program is part of the math interpreter, it defines the token produced by the lexer and consumed by the parser.
+   A token does not own any string, it only points (offset + length) to the chars of the expression it came from. */
+
+#ifndef TOKEN_H
+#define TOKEN_H
+
+typedef enum{
+
+  TOK_NUMBER,        // Real number, already converted to double in value
+  TOK_PLUS,          // +
+  TOK_MINUS,         // - (binary, the parser changes it to TOK_NEGATE when it is unary)
+  TOK_MULTIPLY,      // *
+  TOK_DIVIDE,        // /
+  TOK_MOD,           // %
+  TOK_POWER,         // ^
+  TOK_OPEN_PAREN,    // (
+  TOK_CLOSE_PAREN,   // )
+  TOK_SQRT,          // sqrt function
+  TOK_VARIABLE,      // Any other name, like x or rate
+  TOK_NEGATE,        // Unary minus
+  TOK_INVALID,       // Malformed number
+  TOK_END            // Marks the end of a token array
+} TokenKind;
+
+typedef struct{
+
+  TokenKind kind;      // What the token is
+  unsigned int offset; // Index of the first char of the token in the expression
+  unsigned int length; // Number of chars of the token in the expression (0 for the '*' added by the lexer)
+  double value;        // Value of the number (only for TOK_NUMBER)
+} Token;
+
+#endif
@@ -0,0 +1,167 @@
+/* This program is part of the math interpreter, it is a arena (bump) allocator used by the lexer, the parser and the evaluator.
+   All the memory of one evaluation is taken from the arena and released at once by Arena_reset, which is O(1). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../include/arena.h"
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_MIN_BLOCK 4096
+
+// Block allocated when the main block is full
+struct ArenaBlock{
+
+  ArenaBlock *next;
+  size_t size;
+  size_t used;
+  _Alignas(ARENA_ALIGNMENT) char data[];
+};
+
+/* Function to round a size up to the alignment
+   It returns the rounded size and receives the size */
+static size_t Arena_align(size_t size){
+
+  return (size + ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1);
+}
+
+/* Function to create and initialize the arena
+   It receives a reference to the arena and a optional buffer (can be NULL) with its size, that will be used as the first block */
+void Arena_init(Arena *arena, void *buffer, size_t size){
+
+  arena->data = buffer;
+  arena->cap = buffer ? size : 0;
+  arena->start = 0;
+  arena->owns_data = false;
+  arena->overflow = NULL;
+  arena->overflow_size = 0;
+
+  // The user buffer may not be aligned, so the first bytes are skipped
+  size_t misalignment = (size_t)buffer % ARENA_ALIGNMENT;
+  if(buffer && misalignment)
+    arena->start = (ARENA_ALIGNMENT - misalignment) < size ? (ARENA_ALIGNMENT - misalignment) : size;
+
+  arena->used = arena->last = arena->start;
+}
+
+/* Function to free the overflow blocks
+   It receives a reference to the arena */
+static void Arena_free_overflow(Arena *arena){
+
+  ArenaBlock *block = arena->overflow;
+
+  while(block){
+
+    ArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+
+  arena->overflow = NULL;
+  arena->overflow_size = 0;
+}
+
+/* Function to free all the memory of the arena
+   It receives a reference to the arena */
+void Arena_free(Arena *arena){
+
+  Arena_free_overflow(arena);
+
+  if(arena->owns_data)
+    free(arena->data);
+
+  arena->data = NULL;
+  arena->cap = arena->used = arena->last = arena->start = 0;
+  arena->owns_data = false;
+}
+
+/* Function to allocate memory from the arena, aligned to 16 bytes
+   It returns a pointer to the memory or NULL if the allocation failed
+   It receives a reference to the arena and the number of bytes */
+void *Arena_alloc(Arena *arena, size_t size){
+
+  size = Arena_align(size ? size : 1);
+
+  // If it fits in the main block
+  if(arena->data && arena->cap - arena->used >= size){
+
+    arena->last = arena->used;
+    arena->used += size;
+    return arena->data + arena->last;
+  }
+
+  // If it fits in the current overflow block
+  ArenaBlock *block = arena->overflow;
+  if(block && block->size - block->used >= size){
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+  }
+
+  // Creates a new overflow block
+  size_t block_size = size > ARENA_MIN_BLOCK ? size : ARENA_MIN_BLOCK;
+  if(block && block_size < block->size*2)
+    block_size = block->size*2;
+
+  block = malloc(sizeof(ArenaBlock) + block_size);
+  if(!block)
+    return NULL;
+
+  block->size = block_size;
+  block->used = size;
+  block->next = arena->overflow;
+  arena->overflow = block;
+  arena->overflow_size += block_size;
+
+  return block->data;
+}
+
+/* Function to grow a area of the arena, it grows in place when the area was the last allocation
+   It returns a pointer to the new area (with the old content) or NULL if the allocation failed
+   It receives a reference to the arena, the old area (can be NULL), its old size and the new size */
+void *Arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size){
+
+  // If it is the last allocation of the main block and there is space after it
+  if(old && arena->data && old == arena->data + arena->last && arena->cap - arena->last >= Arena_align(new_size)){
+
+    arena->used = arena->last + Arena_align(new_size);
+    return old;
+  }
+
+  void *ptr = Arena_alloc(arena, new_size);
+  if(ptr && old)
+    memcpy(ptr, old, old_size < new_size ? old_size : new_size);
+
+  return ptr;
+}
+
+/* Function to release all the allocations at once, the memory stays in the arena to be reused
+   If the main block was not enough, it is replaced by one big enough, so the next evaluations do not call malloc
+   It receives a reference to the arena */
+void Arena_reset(Arena *arena){
+
+  // Merge the main block and the overflow blocks into a single bigger main block
+  if(arena->overflow){
+
+    size_t new_cap = arena->cap + arena->overflow_size;
+    char *data = malloc(new_cap);
+
+    Arena_free_overflow(arena);
+
+    if(data){
+
+      if(arena->owns_data)
+        free(arena->data);
+
+      arena->data = data;
+      arena->cap = new_cap;
+      arena->start = 0;
+      arena->owns_data = true;
+    }
+  }
+
+  arena->used = arena->last = arena->start;
+}
@@ -0,0 +1,1324 @@
+/* This program is part of the math interpreter, it implements decimal numbers with arbitrary precision (big numbers).
+   The limbs are in base 10^9, so the numbers are converted to text without divisions and decimals like 0.1 are exact.
+   Multiplication is schoolbook for small numbers, Karatsuba for medium ones and a NTT (number theoretic transform) with 3 primes for big ones,
+   division, square root, exp and ln use Newton iteration. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../include/bignum.h"
+#include "../include/number.h"
+
+#define BIGNUM_BASE 1000000000U             // Base of the limbs
+#define BIGNUM_BASE_DIGITS 9                // Decimal digits of a limb
+#define BIGNUM_GUARD_LIMBS 2                // Limbs kept beyond the digits asked, so the rounding errors do not reach them
+#define BIGNUM_KARATSUBA_LIMBS 40           // Smallest operand size multiplied with Karatsuba instead of schoolbook
+#define BIGNUM_NTT_LIMBS 5000               // Smallest operand size multiplied with the NTT instead of Karatsuba
+#define BIGNUM_NTT_MAX_SIZE (1U << 23)      // Biggest transform of the NTT primes
+#define BIGNUM_MAX_EXP_ARGUMENT 1e12        // exp of bigger arguments is always infinity (or 0 for negative ones)
+#define BIGNUM_DOUBLE_LIMBS 128             // Limbs needed by the exact value of any double
+
+/* Primes of the NTT (all of them are 1 + k*2^23 with primitive root 3), their product is bigger than any coefficient of the products */
+static const uint32_t Bignum_ntt_primes[3] = {998244353U, 167772161U, 469762049U};
+
+// ------------------------------------------------ Limbs ------------------------------------------------
+
+/* Function to add the limbs of y to the limbs of x (x has at least as many limbs as y)
+   It returns the carry out of the last limb of x, and receives x, its size, y and its size */
+static uint32_t Bignum_add_limbs(uint32_t *x, size_t nx, const uint32_t *y, size_t ny){
+
+  uint32_t carry = 0;
+  size_t i;
+
+  for(i=0; i<ny; i++){
+    uint32_t sum = x[i] + y[i] + carry;
+    carry = sum >= BIGNUM_BASE;
+    x[i] = carry ? sum - BIGNUM_BASE : sum;
+  }
+
+  for(; carry && i<nx; i++){
+    carry = ++x[i] == BIGNUM_BASE;
+    if(carry)
+      x[i] = 0;
+  }
+
+  return carry;
+}
+
+/* Function to subtract the limbs of y from the limbs of x (x has at least as many limbs as y and is not smaller)
+   It receives x, its size, y and its size */
+static void Bignum_sub_limbs(uint32_t *x, size_t nx, const uint32_t *y, size_t ny){
+
+  uint32_t borrow = 0;
+  size_t i;
+
+  for(i=0; i<ny; i++){
+    uint32_t subtrahend = y[i] + borrow;
+    borrow = x[i] < subtrahend;
+    x[i] = borrow ? x[i] + BIGNUM_BASE - subtrahend : x[i] - subtrahend;
+  }
+
+  for(; borrow && i<nx; i++){
+    borrow = x[i] == 0;
+    x[i] = borrow ? BIGNUM_BASE - 1 : x[i] - 1;
+  }
+}
+
+/* Function to multiply limbs by a small factor in place, a new limb is added at the end when needed
+   It receives the limbs (with space for one more), a reference to their size and the factor */
+static void Bignum_mul_small_limbs(uint32_t *limbs, unsigned int *size, uint32_t factor){
+
+  uint64_t carry = 0;
+
+  for(unsigned int i=0; i<*size; i++){
+    uint64_t product = (uint64_t) limbs[i] * factor + carry;
+    limbs[i] = product % BIGNUM_BASE;
+    carry = product / BIGNUM_BASE;
+  }
+
+  while(carry){
+    limbs[(*size)++] = carry % BIGNUM_BASE;
+    carry /= BIGNUM_BASE;
+  }
+}
+
+/* Function to multiply limbs with the schoolbook algorithm, O(na*nb)
+   It receives the limbs of a and their size, the limbs of b and their size, and where the na+nb limbs of the product are written */
+static void Bignum_schoolbook(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+
+  memset(out, 0, (na + nb) * sizeof(uint32_t));
+
+  for(size_t i=0; i<nb; i++){
+
+    uint64_t carry = 0;
+    uint64_t factor = b[i];
+    if(factor == 0)
+      continue;
+
+    for(size_t j=0; j<na; j++){
+      uint64_t sum = out[i+j] + a[j] * factor + carry;
+      out[i+j] = sum % BIGNUM_BASE;
+      carry = sum / BIGNUM_BASE;
+    }
+    out[i+na] = carry;
+  }
+}
+
+/* Function to return base^exponent modulo a prime
+   It receives the base, the exponent and the prime */
+static uint32_t Bignum_pow_mod(uint64_t base, uint64_t exponent, uint32_t mod){
+
+  uint64_t result = 1;
+  base %= mod;
+
+  while(exponent){
+    if(exponent & 1)
+      result = result * base % mod;
+    base = base * base % mod;
+    exponent >>= 1;
+  }
+
+  return result;
+}
+
+/* Function to transform a array in place with the number theoretic transform (iterative radix 2)
+   It receives the array, its size (a power of 2), the prime and true to do the inverse transform */
+static void Bignum_ntt(uint32_t *values, size_t n, uint32_t mod, bool inverse){
+
+  // Bit reversal permutation
+  for(size_t i=1, j=0; i<n; i++){
+
+    size_t bit = n >> 1;
+    for(; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+
+    if(i < j){
+      uint32_t tmp = values[i];
+      values[i] = values[j];
+      values[j] = tmp;
+    }
+  }
+
+  for(size_t length=2; length<=n; length<<=1){
+
+    uint64_t root = Bignum_pow_mod(3, (mod - 1) / length, mod);
+    if(inverse)
+      root = Bignum_pow_mod(root, mod - 2, mod);
+
+    for(size_t i=0; i<n; i+=length){
+
+      uint64_t w = 1;
+      for(size_t j=0; j<length/2; j++){
+
+        uint32_t u = values[i+j];
+        uint32_t v = values[i+j+length/2] * w % mod;
+        values[i+j] = u + v >= mod ? u + v - mod : u + v;
+        values[i+j+length/2] = u >= v ? u - v : u + mod - v;
+        w = w * root % mod;
+      }
+    }
+  }
+
+  if(inverse){
+    uint64_t n_inverse = Bignum_pow_mod(n, mod - 2, mod);
+    for(size_t i=0; i<n; i++)
+      values[i] = values[i] * n_inverse % mod;
+  }
+}
+
+/* Function to multiply limbs with a NTT for each of the 3 primes, the coefficients are rebuilt with the chinese remainder theorem
+   It returns false if memory allocation failed
+   It receives the limbs of a and their size, the limbs of b and their size, and where the na+nb limbs of the product are written */
+static bool Bignum_ntt_mul(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+
+  size_t n = 1;
+  while(n < na + nb)
+    n <<= 1;
+
+  uint32_t *transforms = malloc(6 * n * sizeof(uint32_t));
+  if(!transforms)
+    return false;
+
+  for(int p=0; p<3; p++){
+
+    uint32_t mod = Bignum_ntt_primes[p];
+    uint32_t *fa = &transforms[2*p*n];
+    uint32_t *fb = &transforms[(2*p+1)*n];
+
+    for(size_t i=0; i<n; i++){
+      fa[i] = i < na ? a[i] % mod : 0;
+      fb[i] = i < nb ? b[i] % mod : 0;
+    }
+
+    Bignum_ntt(fa, n, mod, false);
+    Bignum_ntt(fb, n, mod, false);
+
+    for(size_t i=0; i<n; i++)
+      fa[i] = (uint64_t) fa[i] * fb[i] % mod;
+
+    Bignum_ntt(fa, n, mod, true);
+  }
+
+  // Garner's algorithm: x = r1 + m1*t1 + m1*m2*t2
+  uint64_t m1 = Bignum_ntt_primes[0], m2 = Bignum_ntt_primes[1], m3 = Bignum_ntt_primes[2];
+  uint64_t m1_inverse = Bignum_pow_mod(m1, m2 - 2, m2);
+  uint64_t m12_inverse = Bignum_pow_mod(m1 * m2 % m3, m3 - 2, m3);
+  unsigned __int128 carry = 0;
+
+  for(size_t i=0; i<na+nb; i++){
+
+    uint64_t r1 = transforms[i], r2 = transforms[2*n+i], r3 = transforms[4*n+i];
+    uint64_t t1 = (r2 + m2 - r1 % m2) % m2 * m1_inverse % m2;
+    uint64_t x12 = r1 + m1 * t1;
+    uint64_t t2 = (r3 + m3 - x12 % m3) % m3 * m12_inverse % m3;
+
+    carry += x12 + (unsigned __int128) (m1 * m2) * t2;
+    out[i] = (uint32_t) (carry % BIGNUM_BASE);
+    carry /= BIGNUM_BASE;
+  }
+
+  free(transforms);
+  return true;
+}
+
+static bool Bignum_mul_limbs(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+
+/* Function to multiply limbs with Karatsuba, 3 products of half size instead of 4, O(n^1.58)
+   Operands of very different sizes are split in pieces of the size of the smaller one
+   It returns false if memory allocation failed
+   It receives the limbs of a and their size, the limbs of b and their size (na >= nb), and where the na+nb limbs of the product are written */
+static bool Bignum_karatsuba(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+
+  if(na >= 2*nb){
+
+    uint32_t *piece = malloc(2 * nb * sizeof(uint32_t));
+    if(!piece)
+      return false;
+
+    memset(out, 0, (na + nb) * sizeof(uint32_t));
+
+    for(size_t offset=0; offset<na; offset+=nb){
+
+      size_t length = na - offset < nb ? na - offset : nb;
+      if(!Bignum_mul_limbs(&a[offset], length, b, nb, piece)){
+        free(piece);
+        return false;
+      }
+      Bignum_add_limbs(&out[offset], na + nb - offset, piece, length + nb);
+    }
+
+    free(piece);
+    return true;
+  }
+
+  // a = a1*B^m + a0 and b = b1*B^m + b0, b1 is not empty because nb > na/2
+  size_t m = na / 2;
+  size_t la = na - m + 1;
+  size_t lb = (nb - m > m ? nb - m : m) + 1;
+
+  uint32_t *sums = calloc(la + lb + la + lb, sizeof(uint32_t));
+  if(!sums)
+    return false;
+
+  uint32_t *sa = sums;
+  uint32_t *sb = &sums[la];
+  uint32_t *middle = &sums[la + lb];
+
+  // z0 = a0*b0 and z2 = a1*b1 go to their places in out
+  if(!Bignum_mul_limbs(a, m, b, m, out) || !Bignum_mul_limbs(&a[m], na - m, &b[m], nb - m, &out[2*m])){
+    free(sums);
+    return false;
+  }
+
+  // z1 = (a0+a1)*(b0+b1) - z0 - z2
+  memcpy(sa, a, m * sizeof(uint32_t));
+  Bignum_add_limbs(sa, la, &a[m], na - m);
+  memcpy(sb, b, m * sizeof(uint32_t));
+  Bignum_add_limbs(sb, lb, &b[m], nb - m);
+
+  if(!Bignum_mul_limbs(sa, la, sb, lb, middle)){
+    free(sums);
+    return false;
+  }
+
+  Bignum_sub_limbs(middle, la + lb, out, 2*m);
+  Bignum_sub_limbs(middle, la + lb, &out[2*m], na + nb - 2*m);
+
+  size_t middle_size = la + lb;
+  while(middle_size > 0 && middle[middle_size-1] == 0)
+    middle_size--;
+
+  Bignum_add_limbs(&out[m], na + nb - m, middle, middle_size);
+
+  free(sums);
+  return true;
+}
+
+/* Function to multiply limbs, the algorithm is chosen by the size of the smaller operand
+   It returns false if memory allocation failed
+   It receives the limbs of a and their size, the limbs of b and their size, and where the na+nb limbs of the product are written */
+static bool Bignum_mul_limbs(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+
+  if(na < nb){
+    const uint32_t *tmp = a;
+    a = b;
+    b = tmp;
+    size_t tmp_size = na;
+    na = nb;
+    nb = tmp_size;
+  }
+
+  if(nb < BIGNUM_KARATSUBA_LIMBS){
+    Bignum_schoolbook(a, na, b, nb, out);
+    return true;
+  }
+
+  if(nb >= BIGNUM_NTT_LIMBS && na + nb <= BIGNUM_NTT_MAX_SIZE)
+    return Bignum_ntt_mul(a, na, b, nb, out);
+
+  return Bignum_karatsuba(a, na, b, nb, out);
+}
+
+// ------------------------------------------------ Big numbers ------------------------------------------------
+
+/* Function to tell how many limbs are needed to keep a number of significant digits (with some digits more as guard)
+   It returns the precision used by the other functions, and receives the number of digits */
+unsigned int Bignum_precision(unsigned int digits){
+
+  return (digits + BIGNUM_BASE_DIGITS - 1) / BIGNUM_BASE_DIGITS + BIGNUM_GUARD_LIMBS;
+}
+
+/* Function to initialize a big number with the value 0
+   It receives a reference to the big number */
+void Bignum_init(BigNum *num){
+
+  num->kind = BIGNUM_FINITE;
+  num->sign = 1;
+  num->exponent = 0;
+  num->size = 0;
+  num->limbs = NULL;
+}
+
+/* Function to free the memory of a big number, it is 0 after it
+   It receives a reference to the big number */
+void Bignum_free(BigNum *num){
+
+  free(num->limbs);
+  Bignum_init(num);
+}
+
+/* Function to make a big number NAN or infinite
+   It receives a reference to the big number, its kind and its sign */
+static void Bignum_set_special(BigNum *num, BignumKind kind, int sign){
+
+  Bignum_free(num);
+  num->kind = kind;
+  num->sign = sign;
+}
+
+/* Function to give limbs to a big number, they are rounded to the precision (half up) and the zeros of both ends are removed
+   The limbs can be bigger than size, they are owned by the big number after it (its old limbs are released)
+   It receives the big number, the limbs, their size, the exponent of the first limb, the sign and the precision */
+static void Bignum_set_limbs(BigNum *num, uint32_t *limbs, size_t size, long exponent, int sign, unsigned int precision){
+
+  while(size > 0 && limbs[size-1] == 0)
+    size--;
+
+  size_t low = 0;
+
+  if(size > precision){
+
+    low = size - precision;
+
+    if(limbs[low-1] >= BIGNUM_BASE / 2){
+
+      size_t i = low;
+      while(i < size && limbs[i] == BIGNUM_BASE - 1)
+        limbs[i++] = 0;
+
+      // Every kept limb was 999999999, the number becomes a single 1 one limb above
+      if(i == size){
+        low = size - 1;
+        limbs[low] = 1;
+        exponent++;
+      }
+      else
+        limbs[i]++;
+    }
+  }
+
+  while(low < size && limbs[low] == 0)
+    low++;
+
+  if(size > low)
+    memmove(limbs, &limbs[low], (size - low) * sizeof(uint32_t));
+
+  if(num->limbs != limbs)
+    free(num->limbs);
+
+  num->kind = BIGNUM_FINITE;
+  num->limbs = limbs;
+  num->size = size - low;
+  num->exponent = num->size ? exponent + (long) low : 0;
+  num->sign = num->size ? sign : 1;
+}
+
+/* Function to copy a big number
+   It returns false if memory allocation failed
+   It receives the big number to write and the one to copy */
+static bool Bignum_copy(BigNum *dest, const BigNum *src){
+
+  if(dest == src)
+    return true;
+
+  uint32_t *limbs = malloc((src->size ? src->size : 1) * sizeof(uint32_t));
+  if(!limbs)
+    return false;
+
+  if(src->size)
+    memcpy(limbs, src->limbs, src->size * sizeof(uint32_t));
+  Bignum_set_limbs(dest, limbs, src->size, src->exponent, src->sign, src->size);
+  dest->kind = src->kind;
+  dest->sign = src->sign;
+  return true;
+}
+
+/* Function to round a big number to a precision
+   It receives the big number and the precision */
+static void Bignum_round(BigNum *num, unsigned int precision){
+
+  if(num->kind == BIGNUM_FINITE)
+    Bignum_set_limbs(num, num->limbs, num->size, num->exponent, num->sign, precision);
+}
+
+/* Function to move the value of a big number to another one, rounded to a precision (the first one is 0 after it)
+   It receives the big number to write, the one to move and the precision */
+static void Bignum_move(BigNum *dest, BigNum *src, unsigned int precision){
+
+  if(src->kind != BIGNUM_FINITE)
+    Bignum_set_special(dest, src->kind, src->sign);
+  else
+    Bignum_set_limbs(dest, src->limbs, src->size, src->exponent, src->sign, precision);
+
+  src->limbs = NULL;
+  Bignum_free(src);
+}
+
+/* Function to tell the position of the most significant limb plus 1 (the number is smaller than 10^(9*top))
+   It receives a reference to the big number (not 0) */
+static long Bignum_top(const BigNum *num){
+
+  return num->exponent + (long) num->size;
+}
+
+/* Function to return the first limbs of a big number as a double, value = result * 10^(9*exponent)
+   It receives a reference to the big number (not 0) and where the exponent is written */
+static double Bignum_leading(const BigNum *num, long *exponent){
+
+  unsigned int taken = num->size < 3 ? num->size : 3; // At least 19 digits, more than a double keeps
+  double value = 0.0;
+
+  for(unsigned int i=0; i<taken; i++)
+    value = value * BIGNUM_BASE + num->limbs[num->size - 1 - i];
+
+  *exponent = Bignum_top(num) - taken;
+  return value;
+}
+
+/* Function to tell if a big number is a integer
+   It receives a reference to the big number */
+static bool Bignum_is_integer(const BigNum *num){
+
+  return num->kind == BIGNUM_FINITE && (num->size == 0 || num->exponent >= 0);
+}
+
+/* Function to compare the absolute values of two big numbers
+   It returns -1 if |a| < |b|, 0 if they are equal and 1 if |a| > |b|
+   It receives the big numbers */
+static int Bignum_compare_abs(const BigNum *a, const BigNum *b){
+
+  if(a->size == 0 || b->size == 0)
+    return (a->size != 0) - (b->size != 0);
+
+  if(Bignum_top(a) != Bignum_top(b))
+    return Bignum_top(a) < Bignum_top(b) ? -1 : 1;
+
+  long low = a->exponent < b->exponent ? a->exponent : b->exponent;
+  for(long position=Bignum_top(a)-1; position>=low; position--){
+
+    uint32_t x = position >= a->exponent ? a->limbs[position - a->exponent] : 0;
+    uint32_t y = position >= b->exponent ? b->limbs[position - b->exponent] : 0;
+    if(x != y)
+      return x < y ? -1 : 1;
+  }
+
+  return 0;
+}
+
+/* Function to convert a double into a big number, the conversion is exact unless it needs more than the precision
+   It returns false if memory allocation failed
+   It receives the double, the big number to write and the precision (see Bignum_precision) */
+bool Bignum_from_double(double value, BigNum *num, unsigned int precision){
+
+  if(isnan(value) || isinf(value)){
+    Bignum_set_special(num, isnan(value) ? BIGNUM_NAN : BIGNUM_INFINITE, value < 0 ? -1 : 1);
+    return true;
+  }
+
+  uint32_t *limbs = calloc(BIGNUM_DOUBLE_LIMBS, sizeof(uint32_t));
+  if(!limbs)
+    return false;
+
+  // value = m * 2^e with a integer m of 53 bits
+  int binary_exponent;
+  double fraction = frexp(fabs(value), &binary_exponent);
+  uint64_t m = (uint64_t) ldexp(fraction, 53);
+  long e = binary_exponent - 53;
+
+  while(m != 0 && (m & 1) == 0){
+    m >>= 1;
+    e++;
+  }
+
+  unsigned int size = 0;
+  for(; m; m /= BIGNUM_BASE)
+    limbs[size++] = m % BIGNUM_BASE;
+
+  long exponent = 0;
+
+  // m * 2^e is a integer, or m * 5^-e / 10^-e (the power of 10 is a multiple of 9 digits, so it is a exponent of the limbs)
+  if(e >= 0){
+    for(; e > 0; e -= 29)
+      Bignum_mul_small_limbs(limbs, &size, 1U << (e < 29 ? e : 29));
+  }
+  else{
+    long digits = -e;
+    for(long left = digits; left > 0; left -= 13)
+      Bignum_mul_small_limbs(limbs, &size, (uint32_t) pow(5, left < 13 ? left : 13));
+
+    long pad = (BIGNUM_BASE_DIGITS - digits % BIGNUM_BASE_DIGITS) % BIGNUM_BASE_DIGITS;
+    Bignum_mul_small_limbs(limbs, &size, (uint32_t) pow(10, pad));
+    exponent = -(digits + pad) / BIGNUM_BASE_DIGITS;
+  }
+
+  Bignum_set_limbs(num, limbs, size, exponent, value < 0 ? -1 : 1, precision);
+  return true;
+}
+
+/* Function to convert the text of a number (see number.h) into a big number, decimal numbers are converted exactly
+   (rounded to the precision), hex numbers go through their double value
+   It returns false if memory allocation failed
+   It receives the first char, the number of chars, the big number to write and the precision (see Bignum_precision) */
+bool Bignum_from_text(const char *text, size_t length, BigNum *num, unsigned int precision){
+
+  if(length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')){
+    double value = 0.0;
+    Number_parse(text, length, &value);
+    return Bignum_from_double(value, num, precision);
+  }
+
+  char *digits = malloc(length + BIGNUM_BASE_DIGITS);
+  if(!digits)
+    return false;
+
+  size_t count = 0;
+  long exponent = 0;
+  bool fraction = false;
+
+  for(size_t i=0; i<length; i++){
+
+    char c = text[i];
+
+    if(c >= '0' && c <= '9'){
+      digits[count++] = c;
+      exponent -= fraction;
+    }
+    else if(c == '.')
+      fraction = true;
+    else if(c == 'e' || c == 'E'){
+
+      long value = 0;
+      bool negative = i+1 < length && text[i+1] == '-';
+
+      for(i++; i<length; i++){
+        if(text[i] >= '0' && text[i] <= '9' && value < 1000000000L)
+          value = value*10 + (text[i] - '0');
+      }
+      exponent += negative ? -value : value;
+    }
+  }
+
+  // The exponent must be a multiple of 9 digits, so zeros are added at the end
+  long pad = ((exponent % BIGNUM_BASE_DIGITS) + BIGNUM_BASE_DIGITS) % BIGNUM_BASE_DIGITS;
+  memset(&digits[count], '0', pad);
+  count += pad;
+  exponent -= pad;
+
+  size_t size = (count + BIGNUM_BASE_DIGITS - 1) / BIGNUM_BASE_DIGITS;
+  uint32_t *limbs = malloc((size ? size : 1) * sizeof(uint32_t));
+  if(!limbs){
+    free(digits);
+    return false;
+  }
+
+  // The limbs are made from the last digits to the first ones
+  for(size_t i=0; i<size; i++){
+
+    size_t end = count - i*BIGNUM_BASE_DIGITS;
+    size_t start = end >= BIGNUM_BASE_DIGITS ? end - BIGNUM_BASE_DIGITS : 0;
+    uint32_t limb = 0;
+
+    for(size_t j=start; j<end; j++)
+      limb = limb*10 + (digits[j] - '0');
+    limbs[i] = limb;
+  }
+
+  free(digits);
+  Bignum_set_limbs(num, limbs, size, exponent / BIGNUM_BASE_DIGITS, 1, precision);
+  return true;
+}
+
+/* Function to convert a big number into the nearest double (approximately, the error may be of some units in the last place)
+   It returns the double and receives a reference to the big number */
+double Bignum_to_double(const BigNum *num){
+
+  if(num->kind == BIGNUM_NAN)
+    return NAN;
+
+  if(num->kind == BIGNUM_INFINITE)
+    return num->sign * INFINITY;
+
+  if(num->size == 0)
+    return 0.0;
+
+  long exponent;
+  double value = Bignum_leading(num, &exponent);
+
+  // Numbers far out of the range of doubles, pow would give inf * 0
+  if(exponent > 40)
+    return num->sign * INFINITY;
+  if(exponent < -40)
+    return num->sign * 0.0;
+
+  return num->sign * value * pow(10.0, (double) (exponent * BIGNUM_BASE_DIGITS));
+}
+
+/* Function to write a big number rounded to a number of significant digits, without the trailing zeros
+   Numbers with exponent from -6 to digits-1 are written without exponent (like 0.001 or 123.25), the others in scientific notation (like 1e+100)
+   It returns the number of chars written (without the NULL terminator), or 0 if memory allocation failed
+   It receives the big number, the number of digits and the array where the text is written (at least BIGNUM_TEXT_SIZE(digits) chars) */
+size_t Bignum_to_text(const BigNum *num, unsigned int digits, char *buffer){
+
+  if(num->kind == BIGNUM_NAN)
+    return sprintf(buffer, "nan");
+
+  if(num->kind == BIGNUM_INFINITE)
+    return sprintf(buffer, num->sign < 0 ? "-inf" : "inf");
+
+  if(num->size == 0)
+    return sprintf(buffer, "0");
+
+  if(digits == 0)
+    digits = 1;
+
+  char *text = malloc((size_t) num->size * BIGNUM_BASE_DIGITS + 2);
+  if(!text)
+    return 0;
+
+  // Every limb has 9 digits, except the first one that has no leading zeros
+  size_t count = sprintf(text, "%u", num->limbs[num->size-1]);
+  for(unsigned int i=num->size-1; i-->0; )
+    count += sprintf(&text[count], "%09u", num->limbs[i]);
+
+  long exponent = (Bignum_top(num) - 1) * BIGNUM_BASE_DIGITS + (long) (count - BIGNUM_BASE_DIGITS * (num->size - 1)) - 1;
+
+  // Round half up to the number of digits
+  if(count > digits){
+
+    bool up = text[digits] >= '5';
+    count = digits;
+
+    for(size_t i=count; up && i-->0; ){
+      up = text[i] == '9';
+      text[i] = up ? '0' : text[i] + 1;
+    }
+
+    if(up){
+      text[0] = '1';
+      exponent++;
+    }
+  }
+
+  while(count > 1 && text[count-1] == '0')
+    count--;
+
+  char *out = buffer;
+  if(num->sign < 0)
+    *out++ = '-';
+
+  if(exponent < -6 || exponent >= (long) digits){
+
+    *out++ = text[0];
+    if(count > 1){
+      *out++ = '.';
+      memcpy(out, &text[1], count - 1);
+      out += count - 1;
+    }
+    out += sprintf(out, "e%c%ld", exponent < 0 ? '-' : '+', exponent < 0 ? -exponent : exponent);
+  }
+  else if(exponent >= 0){
+
+    for(long i=0; i<=exponent; i++)
+      *out++ = (size_t) i < count ? text[i] : '0';
+
+    if(count > (size_t) exponent + 1){
+      *out++ = '.';
+      memcpy(out, &text[exponent+1], count - exponent - 1);
+      out += count - exponent - 1;
+    }
+  }
+  else{
+
+    *out++ = '0';
+    *out++ = '.';
+    for(long i=-1; i>exponent; i--)
+      *out++ = '0';
+    memcpy(out, text, count);
+    out += count;
+  }
+
+  *out = '\0';
+  free(text);
+  return out - buffer;
+}
+
+// ------------------------------------------------ Arithmetic ------------------------------------------------
+
+/* Function to add b (or -b) to a
+   It returns false if memory allocation failed
+   It receives the operands, the sign that multiplies b, the big number where the result is written and the precision */
+static bool Bignum_add_signed(const BigNum *a, const BigNum *b, int b_sign, BigNum *out, unsigned int precision){
+
+  if(b->size == 0){
+    if(!Bignum_copy(out, a))
+      return false;
+    Bignum_round(out, precision);
+    return true;
+  }
+
+  if(a->size == 0){
+    if(!Bignum_copy(out, b))
+      return false;
+    out->sign *= b_sign;
+    Bignum_round(out, precision);
+    return true;
+  }
+
+  // Limbs far below the precision of the result do not change it, they are dropped
+  long top = Bignum_top(a) > Bignum_top(b) ? Bignum_top(a) : Bignum_top(b);
+  long low = a->exponent < b->exponent ? a->exponent : b->exponent;
+  if(top - low > (long) precision + 2)
+    low = top - (long) precision - 2;
+
+  size_t size = top - low + 1;
+  uint32_t *x = calloc(2 * size, sizeof(uint32_t));
+  if(!x)
+    return false;
+
+  uint32_t *y = &x[size];
+  int b_effective = b->sign * b_sign;
+
+  // x gets the operand with the bigger absolute value
+  bool swap = a->sign != b_effective && Bignum_compare_abs(a, b) < 0;
+  const BigNum *first = swap ? b : a;
+  const BigNum *second = swap ? a : b;
+  int sign = swap ? b_effective : a->sign;
+
+  for(unsigned int i=0; i<first->size; i++)
+    if(first->exponent + (long) i >= low)
+      x[first->exponent + i - low] = first->limbs[i];
+
+  for(unsigned int i=0; i<second->size; i++)
+    if(second->exponent + (long) i >= low)
+      y[second->exponent + i - low] = second->limbs[i];
+
+  if(a->sign == b_effective)
+    Bignum_add_limbs(x, size, y, size);
+  else
+    Bignum_sub_limbs(x, size, y, size);
+
+  uint32_t *limbs = realloc(x, size * sizeof(uint32_t));
+  Bignum_set_limbs(out, limbs ? limbs : x, size, low, sign, precision);
+  return true;
+}
+
+/* Function to add two big numbers (see bignum.h) */
+bool Bignum_add(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision){
+
+  return Bignum_add_signed(a, b, 1, out, precision);
+}
+
+/* Function to subtract two big numbers (see bignum.h) */
+bool Bignum_sub(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision){
+
+  return Bignum_add_signed(a, b, -1, out, precision);
+}
+
+/* Function to multiply two big numbers (see bignum.h) */
+bool Bignum_mul(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision){
+
+  if(a->size == 0 || b->size == 0){
+    Bignum_free(out);
+    return true;
+  }
+
+  uint32_t *limbs = malloc(((size_t) a->size + b->size) * sizeof(uint32_t));
+  if(!limbs || !Bignum_mul_limbs(a->limbs, a->size, b->limbs, b->size, limbs)){
+    free(limbs);
+    return false;
+  }
+
+  Bignum_set_limbs(out, limbs, (size_t) a->size + b->size, a->exponent + b->exponent, a->sign * b->sign, precision);
+  return true;
+}
+
+/* Function to divide a big number by a small integer with the long division
+   It returns false if memory allocation failed
+   It receives the big number, the divisor (not 0), the big number where the result is written and the precision */
+static bool Bignum_div_small(const BigNum *a, uint32_t divisor, BigNum *out, unsigned int precision){
+
+  if(a->size == 0){
+    Bignum_free(out);
+    return true;
+  }
+
+  size_t size = precision + 1;
+  uint32_t *limbs = malloc(size * sizeof(uint32_t));
+  if(!limbs)
+    return false;
+
+  uint64_t remainder = 0;
+  long top = Bignum_top(a);
+
+  for(size_t i=0; i<size; i++){
+
+    long position = top - 1 - (long) i;
+    uint64_t current = remainder * BIGNUM_BASE + (position >= a->exponent ? a->limbs[position - a->exponent] : 0);
+    limbs[size - 1 - i] = current / divisor;
+    remainder = current % divisor;
+  }
+
+  Bignum_set_limbs(out, limbs, size, top - (long) size, a->sign, precision);
+  return true;
+}
+
+/* Function to tell the precision of a Newton iteration, the first iterations do not need all the precision because their result is not correct after some digits
+   It returns the precision, and receives the number of correct digits after the iteration and the final precision */
+static unsigned int Bignum_step_precision(long digits, unsigned int work){
+
+  long limbs = digits / BIGNUM_BASE_DIGITS + BIGNUM_GUARD_LIMBS + 1;
+  return limbs < (long) work ? (unsigned int) limbs : work;
+}
+
+/* Function to compute 1/b with the Newton iteration x = x + x*(1 - b*x), each iteration doubles the correct digits
+   It returns false if memory allocation failed
+   It receives b (finite and not 0), the big number where the result is written and the precision */
+static bool Bignum_reciprocal(const BigNum *b, BigNum *out, unsigned int precision){
+
+  BigNum x, t, one;
+  Bignum_init(&x);
+  Bignum_init(&t);
+  Bignum_init(&one);
+
+  long exponent;
+  double leading = Bignum_leading(b, &exponent);
+  unsigned int work = precision + 1;
+  bool ok = Bignum_from_double(b->sign / leading, &x, work) && Bignum_from_double(1.0, &one, work);
+  x.exponent -= exponent;
+
+  for(long correct = 14; ok && correct < (long) work * BIGNUM_BASE_DIGITS + BIGNUM_BASE_DIGITS; correct *= 2){
+
+    unsigned int step = Bignum_step_precision(correct * 2, work);
+    ok = Bignum_mul(b, &x, &t, step) && Bignum_sub(&one, &t, &t, step) &&
+         Bignum_mul(&x, &t, &t, step) && Bignum_add(&x, &t, &x, step);
+  }
+
+  if(ok)
+    Bignum_move(out, &x, precision);
+
+  Bignum_free(&x);
+
+  Bignum_free(&t);
+  Bignum_free(&one);
+  return ok;
+}
+
+/* Function to divide two big numbers (see bignum.h) */
+bool Bignum_div(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision){
+
+  // Division by 0 is NAN, like in the double evaluation
+  if(b->size == 0){
+    Bignum_set_special(out, BIGNUM_NAN, 1);
+    return true;
+  }
+
+  BigNum reciprocal;
+  Bignum_init(&reciprocal);
+
+  bool ok = Bignum_reciprocal(b, &reciprocal, precision + 1) && Bignum_mul(a, &reciprocal, out, precision);
+
+  Bignum_free(&reciprocal);
+  return ok;
+}
+
+/* Function to remove the fraction of a big number (rounding towards 0)
+   It receives the big number */
+static void Bignum_trunc(BigNum *num){
+
+  if(num->size == 0 || num->exponent >= 0)
+    return;
+
+  if(Bignum_top(num) <= 0){
+    Bignum_free(num);
+    return;
+  }
+
+  size_t drop = -num->exponent;
+  memmove(num->limbs, &num->limbs[drop], (num->size - drop) * sizeof(uint32_t));
+  Bignum_set_limbs(num, num->limbs, num->size - drop, 0, num->sign, num->size);
+}
+
+/* Function to compute the remainder of a division like fmod, a - b*trunc(a/b) with the sign of a (see bignum.h) */
+bool Bignum_mod(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision){
+
+  if(b->size == 0){
+    Bignum_set_special(out, BIGNUM_NAN, 1);
+    return true;
+  }
+
+  if(a->size == 0 || Bignum_compare_abs(a, b) < 0){
+    if(!Bignum_copy(out, a))
+      return false;
+    Bignum_round(out, precision);
+    return true;
+  }
+
+  // The quotient needs all its integer digits, and the remainder is computed exactly
+  long low = a->exponent < b->exponent ? a->exponent : b->exponent;
+  unsigned int quotient_precision = (unsigned int) (Bignum_top(a) - Bignum_top(b)) + 3;
+  unsigned int exact = (unsigned int) (Bignum_top(a) - low) + 3;
+
+  BigNum q, r, divisor;
+  Bignum_init(&q);
+  Bignum_init(&r);
+  Bignum_init(&divisor);
+
+  bool ok = Bignum_div(a, b, &q, quotient_precision) && Bignum_copy(&divisor, b);
+  if(ok){
+
+    Bignum_trunc(&q);
+    ok = Bignum_mul(b, &q, &r, exact) && Bignum_sub(a, &r, &r, exact);
+  }
+
+  // The quotient can be 1 unit away, the remainder must have the sign of a and be smaller than b
+  divisor.sign = a->sign;
+
+  if(ok && r.size != 0 && r.sign != a->sign)
+    ok = Bignum_add(&r, &divisor, &r, exact);
+  else if(ok && Bignum_compare_abs(&r, b) >= 0)
+    ok = Bignum_sub(&r, &divisor, &r, exact);
+
+  if(ok)
+    Bignum_move(out, &r, precision);
+
+  Bignum_free(&r);
+
+  Bignum_free(&q);
+  Bignum_free(&divisor);
+  return ok;
+}
+
+/* Function to compute the square root with the Newton iteration of 1/sqrt(a): y = y + y*(1 - a*y^2)/2, then sqrt(a) = a*y (see bignum.h) */
+bool Bignum_sqrt(const BigNum *a, BigNum *out, unsigned int precision){
+
+  if(a->size == 0){
+    Bignum_free(out);
+    return true;
+  }
+
+  if(a->sign < 0){
+    Bignum_set_special(out, BIGNUM_NAN, 1);
+    return true;
+  }
+
+  BigNum y, t, s, one, half;
+  Bignum_init(&y);
+  Bignum_init(&t);
+  Bignum_init(&s);
+  Bignum_init(&one);
+  Bignum_init(&half);
+
+  // The exponent of the first guess must be even, so it can be halved
+  long exponent;
+  double leading = Bignum_leading(a, &exponent);
+  if(exponent & 1){
+    leading *= BIGNUM_BASE;
+    exponent--;
+  }
+
+  unsigned int work = precision + 1;
+  bool ok = Bignum_from_double(1.0 / sqrt(leading), &y, work) && Bignum_from_double(1.0, &one, work) && Bignum_from_double(0.5, &half, work);
+  y.exponent -= exponent / 2;
+
+  for(long correct = 14; ok && correct < (long) work * BIGNUM_BASE_DIGITS + BIGNUM_BASE_DIGITS; correct *= 2){
+
+    unsigned int step = Bignum_step_precision(correct * 2, work);
+    ok = Bignum_mul(&y, &y, &t, step) && Bignum_mul(a, &t, &t, step) && Bignum_sub(&one, &t, &t, step) &&
+         Bignum_mul(&y, &t, &t, step) && Bignum_mul(&t, &half, &t, step) && Bignum_add(&y, &t, &y, step);
+  }
+
+  // Last step for s = a*y: s = s + y*(a - s^2)/2
+  ok = ok && Bignum_mul(a, &y, &s, work) && Bignum_mul(&s, &s, &t, work) && Bignum_sub(a, &t, &t, work) &&
+       Bignum_mul(&y, &t, &t, work) && Bignum_mul(&t, &half, &t, work) && Bignum_add(&s, &t, &s, work);
+
+  if(ok)
+    Bignum_move(out, &s, precision);
+
+  Bignum_free(&s);
+
+  Bignum_free(&y);
+  Bignum_free(&t);
+  Bignum_free(&one);
+  Bignum_free(&half);
+  return ok;
+}
+
+/* Function to compute e^x with the Taylor series of x/2^k, squared k times
+   It returns false if memory allocation failed
+   It receives x (finite), the big number where the result is written and the precision */
+static bool Bignum_exp(const BigNum *x, BigNum *out, unsigned int precision){
+
+  double approximation = Bignum_to_double(x);
+
+  if(fabs(approximation) > BIGNUM_MAX_EXP_ARGUMENT){
+    if(approximation > 0)
+      Bignum_set_special(out, BIGNUM_INFINITE, 1);
+    else
+      Bignum_free(out);
+    return true;
+  }
+
+  // The series converges fast when the argument is small, each halving costs a squaring and some precision
+  int binary_exponent = 0;
+  frexp(approximation, &binary_exponent);
+  int halvings = (binary_exponent > 0 ? binary_exponent : 0) + (int) sqrt(precision * 30.0);
+  unsigned int work = precision + 2 + halvings / 29;
+
+  BigNum r, term, sum;
+  Bignum_init(&r);
+  Bignum_init(&term);
+  Bignum_init(&sum);
+
+  bool ok = Bignum_copy(&r, x) && Bignum_from_double(1.0, &term, work) && Bignum_from_double(1.0, &sum, work);
+
+  for(int left = halvings; ok && left > 0; left -= 29)
+    ok = Bignum_div_small(&r, 1U << (left < 29 ? left : 29), &r, work);
+
+  for(uint32_t i=1; ok; i++){
+
+    // The terms get smaller, so they need less limbs to be correct up to the last limb of the sum
+    long needed = (long) work - (Bignum_top(&sum) - Bignum_top(&term)) + 1;
+    unsigned int step = needed < 2 ? 2 : (unsigned int) needed;
+
+    ok = Bignum_mul(&term, &r, &term, step) && Bignum_div_small(&term, i, &term, step);
+    if(!ok || term.size == 0 || Bignum_top(&term) < Bignum_top(&sum) - (long) work - 1)
+      break;
+
+    ok = Bignum_add(&sum, &term, &sum, work);
+  }
+
+  for(int i=0; ok && i<halvings; i++)
+    ok = Bignum_mul(&sum, &sum, &sum, work);
+
+  if(ok)
+    Bignum_move(out, &sum, precision);
+
+  Bignum_free(&sum);
+
+  Bignum_free(&r);
+  Bignum_free(&term);
+  return ok;
+}
+
+/* Function to compute ln(x) with the Halley iteration y = y + 2*(x - e^y)/(x + e^y), each iteration triples the correct digits
+   It returns false if memory allocation failed
+   It receives x (finite and positive), the big number where the result is written and the precision */
+static bool Bignum_ln(const BigNum *x, BigNum *out, unsigned int precision){
+
+  BigNum y, e, numerator, denominator;
+  Bignum_init(&y);
+  Bignum_init(&e);
+  Bignum_init(&numerator);
+  Bignum_init(&denominator);
+
+  long exponent;
+  double leading = Bignum_leading(x, &exponent);
+  unsigned int work = precision + 2;
+  bool ok = Bignum_from_double(log(leading) + exponent * log((double) BIGNUM_BASE), &y, work);
+
+  for(long correct = 14; ok && correct < (long) work * BIGNUM_BASE_DIGITS + BIGNUM_BASE_DIGITS; correct *= 3){
+
+    unsigned int step = Bignum_step_precision(correct * 3, work);
+    ok = Bignum_exp(&y, &e, step) && Bignum_sub(x, &e, &numerator, step) && Bignum_add(x, &e, &denominator, step) &&
+         Bignum_div(&numerator, &denominator, &numerator, step) && Bignum_add(&numerator, &numerator, &numerator, step) &&
+         Bignum_add(&y, &numerator, &y, step);
+  }
+
+  if(ok)
+    Bignum_move(out, &y, precision);
+
+  Bignum_free(&y);
+
+  Bignum_free(&e);
+  Bignum_free(&numerator);
+  Bignum_free(&denominator);
+  return ok;
+}
+
+/* Function to compute a^b, integer exponents use exponentiation by squaring and the others e^(b*ln(a)) (see bignum.h) */
+bool Bignum_pow(const BigNum *a, const BigNum *b, BigNum *out, unsigned int precision){
+
+  BigNum base, result;
+  Bignum_init(&base);
+  Bignum_init(&result);
+  bool ok;
+
+  // Integer exponents smaller than 10^9
+  if(Bignum_is_integer(b) && (b->size == 0 || Bignum_top(b) <= 1)){
+
+    uint64_t n = 0;
+    for(unsigned int i=b->size; i-->0; )
+      n = n * BIGNUM_BASE + b->limbs[i];
+    for(long i=0; i<b->exponent; i++)
+      n *= BIGNUM_BASE;
+
+    if(a->size == 0){
+      if(n == 0)
+        ok = Bignum_from_double(1.0, out, precision);
+      else{
+        ok = true;
+        if(b->sign < 0)
+          Bignum_set_special(out, BIGNUM_INFINITE, 1);
+        else
+          Bignum_free(out);
+      }
+      return ok;
+    }
+
+    unsigned int work = precision + 1;
+    ok = Bignum_copy(&base, a) && Bignum_from_double(1.0, &result, work);
+
+    while(ok && n){
+
+      if(n & 1)
+        ok = Bignum_mul(&result, &base, &result, work);
+      n >>= 1;
+      if(ok && n)
+        ok = Bignum_mul(&base, &base, &base, work);
+    }
+
+    if(ok && b->sign < 0)
+      ok = Bignum_reciprocal(&result, &result, work);
+  }
+
+  else{
+
+    // Negative bases only have a real power for integer exponents (too big ones here, their parity is the parity of the last limb)
+    int sign = 1;
+    if(a->sign < 0 && a->size != 0){
+
+      if(!Bignum_is_integer(b)){
+        Bignum_set_special(out, BIGNUM_NAN, 1);
+        return true;
+      }
+      sign = (b->exponent == 0 && (b->limbs[0] & 1)) ? -1 : 1;
+    }
+
+    if(a->size == 0){
+      if(b->sign < 0)
+        Bignum_set_special(out, BIGNUM_INFINITE, 1);
+      else
+        Bignum_free(out);
+      return true;
+    }
+
+    unsigned int work = precision + 1;
+    ok = Bignum_copy(&base, a);
+    base.sign = 1;
+    ok = ok && Bignum_ln(&base, &base, work) && Bignum_mul(&base, b, &base, work) && Bignum_exp(&base, &result, work);
+    result.sign = sign;
+  }
+
+  if(ok)
+    Bignum_move(out, &result, precision);
+
+  Bignum_free(&result);
+  Bignum_free(&base);
+  return ok;
+}
+
+// ------------------------------------------------ Evaluation ------------------------------------------------
+
+/* Function to compute a operation with doubles, used when a operand is NAN or infinite
+   It returns the result and receives the opcode and the operands (b is not used by unary operations) */
+static double Bignum_special_operation(Opcode op, double a, double b){
+
+  switch(op){
+    case OP_NEG:  return -a;
+    case OP_SQRT: return sqrt(a);
+    case OP_ADD:  return a + b;
+    case OP_SUB:  return a - b;
+    case OP_MUL:  return a * b;
+    case OP_DIV:  return b == 0.0 ? NAN : a / b;
+    case OP_MOD:  return fmod(a, b);
+    case OP_POW:  return pow(a, b);
+    default:      return NAN;
+  }
+}
+
+/* Function to evaluate the bytecode with big numbers, the result of each operation is rounded to the precision
+   The bytecode must not be optimized (the optimizer folds constants as doubles) and must not have variables
+   It returns false if the bytecode has variables or memory allocation failed
+   It receives a reference to the bytecode, its constant pool as big numbers, the precision (see Bignum_precision) and the big number where the result is written */
+bool Bignum_evaluate(const Bytecode *bytecode, const BigNum *constants, unsigned int precision, BigNum *result){
+
+  if(bytecode->variable_count > 0)
+    return false;
+
+  // The empty expression is 0, like in the double evaluation
+  if(bytecode->size == 0){
+    Bignum_free(result);
+    return true;
+  }
+
+  BigNum *stack = calloc(bytecode->max_depth, sizeof(BigNum));
+  if(!stack)
+    return false;
+
+  for(unsigned int i=0; i<bytecode->max_depth; i++)
+    Bignum_init(&stack[i]);
+
+  unsigned int top = 0;
+  bool ok = true;
+
+  for(unsigned int i=0; ok && i<bytecode->size; i++){
+
+    const Instruction *instruction = &bytecode->code[i];
+    BigNum *a = top >= 2 ? &stack[top-2] : NULL;
+    BigNum *b = top >= 1 ? &stack[top-1] : NULL;
+
+    switch(instruction->op){
+
+      case OP_CONST:
+        ok = Bignum_copy(&stack[top++], &constants[instruction->arg]);
+        continue;
+
+      case OP_DUP:
+        ok = Bignum_copy(&stack[top], b);
+        top++;
+        continue;
+
+      case OP_VAR:
+        ok = false;
+        continue;
+
+      case OP_NEG:
+        b->sign = -b->sign;
+        continue;
+
+      case OP_SQRT:
+        if(b->kind != BIGNUM_FINITE)
+          ok = Bignum_from_double(Bignum_special_operation(OP_SQRT, Bignum_to_double(b), 0.0), b, precision);
+        else
+          ok = Bignum_sqrt(b, b, precision);
+        continue;
+
+      default:
+        break;
+    }
+
+    // Binary operations, the result replaces a
+    if(a->kind != BIGNUM_FINITE || b->kind != BIGNUM_FINITE)
+      ok = Bignum_from_double(Bignum_special_operation(instruction->op, Bignum_to_double(a), Bignum_to_double(b)), a, precision);
+
+    else switch(instruction->op){
+      case OP_ADD: ok = Bignum_add(a, b, a, precision); break;
+      case OP_SUB: ok = Bignum_sub(a, b, a, precision); break;
+      case OP_MUL: ok = Bignum_mul(a, b, a, precision); break;
+      case OP_DIV: ok = Bignum_div(a, b, a, precision); break;
+      case OP_MOD: ok = Bignum_mod(a, b, a, precision); break;
+      case OP_POW: ok = Bignum_pow(a, b, a, precision); break;
+      default:     ok = false; break;
+    }
+
+    Bignum_free(b);
+    top--;
+  }
+
+  if(ok){
+    Bignum_free(result);
+    *result = stack[0];
+    Bignum_init(&stack[0]);
+  }
+
+  for(unsigned int i=0; i<bytecode->max_depth; i++)
+    Bignum_free(&stack[i]);
+
+  free(stack);
+  return ok;
+}
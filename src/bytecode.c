@@ -0,0 +1,707 @@
+/* This program is part of the math interpreter, it lowers an expression in RPN into a compact bytecode (opcodes + constant pool)
+   and implements the interpreter loop that evaluates it. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "../include/bytecode.h"
+#include "../include/datastructures.h"
+#include "../include/parser.h"
+#include "../include/kernels.h"
+
+#define BYTECODE_BLOCK_SIZE 256 // Number of rows evaluated by each operation in the batch evaluation
+
+/* Function to return the opcode of an operator or function token
+   It returns true if the token is known
+   It receives the kind of the token and a reference to where the opcode is written */
+bool Bytecode_opcode_of(TokenKind tok, Opcode *op){
+
+  switch(tok){
+    case TOK_NEGATE:   *op = OP_NEG;  break;
+    case TOK_SQRT:     *op = OP_SQRT; break;
+    case TOK_PLUS:     *op = OP_ADD;  break;
+    case TOK_MINUS:    *op = OP_SUB;  break;
+    case TOK_MULTIPLY: *op = OP_MUL;  break;
+    case TOK_DIVIDE:   *op = OP_DIV;  break;
+    case TOK_MOD:      *op = OP_MOD;  break;
+    case TOK_POWER:    *op = OP_POW;  break;
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+/* Function to allocate memory from the arena or, if there is no arena, with malloc
+   It returns a pointer to the memory, and receives the arena (can be NULL) and the number of bytes */
+static void *Bytecode_alloc(Arena *arena, size_t size){
+
+  if(arena)
+    return Arena_alloc(arena, size);
+
+  return malloc(size ? size : 1);
+}
+
+/* Function to return the index of a variable token, adding the variable to the bytecode if it is new
+   It returns the index of the variable
+   It receives a reference to the bytecode, the variable token, the expression it came from and the pool where the names are written */
+static unsigned int Bytecode_add_variable(Bytecode *bytecode, const Token *tok, const char *expression, char **names_pool){
+
+  const char *name = &expression[tok->offset];
+
+  for(unsigned int i=0; i<bytecode->variable_count; i++){
+
+    if(strlen(bytecode->variables[i]) == tok->length && strncmp(bytecode->variables[i], name, tok->length) == 0)
+      return i;
+  }
+
+  char *new_name = *names_pool;
+  memcpy(new_name, name, tok->length);
+  new_name[tok->length] = '\0';
+  *names_pool += tok->length + 1;
+
+  bytecode->variables[bytecode->variable_count] = new_name;
+  return bytecode->variable_count++;
+}
+
+/* Function to return how a operation changes the number of values in the stack
+   It returns +1 for operations that push a value, 0 for unary operations and -1 for binary operations
+   It receives the opcode */
+static int Bytecode_stack_effect(Opcode op){
+
+  switch(op){
+    case OP_CONST:
+    case OP_VAR:
+    case OP_DUP:
+      return 1;
+    case OP_NEG:
+    case OP_SQRT:
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+/* Function to calculate the maximum number of values in the stack during the evaluation of the bytecode
+   It returns the maximum depth of the stack and receives a reference to the bytecode */
+static unsigned int Bytecode_max_depth(const Bytecode *bytecode){
+
+  int depth = 0;
+  unsigned int max_depth = 0;
+
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    depth += Bytecode_stack_effect(bytecode->code[i].op);
+    if(depth > (int) max_depth)
+      max_depth = depth;
+  }
+
+  return max_depth;
+}
+
+/* Function to convert a TOK_END terminated array of tokens in RPN into bytecode
+   The numbers are already converted by the lexer, so they only have to be copied into the constant pool
+   It returns true if the conversion succeeded (false if there is a unknown token or memory allocation failed)
+   It receives a TOK_END terminated array in RPN, the expression the tokens came from (needed for the names of the variables, can be NULL if there is no variable),
+   a reference to the bytecode to fill and the arena to allocate from (NULL to use malloc) */
+bool Bytecode_from_rpn(const Token *rpn, const char *expression, Bytecode *bytecode, Arena *arena){
+
+  unsigned int total_tokens = 0;
+  unsigned int total_numbers = 0;
+  unsigned int total_variables = 0;
+  size_t names_size = 0;
+
+  for(; rpn[total_tokens].kind!=TOK_END; total_tokens++){
+
+    if(Parser_is_number(rpn[total_tokens].kind))
+      total_numbers++;
+    else if(rpn[total_tokens].kind == TOK_VARIABLE){
+      total_variables++;
+      names_size += rpn[total_tokens].length + 1;
+    }
+  }
+
+  bytecode->arena = arena;
+  bytecode->size = bytecode->constant_count = bytecode->variable_count = bytecode->max_depth = 0;
+
+  bytecode->code = Bytecode_alloc(arena, total_tokens * sizeof(Instruction));
+  bytecode->constants = Bytecode_alloc(arena, total_numbers * sizeof(double));
+  bytecode->variables = Bytecode_alloc(arena, total_variables * sizeof(char*) + names_size);
+
+  if(!bytecode->code || !bytecode->constants || !bytecode->variables || (total_variables && !expression)){
+
+    Bytecode_free(bytecode);
+    return false;
+  }
+
+  char *names_pool = (char*) &bytecode->variables[total_variables]; // The names are stored right after the array of pointers
+
+  for(unsigned int i=0; i<total_tokens; i++){
+
+    const Token *tok = &rpn[i];
+    Instruction *instruction = &bytecode->code[bytecode->size++];
+
+    // If its a number, store it in the constant pool
+    if(Parser_is_number(tok->kind)){
+
+      instruction->op = OP_CONST;
+      instruction->arg = bytecode->constant_count;
+      bytecode->constants[bytecode->constant_count++] = tok->value;
+    }
+
+    // If its a variable, find its index
+    else if(tok->kind == TOK_VARIABLE){
+
+      instruction->op = OP_VAR;
+      instruction->arg = Bytecode_add_variable(bytecode, tok, expression, &names_pool);
+    }
+
+    // If its an operator or function
+    else{
+
+      instruction->arg = 0;
+      if(!Bytecode_opcode_of(tok->kind, &instruction->op)){
+
+        Bytecode_free(bytecode);
+        return false;
+      }
+    }
+  }
+
+  bytecode->max_depth = Bytecode_max_depth(bytecode);
+  return true;
+}
+
+/* Function to return the kernel of a binary operation
+   It returns the kernel, and receives the kernels of the instruction set and the opcode */
+static BinaryKernel Bytecode_binary_kernel(const KernelTable *kernels, Opcode op){
+
+  switch(op){
+    case OP_ADD: return kernels->add;
+    case OP_SUB: return kernels->sub;
+    case OP_MUL: return kernels->mul;
+    case OP_DIV: return kernels->div;
+    case OP_MOD: return kernels->mod;
+    default:     return kernels->pow;
+  }
+}
+
+// Value of the stack during the optimization
+typedef struct{
+
+  unsigned int start;        // Index of the first instruction that computes the value
+  bool is_constant;          // True if the value is known before the evaluation
+  BytecodeConstant constant; // The value, if it is constant
+} OptimizerValue;
+
+/* Function to execute one operation over constant values, with the same semantics of the evaluation (like NAN on division by 0)
+   It returns the result and receives the opcode and the operands (b is ignored by unary operations) */
+static double Bytecode_fold(Opcode op, double a, double b){
+
+  const KernelTable *scalar = Kernels_table(KERNELS_SCALAR);
+  double result = 0.0;
+
+  switch(op){
+    case OP_NEG:  scalar->neg(&result, &a, 1);      break;
+    case OP_SQRT: scalar->sqrt(&result, &a, 1);     break;
+    default:      Bytecode_binary_kernel(scalar, op)(&result, &a, &b, 1); break;
+  }
+
+  return result;
+}
+
+/* Function to tell if a double is a integer that fits in 64 bits
+   It returns true if it is, and receives the double and where the integer is written */
+static bool Bytecode_integer_of(double value, int64_t *integer){
+
+  if(!(value >= -0x1p63 && value < 0x1p63) || value != trunc(value))
+    return false;
+
+  *integer = (int64_t) value;
+  return true;
+}
+
+/* Function to execute one operation over integer constants with 64 bits integers, exact even beyond 2^53 where doubles are rounded
+   It returns false if the operation has no integer path, overflows or is mod by 0 (the double operation is used then)
+   It receives the opcode, the operands and where the result is written */
+static bool Bytecode_fold_integer(Opcode op, int64_t a, int64_t b, int64_t *result){
+
+  switch(op){
+    case OP_ADD: return !__builtin_add_overflow(a, b, result);
+    case OP_SUB: return !__builtin_sub_overflow(a, b, result);
+    case OP_MUL: return !__builtin_mul_overflow(a, b, result);
+    case OP_MOD:
+      if(b == 0)
+        return false;
+      *result = b == -1 ? 0 : a % b; // INT64_MIN % -1 overflows
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* Function to make the constant of a number
+   It returns the constant and receives the number */
+BytecodeConstant Bytecode_constant(double value){
+
+  BytecodeConstant constant = {value, false, 0};
+  constant.is_integer = Bytecode_integer_of(value, &constant.integer);
+  return constant;
+}
+
+/* Function to execute one operation over constants like the constant folding of Bytecode_optimize
+   (so a expression that only has constants has the same result as its compiled bytecode)
+   It returns the result and receives the opcode and the operands (b is ignored by unary operations) */
+BytecodeConstant Bytecode_fold_constant(Opcode op, BytecodeConstant a, BytecodeConstant b){
+
+  double folded = Bytecode_fold(op, a.value, b.value);
+
+  // -x keeps the exact integer, the double keeps the sign of -0
+  if(op == OP_NEG && a.is_integer && a.integer != INT64_MIN){
+    BytecodeConstant negated = {folded, true, -a.integer};
+    return negated;
+  }
+
+  // Integer path when both operands are integers, the double of a 0 result keeps its sign (like 0*-5 = -0)
+  int64_t integer;
+  if(op != OP_NEG && op != OP_SQRT && a.is_integer && b.is_integer && Bytecode_fold_integer(op, a.integer, b.integer, &integer)){
+    BytecodeConstant exact = {integer != 0 ? (double) integer : copysign(0.0, folded), true, integer};
+    return exact;
+  }
+
+  return Bytecode_constant(folded);
+}
+
+/* Function to find the shortest chains of multiplications of the exponents up to KERNELS_MAX_SQUARING_EXPONENT,
+   with the factor method (x^(p*q) = (x^p)^q) and x^n = x*x^(n-1), that only need OP_DUP and OP_MUL in a stack machine
+   It receives the arrays where the cost (number of multiplications) and the step of each exponent are written
+   (step 0 means x*x^(n-1), other steps p mean (x^p)^(n/p)) */
+static void Bytecode_power_chains(unsigned char *cost, unsigned char *step){
+
+  cost[1] = 0;
+  step[1] = 0;
+
+  for(unsigned int n=2; n<=KERNELS_MAX_SQUARING_EXPONENT; n++){
+
+    cost[n] = cost[n-1] + 1;
+    step[n] = 0;
+
+    for(unsigned int p=2; p*p<=n; p++){
+      if(n % p == 0 && cost[p] + cost[n/p] < cost[n]){
+        cost[n] = cost[p] + cost[n/p];
+        step[n] = p;
+      }
+    }
+  }
+}
+
+/* Function to write the chain of multiplications that raises the top of the stack to a exponent
+   It returns the number of instructions written (2 per multiplication)
+   It receives the steps of the chains (see Bytecode_power_chains), the exponent and where the instructions are written */
+static unsigned int Bytecode_write_chain(const unsigned char *step, unsigned int n, Instruction *code){
+
+  if(n == 1)
+    return 0;
+
+  // (x^p)^(n/p)
+  if(step[n] != 0){
+    unsigned int written = Bytecode_write_chain(step, step[n], code);
+    return written + Bytecode_write_chain(step, n / step[n], &code[written]);
+  }
+
+  // x*x^(n-1), the copy of x waits in the stack
+  code[0].op = OP_DUP;
+  code[0].arg = 0;
+  unsigned int written = 1 + Bytecode_write_chain(step, n-1, &code[1]);
+  code[written].op = OP_MUL;
+  code[written].arg = 0;
+  return written + 1;
+}
+
+/* Function to tell if a instruction is the power of a integer constant that becomes a chain of multiplications
+   It returns the exponent (0 if it is not one), and receives the bytecode and the index of the instruction */
+static unsigned int Bytecode_chain_exponent(const Bytecode *bytecode, unsigned int i){
+
+  // The exponent is the last value pushed before the power
+  if(bytecode->code[i].op != OP_POW || i == 0 || bytecode->code[i-1].op != OP_CONST)
+    return 0;
+
+  double exponent = bytecode->constants[bytecode->code[i-1].arg];
+  if(exponent < 2.0 || exponent > KERNELS_MAX_SQUARING_EXPONENT || exponent != trunc(exponent))
+    return 0;
+
+  return (unsigned int) exponent;
+}
+
+/* Function to replace the powers of integer constants by chains of multiplications, like x^6 -> (x*x*x)^2 (DUP DUP MUL MUL DUP MUL)
+   The code is moved to a bigger array, if that allocation fails the powers are kept
+   It receives a reference to the bytecode */
+static void Bytecode_expand_powers(Bytecode *bytecode){
+
+  unsigned char cost[KERNELS_MAX_SQUARING_EXPONENT + 1];
+  unsigned char step[KERNELS_MAX_SQUARING_EXPONENT + 1];
+  bool chains_found = false;
+  unsigned int size = bytecode->size;
+
+  // Each chain replaces 2 instructions (the constant and the power)
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    unsigned int exponent = Bytecode_chain_exponent(bytecode, i);
+    if(exponent){
+      if(!chains_found)
+        Bytecode_power_chains(cost, step);
+      chains_found = true;
+      size += 2*cost[exponent] - 2;
+    }
+  }
+
+  if(!chains_found)
+    return;
+
+  Instruction *code = Bytecode_alloc(bytecode->arena, size * sizeof(Instruction));
+  if(!code)
+    return;
+
+  unsigned int written = 0;
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    unsigned int exponent = i+1 < bytecode->size ? Bytecode_chain_exponent(bytecode, i+1) : 0;
+    if(exponent){
+      written += Bytecode_write_chain(step, exponent, &code[written]);
+      i++;
+    }
+    else
+      code[written++] = bytecode->code[i];
+  }
+
+  if(bytecode->arena == NULL)
+    free(bytecode->code);
+
+  bytecode->code = code;
+  bytecode->size = written;
+}
+
+/* Function to optimize the bytecode, it must be called before the evaluation. It does:
+   - constant folding: operations whose operands are all constants are replaced by their result, like sqrt(9) -> 3
+     + - * and % of integer constants are folded with 64 bits integers (exact beyond 2^53), or as doubles if they overflow
+   - identities: x*1, 1*x, x+0, 0+x, x-0, x/1 and x^1 become x, and -(-x) becomes x
+   - strength reduction: x^0.5 becomes sqrt(x), and x^n with a integer constant n from 2 to KERNELS_MAX_SQUARING_EXPONENT
+     becomes a chain of multiplications (with OP_DUP), like x^2 -> x*x
+   Division by 0 still results in NAN, folded or not. The only differences are x^0.5 when x is -0 or -infinity (sqrt gives -0 and NAN, pow gives 0 and infinity),
+   x+0 when x is -0 (the result keeps the sign) and the last digits of the integer powers (like the squaring loop of the evaluation)
+   The bytecode is rewritten in place, it only grows when powers become chains of multiplications (if that allocation fails they are kept as powers)
+   It returns true if the optimization succeeded (false if memory allocation failed, the bytecode is not changed)
+   It receives a reference to the bytecode */
+bool Bytecode_optimize(Bytecode *bytecode){
+
+  OptimizerValue *stack = Bytecode_alloc(bytecode->arena, bytecode->size * sizeof(OptimizerValue));
+  if(!stack)
+    return false;
+
+  Instruction *code = bytecode->code;
+  double *constants = bytecode->constants;
+  unsigned int depth = 0;
+  unsigned int size = 0; // Number of instructions already written, always <= i
+
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    Instruction instruction = code[i];
+
+    // Operands
+    if(instruction.op == OP_CONST || instruction.op == OP_VAR){
+
+      stack[depth].start = size;
+      stack[depth].is_constant = instruction.op == OP_CONST;
+      stack[depth].constant = Bytecode_constant(instruction.op == OP_CONST ? constants[instruction.arg] : 0.0);
+      depth++;
+
+      code[size++] = instruction;
+      continue;
+    }
+
+    // Unary operations
+    if(Bytecode_stack_effect(instruction.op) == 0){
+
+      OptimizerValue *a = &stack[depth-1];
+
+      // Constant folding, the result uses the slot of the constant pool of the operand
+      if(a->is_constant){
+        a->constant = Bytecode_fold_constant(instruction.op, a->constant, a->constant);
+        constants[code[a->start].arg] = a->constant.value;
+      }
+
+      // -(-x) = x
+      else if(instruction.op == OP_NEG && code[size-1].op == OP_NEG)
+        size--;
+
+      else
+        code[size++] = instruction;
+
+      continue;
+    }
+
+    // Binary operations
+    OptimizerValue *a = &stack[depth-2];
+    OptimizerValue *b = &stack[depth-1];
+    depth--;
+
+    // Constant folding, the result uses the slot of the constant pool of the first operand
+    if(a->is_constant && b->is_constant){
+
+      a->constant = Bytecode_fold_constant(instruction.op, a->constant, b->constant);
+      constants[code[a->start].arg] = a->constant.value;
+      size = a->start+1;
+      continue;
+    }
+
+    bool b_is_one  = b->is_constant && b->constant.value == 1.0;
+    bool b_is_zero = b->is_constant && b->constant.value == 0.0;
+    bool a_is_one  = a->is_constant && a->constant.value == 1.0;
+    bool a_is_zero = a->is_constant && a->constant.value == 0.0;
+
+    // x*1, x+0, x-0, x/1 and x^1 = x: remove the constant and the operation
+    if((b_is_one && (instruction.op == OP_MUL || instruction.op == OP_DIV || instruction.op == OP_POW)) ||
+       (b_is_zero && (instruction.op == OP_ADD || instruction.op == OP_SUB))){
+
+      size = b->start;
+    }
+
+    // 1*x and 0+x = x: remove the constant (the first instruction of a) and the operation
+    else if((a_is_one && instruction.op == OP_MUL) || (a_is_zero && instruction.op == OP_ADD)){
+
+      memmove(&code[a->start], &code[a->start+1], (size - a->start - 1) * sizeof(Instruction));
+      size--;
+      a->is_constant = false;
+    }
+
+    // x^0.5 = sqrt(x)
+    else if(instruction.op == OP_POW && b->is_constant && b->constant.value == 0.5){
+
+      size = b->start;
+      code[size].op = OP_SQRT;
+      code[size++].arg = 0;
+    }
+
+    else{
+
+      code[size++] = instruction;
+      a->is_constant = false;
+    }
+  }
+
+  if(bytecode->arena == NULL)
+    free(stack);
+
+  bytecode->size = size;
+  Bytecode_expand_powers(bytecode);
+  code = bytecode->code;
+  size = bytecode->size;
+
+  // Remove the constants that are not used anymore
+  unsigned int constant_count = 0;
+  for(unsigned int i=0; i<size; i++){
+
+    if(code[i].op == OP_CONST){
+      constants[constant_count] = constants[code[i].arg];
+      code[i].arg = constant_count++;
+    }
+  }
+  bytecode->constant_count = constant_count;
+
+  bytecode->max_depth = Bytecode_max_depth(bytecode);
+  return true;
+}
+
+/* Function to return the index of a variable in the bytecode
+   It returns the index or -1 if the bytecode does not use the variable
+   It receives a reference to the bytecode and the name of the variable */
+int Bytecode_variable_index(const Bytecode *bytecode, const char *name){
+
+  for(unsigned int i=0; i<bytecode->variable_count; i++){
+
+    if(strcmp(bytecode->variables[i], name) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+/* Function to evaluate the bytecode
+   Division (or mod) by 0 and the square root of negative numbers result in NAN
+   It returns the result of the expression in double format
+   It receives a reference to the bytecode, the values of the variables (by index, can be NULL if there is no variable)
+   and the arena used for the stack of values (NULL to use malloc) */
+double Bytecode_evaluate(const Bytecode *bytecode, const double *variables, Arena *arena){
+
+  // The depth of the stack is known, so the memory is allocated once (or never, if it fits in the inline storage)
+  DoubleStack values;
+  DoubleStack_init(&values, arena);
+  if(!DoubleStack_reserve(&values, bytecode->max_depth))
+    return NAN;
+
+  const Instruction *code = bytecode->code;
+  const double *constants = bytecode->constants;
+
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    double a, b;
+
+    switch(code[i].op){
+
+      case OP_CONST:
+        DoubleStack_push(&values, constants[code[i].arg]);
+        break;
+      case OP_VAR:
+        DoubleStack_push(&values, variables ? variables[code[i].arg] : NAN);
+        break;
+
+      case OP_DUP:
+        DoubleStack_push(&values, DoubleStack_peek(&values));
+        break;
+
+      // Unary functions
+      case OP_NEG:
+        DoubleStack_push(&values, -DoubleStack_pop(&values));
+        break;
+      case OP_SQRT:
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, a<0 ? NAN : sqrt(a)); // If the number is negative -> NAN
+        break;
+
+      // Binary functions
+      case OP_ADD:
+        b = DoubleStack_pop(&values);
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, a + b);
+        break;
+      case OP_SUB:
+        b = DoubleStack_pop(&values);
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, a - b);
+        break;
+      case OP_MUL:
+        b = DoubleStack_pop(&values);
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, a * b);
+        break;
+      case OP_DIV:
+        b = DoubleStack_pop(&values);
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, b==0.0 ? NAN : a / b); // Division by 0 -> NAN
+        break;
+      case OP_MOD:
+        b = DoubleStack_pop(&values);
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, b==0.0 ? NAN : fmod(a, b)); // Division by 0 -> NAN
+        break;
+      case OP_POW:
+        b = DoubleStack_pop(&values);
+        a = DoubleStack_pop(&values);
+        DoubleStack_push(&values, Kernels_pow(a, b)); // Squaring loop for integer exponents
+        break;
+    }
+  }
+
+  double final_result = DoubleStack_pop(&values);
+  DoubleStack_free(&values);
+
+  return final_result;
+}
+
+/* Function to evaluate the bytecode for many rows at once, each operation is executed for a whole block of rows before the next one
+   The operations use the SIMD kernels of the best instruction set of the CPU (see kernels.h)
+   Each position of the stack points to a block of values: variables point directly to their columns, the other values are written
+   in a buffer owned by the position, so there is no copy of the input
+   It returns true if the evaluation succeeded (false if memory allocation failed)
+   It receives a reference to the bytecode, one column of values per variable (by index), the number of rows,
+   the array where the results are written (one per row) and the arena used for the stack of blocks (NULL to use malloc) */
+bool Bytecode_evaluate_batch(const Bytecode *bytecode, const double *const *columns, size_t rows, double *out, Arena *arena){
+
+  unsigned int max_depth = bytecode->max_depth ? bytecode->max_depth : 1;
+
+  size_t stack_size = max_depth * (BYTECODE_BLOCK_SIZE * sizeof(double) + sizeof(double*) + sizeof(const double*));
+  double *buffers = Bytecode_alloc(arena, stack_size);
+  if(!buffers)
+    return false;
+
+  double **buffer = (double**) &buffers[max_depth * BYTECODE_BLOCK_SIZE]; // Buffer of each position of the stack
+  const double **slot = (const double**) &buffer[max_depth];            // Values of each position of the stack
+
+  for(unsigned int d=0; d<max_depth; d++)
+    buffer[d] = &buffers[d * BYTECODE_BLOCK_SIZE];
+
+  const Instruction *code = bytecode->code;
+  const KernelTable *kernels = Kernels_best();
+
+  for(size_t row=0; row<rows; row+=BYTECODE_BLOCK_SIZE){
+
+    unsigned int count = (rows-row) < BYTECODE_BLOCK_SIZE ? (unsigned int)(rows-row) : BYTECODE_BLOCK_SIZE;
+    unsigned int depth = 0;
+
+    for(unsigned int i=0; i<bytecode->size; i++){
+
+      switch(code[i].op){
+
+        case OP_CONST:
+          for(unsigned int j=0; j<count; j++)
+            buffer[depth][j] = bytecode->constants[code[i].arg];
+          slot[depth] = buffer[depth];
+          depth++;
+          break;
+
+        case OP_VAR:
+          slot[depth] = &columns[code[i].arg][row];
+          depth++;
+          break;
+
+        case OP_DUP:
+          slot[depth] = slot[depth-1];
+          depth++;
+          break;
+
+        // Unary functions
+        case OP_NEG:
+        case OP_SQRT:
+          (code[i].op == OP_NEG ? kernels->neg : kernels->sqrt)(buffer[depth-1], slot[depth-1], count);
+          slot[depth-1] = buffer[depth-1];
+          break;
+
+        // Binary functions
+        default:
+          Bytecode_binary_kernel(kernels, code[i].op)(buffer[depth-2], slot[depth-2], slot[depth-1], count);
+          slot[depth-2] = buffer[depth-2];
+          depth--;
+          break;
+      }
+    }
+
+    if(depth > 0)
+      memcpy(&out[row], slot[0], count * sizeof(double));
+    else
+      memset(&out[row], 0, count * sizeof(double));
+  }
+
+  if(!arena)
+    free(buffers);
+
+  return true;
+}
+
+/* Function to free the memory of the bytecode (memory of a arena is only released by Arena_reset)
+   It receives a reference to the bytecode */
+void Bytecode_free(Bytecode *bytecode){
+
+  if(!bytecode->arena){
+    free(bytecode->code);
+    free(bytecode->constants);
+    free(bytecode->variables);
+  }
+  bytecode->code = NULL;
+  bytecode->constants = NULL;
+  bytecode->variables = NULL;
+  bytecode->size = bytecode->constant_count = bytecode->variable_count = bytecode->max_depth = 0;
+}
@@ -0,0 +1,695 @@
+/* This program is a headless calculator, it evaluates the expressions of files (or of the standard input), one per line,
+   and writes one result per line. Files are mapped in memory (the standard input is read in big blocks),
+   split in chunks that end at a new line and the chunks are evaluated by a thread pool. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/math_interpreter.h"
+#include "../include/format.h"
+
+#define CALC_BLOCK_SIZE (4 << 20)   // Bytes read from the input at once (it grows if a line is longer)
+#define CALC_MAP_WINDOW (64 << 20)  // Bytes of a mapped file evaluated before their results are written
+#define CALC_TASK_BYTES (256 << 10) // Bytes of lines evaluated by each task of the thread pool
+#define CALC_OUTPUT_BUFFER (1 << 20) // Size of the buffer of the standard output
+
+// Exit status
+#define CALC_EXIT_OK 0         // Every expression was evaluated
+#define CALC_EXIT_EXPRESSION 1 // At least one expression has a error
+#define CALC_EXIT_FAILURE 2    // Wrong options, input that can not be read or memory allocation failure
+
+#define CALC_OPTIONS_INVALID (-1) // Returned by Calc_parse_options when a option is not valid
+#define CALC_OPTIONS_HELP (-2)    // Returned by Calc_parse_options when the help was shown
+
+typedef enum{
+
+  CALC_ERRORS_PRINT, // Write "error" as the result of the line
+  CALC_ERRORS_SKIP,  // Write nothing for the line
+  CALC_ERRORS_ABORT  // Stop at the first error, with a message in the standard error
+} ErrorPolicy;
+
+typedef struct{
+
+  char style;           // Style of the results: 's' (shortest text that reads back as the same double), 'g', 'e' or 'f' (like in printf), or 'r' (exact fractions)
+  int precision;        // Precision of the results (like in printf)
+  ErrorPolicy errors;   // What to do with the lines that have a error
+  unsigned int threads; // Number of threads (0 to use one per CPU)
+  bool map;             // True to map the regular files in memory instead of reading them
+  unsigned int digits;  // Significant digits of the results evaluated with arbitrary precision (0 to use doubles)
+} CalcOptions;
+
+/* Growable array of chars where a task writes its results */
+typedef struct{
+
+  char *data;
+  size_t size;
+  size_t cap;
+} OutputBuffer;
+
+/* Chunk of a piece of the input evaluated by a task, and its result */
+typedef struct{
+
+  const char *begin;    // First char of the chunk (the chunks begin and end at new lines)
+  const char *end;      // Char after the chunk
+  OutputBuffer output;  // Results of the lines of the chunk
+  size_t line_count;    // Number of lines evaluated
+  size_t error_count;   // Number of lines with a error
+  bool stopped;         // True if a error stopped the task (CALC_ERRORS_ABORT), the line that stopped it is the last one counted
+  ParseError error;     // Error of that line
+  bool out_of_memory;   // True if the output could not be written
+} CalcTask;
+
+/* Piece of the input split in chunks, shared by the tasks of a run of the thread pool */
+typedef struct{
+
+  CalcTask *tasks;        // One per chunk
+  size_t task_count;
+  size_t task_cap;
+  const CalcOptions *options;
+  MathContext **contexts; // One per worker of the pool
+} CalcBlock;
+
+/* Function to print how to use the program
+   It receives the stream where it is written and the name of the program */
+static void Calc_usage(FILE *stream, const char *program){
+
+  fprintf(stream,
+          "Usage: %s [options] [file...]\n"
+          "Evaluates the expressions of the files (or of the standard input, also with -), one per line.\n"
+          "Each result is written in its own line, blank lines are kept.\n"
+          "\n"
+          "Options:\n"
+          "  -f STYLE      style of the results: s (shortest text that reads back as the same number, default)\n"
+          "                g, e or f, like in printf, or r (evaluate with exact fractions, like 1/3)\n"
+          "  -p DIGITS     precision of the results for the styles g, e and f (default 17)\n"
+          "  -d DIGITS     evaluate with arbitrary precision, the results have DIGITS significant digits\n"
+          "                (default 0, that evaluates with doubles)\n"
+          "  -e POLICY     what to do with a line that has a error: print (write \"error\", default),\n"
+          "                skip (write nothing) or abort (stop with a message)\n"
+          "  -j THREADS    number of threads (default 1, 0 to use one per CPU)\n"
+          "  -i MODE       how files are read: map (map them in memory, default) or read\n"
+          "  -h            show this help\n"
+          "\n"
+          "Exit status: %d if every expression was evaluated, %d if some expression has a error, %d on other failures.\n",
+          program, CALC_EXIT_OK, CALC_EXIT_EXPRESSION, CALC_EXIT_FAILURE);
+}
+
+/* Function to read a non negative number from a option
+   It returns true if the text is a valid number
+   It receives the text and where to write the number */
+static bool Calc_parse_number(const char *text, long *number){
+
+  char *end;
+  errno = 0;
+  *number = strtol(text, &end, 10);
+
+  return text[0] != '\0' && *end == '\0' && errno == 0 && *number >= 0 && *number <= 1000000;
+}
+
+/* Function to read the options of the command line
+   It returns the index of the first file in argv, CALC_OPTIONS_INVALID or CALC_OPTIONS_HELP
+   It receives the arguments of the program and the options to fill */
+static int Calc_parse_options(int argc, char **argv, CalcOptions *options){
+
+  options->style = 's';
+  options->precision = 17;
+  options->errors = CALC_ERRORS_PRINT;
+  options->threads = 1;
+  options->map = true;
+  options->digits = 0;
+
+  int i;
+  for(i=1; i<argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++){
+
+    const char *option = argv[i];
+    long number;
+
+    if(strcmp(option, "--") == 0)
+      return i+1;
+
+    if(strcmp(option, "-h") == 0){
+      Calc_usage(stdout, argv[0]);
+      return CALC_OPTIONS_HELP;
+    }
+
+    // Every other option has a value, in the same argument (-j4) or in the next one (-j 4)
+    bool attached = option[2] != '\0';
+    if(!strchr("fpdeji", option[1]) || (!attached && i+1 >= argc)){
+      fprintf(stderr, "%s: unknown option or missing value: %s\n", argv[0], option);
+      Calc_usage(stderr, argv[0]);
+      return CALC_OPTIONS_INVALID;
+    }
+
+    const char *value = attached ? &option[2] : argv[++i];
+    bool valid = true;
+
+    switch(option[1]){
+      case 'f':
+        valid = strlen(value) == 1 && strchr("sgefr", value[0]);
+        options->style = value[0];
+        break;
+      case 'p':
+        valid = Calc_parse_number(value, &number) && number <= 100;
+        options->precision = number;
+        break;
+      case 'd':
+        valid = Calc_parse_number(value, &number);
+        options->digits = number;
+        break;
+      case 'e':
+        if(strcmp(value, "print") == 0)
+          options->errors = CALC_ERRORS_PRINT;
+        else if(strcmp(value, "skip") == 0)
+          options->errors = CALC_ERRORS_SKIP;
+        else if(strcmp(value, "abort") == 0)
+          options->errors = CALC_ERRORS_ABORT;
+        else
+          valid = false;
+        break;
+      case 'j':
+        valid = Calc_parse_number(value, &number) && number <= 1024;
+        options->threads = number;
+        break;
+      case 'i':
+        valid = strcmp(value, "map") == 0 || strcmp(value, "read") == 0;
+        options->map = strcmp(value, "map") == 0;
+        break;
+    }
+
+    if(!valid){
+      fprintf(stderr, "%s: invalid value for %s: %s\n", argv[0], option, value);
+      return CALC_OPTIONS_INVALID;
+    }
+  }
+
+  return i;
+}
+
+/* Function to make sure a output buffer has space for more chars
+   It returns false if memory allocation failed
+   It receives the buffer and the number of chars */
+static bool Calc_reserve(OutputBuffer *output, size_t size){
+
+  if(output->size + size <= output->cap)
+    return true;
+
+  size_t cap = output->cap ? output->cap : 4096;
+  while(cap < output->size + size)
+    cap *= 2;
+
+  char *data = realloc(output->data, cap);
+  if(!data)
+    return false;
+
+  output->data = data;
+  output->cap = cap;
+  return true;
+}
+
+/* Function to write a result in a output buffer, followed by a new line
+   It returns false if memory allocation failed
+   It receives the buffer, the result and the options (style and precision) */
+static bool Calc_write_result(OutputBuffer *output, double result, const CalcOptions *options){
+
+  // Shortest text that reads back as the same double
+  if(options->style == 's'){
+
+    if(!Calc_reserve(output, FORMAT_DOUBLE_SIZE))
+      return false;
+
+    output->size += Format_double(result, &output->data[output->size]);
+    output->data[output->size++] = '\n';
+    return true;
+  }
+
+  size_t space = 64;
+
+  for(;;){
+
+    if(!Calc_reserve(output, space))
+      return false;
+
+    char *end = &output->data[output->size];
+    size_t available = output->cap - output->size;
+    int written;
+
+    switch(options->style){
+      case 'e':  written = snprintf(end, available, "%.*e\n", options->precision, result); break;
+      case 'f':  written = snprintf(end, available, "%.*f\n", options->precision, result); break;
+      default:   written = snprintf(end, available, "%.*g\n", options->precision, result); break;
+    }
+
+    // Numbers like 1e300 in style f do not fit in the first try
+    if(written >= 0 && (size_t) written < available){
+      output->size += written;
+      return true;
+    }
+
+    space = written + 1;
+  }
+}
+
+/* Function to evaluate a line with arbitrary precision and write its result in a output buffer, followed by a new line
+   It returns false if the line has a error (or memory allocation failed, the error is PARSE_OUT_OF_MEMORY then)
+   It receives the buffer, the line and its lenght, the number of digits and where the error is written */
+static bool Calc_write_precise(OutputBuffer *output, const char *line, size_t length, unsigned int digits, ParseError *error){
+
+  if(!Calc_reserve(output, BIGNUM_TEXT_SIZE(digits) + 1)){
+    error->kind = PARSE_OUT_OF_MEMORY;
+    return false;
+  }
+
+  size_t written = Math_evaluate_precise(line, length, digits, &output->data[output->size], error);
+  if(written == 0)
+    return false;
+
+  output->size += written;
+  output->data[output->size++] = '\n';
+  return true;
+}
+
+/* Function to evaluate a line with exact fractions and write its result in a output buffer, followed by a new line
+   It returns false if the line has a error (or memory allocation failed, the error is PARSE_OUT_OF_MEMORY then)
+   It receives the buffer, the line and its lenght and where the error is written */
+static bool Calc_write_rational(OutputBuffer *output, const char *line, size_t length, ParseError *error){
+
+  if(!Calc_reserve(output, RATIONAL_TEXT_SIZE + 1)){
+    error->kind = PARSE_OUT_OF_MEMORY;
+    return false;
+  }
+
+  Rational value;
+  if(!Math_evaluate_rational(line, length, &value, error))
+    return false;
+
+  output->size += Rational_to_text(value, &output->data[output->size]);
+  output->data[output->size++] = '\n';
+  return true;
+}
+
+/* Function to write a text in a output buffer
+   It returns false if memory allocation failed
+   It receives the buffer, the text and its lenght */
+static bool Calc_write_text(OutputBuffer *output, const char *text, size_t length){
+
+  if(!Calc_reserve(output, length))
+    return false;
+
+  memcpy(&output->data[output->size], text, length);
+  output->size += length;
+  return true;
+}
+
+/* Function executed by the thread pool, it evaluates the lines of a chunk
+   The lines are evaluated where they are (in the read buffer or in the mapped file), without copying them
+   It receives the block, the index of the worker and the index of the task */
+static void Calc_task(void *context, unsigned int worker, size_t task){
+
+  CalcBlock *block = context;
+  CalcTask *chunk = &block->tasks[task];
+  const CalcOptions *options = block->options;
+
+  chunk->output.size = 0;
+  chunk->line_count = 0;
+  chunk->error_count = 0;
+  chunk->stopped = false;
+  chunk->out_of_memory = false;
+
+  for(const char *line=chunk->begin; line<chunk->end; ){
+
+    const char *newline = memchr(line, '\n', chunk->end - line);
+    const char *line_end = newline ? newline : chunk->end;
+    const char *next = newline ? newline+1 : chunk->end;
+
+    // Lines of files written in Windows end with "\r\n"
+    if(line_end > line && line_end[-1] == '\r')
+      line_end--;
+
+    chunk->line_count++;
+    bool ok;
+
+    if(line_end == line)
+      ok = Calc_write_text(&chunk->output, "\n", 1);
+
+    else{
+
+      bool has_error = false;
+      ParseError error = {PARSE_OK, 0};
+
+      if(options->digits > 0){
+        ok = Calc_write_precise(&chunk->output, line, line_end - line, options->digits, &error);
+        has_error = !ok && error.kind != PARSE_OUT_OF_MEMORY;
+        ok = ok || has_error;
+      }
+      else if(options->style == 'r'){
+        ok = Calc_write_rational(&chunk->output, line, line_end - line, &error);
+        has_error = !ok && error.kind != PARSE_OUT_OF_MEMORY;
+        ok = ok || has_error;
+      }
+      else{
+        double value = Math_context_evaluate_span(block->contexts[worker], line, line_end - line, &has_error, &error);
+        if(!has_error)
+          ok = Calc_write_result(&chunk->output, value, options);
+      }
+
+      if(has_error){
+
+        chunk->error_count++;
+
+        if(options->errors == CALC_ERRORS_ABORT){
+          chunk->stopped = true;
+          chunk->error = error;
+          return;
+        }
+
+        ok = options->errors == CALC_ERRORS_SKIP || Calc_write_text(&chunk->output, "error\n", 6);
+      }
+    }
+
+    if(!ok){
+      chunk->out_of_memory = true;
+      return;
+    }
+
+    line = next;
+  }
+}
+
+/* Function to split a piece of the input in chunks of about CALC_TASK_BYTES, each chunk ends at a new line
+   It returns false if memory allocation failed
+   It receives the block, the beginning of the piece and its lenght */
+static bool Calc_split_chunks(CalcBlock *block, const char *text, size_t length){
+
+  const char *end = text + length;
+  block->task_count = 0;
+
+  while(text < end){
+
+    const char *chunk_end = end;
+    if((size_t)(end - text) > CALC_TASK_BYTES){
+      const char *newline = memchr(text + CALC_TASK_BYTES, '\n', end - text - CALC_TASK_BYTES);
+      chunk_end = newline ? newline+1 : end;
+    }
+
+    if(block->task_count == block->task_cap){
+
+      size_t cap = block->task_cap ? block->task_cap*2 : 64;
+      CalcTask *tasks = realloc(block->tasks, cap * sizeof(CalcTask));
+      if(!tasks)
+        return false;
+
+      memset(&tasks[block->task_cap], 0, (cap - block->task_cap) * sizeof(CalcTask));
+      block->tasks = tasks;
+      block->task_cap = cap;
+    }
+
+    block->tasks[block->task_count].begin = text;
+    block->tasks[block->task_count].end = chunk_end;
+    block->task_count++;
+
+    text = chunk_end;
+  }
+
+  return true;
+}
+
+/* Function to evaluate the lines of a piece of the input and write their results in the standard output
+   It returns the exit status of the piece
+   It receives the block, the thread pool, the beginning of the piece and its lenght (it must end at a new line or at the end of the input),
+   the name of the input and the number of lines of the input before the piece (updated) */
+static int Calc_process(CalcBlock *block, ThreadPool *pool, const char *text, size_t length, const char *name, size_t *line_number){
+
+  if(!Calc_split_chunks(block, text, length)){
+    fprintf(stderr, "calc: out of memory\n");
+    return CALC_EXIT_FAILURE;
+  }
+
+  ThreadPool_run(pool, block->task_count, Calc_task, block);
+
+  // The results are written in the order of the lines
+  int status = CALC_EXIT_OK;
+
+  for(size_t task=0; task<block->task_count; task++){
+
+    CalcTask *chunk = &block->tasks[task];
+    fwrite(chunk->output.data, 1, chunk->output.size, stdout);
+    *line_number += chunk->line_count;
+
+    if(chunk->out_of_memory){
+      fprintf(stderr, "calc: out of memory\n");
+      return CALC_EXIT_FAILURE;
+    }
+
+    if(chunk->error_count > 0)
+      status = CALC_EXIT_EXPRESSION;
+
+    if(chunk->stopped){
+
+      const char *message = chunk->error.kind == PARSE_OK ? "variables have no value" : Parser_error_message(chunk->error.kind);
+      fflush(stdout);
+      fprintf(stderr, "calc: %s:%zu:%u: %s\n", name, *line_number, chunk->error.position + 1, message);
+      return CALC_EXIT_EXPRESSION;
+    }
+  }
+
+  return status;
+}
+
+/* Function to tell if the evaluation of the input must stop after a piece
+   It receives the status of the piece and the options */
+static bool Calc_must_stop(int status, const CalcOptions *options){
+
+  return status == CALC_EXIT_FAILURE || (status == CALC_EXIT_EXPRESSION && options->errors == CALC_ERRORS_ABORT);
+}
+
+/* Function to evaluate every line of a input that is read (like the standard input or a pipe), it is read in blocks that end at a new line
+   It returns the exit status of the input
+   It receives the block, the thread pool, the input and its name */
+static int Calc_process_stream(CalcBlock *block, ThreadPool *pool, FILE *file, const char *name){
+
+  size_t cap = CALC_BLOCK_SIZE;
+  char *buffer = malloc(cap);
+  if(!buffer){
+    fprintf(stderr, "calc: out of memory\n");
+    return CALC_EXIT_FAILURE;
+  }
+
+  size_t filled = 0;
+  size_t line_number = 0;
+  bool end_of_file = false;
+  int status = CALC_EXIT_OK;
+
+  while(!end_of_file){
+
+    size_t read = fread(&buffer[filled], 1, cap - filled, file);
+    filled += read;
+
+    if(read == 0){
+
+      if(ferror(file)){
+        fprintf(stderr, "calc: %s: %s\n", name, strerror(errno));
+        status = CALC_EXIT_FAILURE;
+        break;
+      }
+      end_of_file = true;
+    }
+
+    // Only complete lines are evaluated, the rest stays for the next block
+    size_t length = filled;
+    if(!end_of_file){
+
+      char *last_newline = NULL;
+      for(char *c=&buffer[filled]; c>buffer; c--){
+        if(c[-1] == '\n'){
+          last_newline = c-1;
+          break;
+        }
+      }
+
+      // A line longer than the buffer
+      if(!last_newline){
+
+        if(filled < cap)
+          continue;
+
+        char *bigger = realloc(buffer, cap*2);
+        if(!bigger){
+          fprintf(stderr, "calc: out of memory\n");
+          status = CALC_EXIT_FAILURE;
+          break;
+        }
+        buffer = bigger;
+        cap *= 2;
+        continue;
+      }
+
+      length = last_newline - buffer + 1;
+    }
+
+    int piece_status = Calc_process(block, pool, buffer, length, name, &line_number);
+    if(piece_status > status)
+      status = piece_status;
+    if(Calc_must_stop(piece_status, block->options))
+      break;
+
+    memmove(buffer, &buffer[length], filled - length);
+    filled -= length;
+  }
+
+  free(buffer);
+  return status;
+}
+
+/* Function to evaluate every line of a file mapped in memory, nothing is copied: the lines are tokenized where they are in the mapping
+   The file is evaluated in windows of about CALC_MAP_WINDOW bytes that end at a new line, so the memory of the results stays bounded
+   It returns the exit status of the file
+   It receives the block, the thread pool, the file descriptor of the file, its size and its name */
+static int Calc_process_mapped(CalcBlock *block, ThreadPool *pool, int fd, size_t size, const char *name){
+
+  const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(data == MAP_FAILED){
+    fprintf(stderr, "calc: %s: %s\n", name, strerror(errno));
+    return CALC_EXIT_FAILURE;
+  }
+
+  madvise((void*) data, size, MADV_SEQUENTIAL);
+
+  const char *end = data + size;
+  size_t line_number = 0;
+  int status = CALC_EXIT_OK;
+
+  for(const char *window=data; window<end; ){
+
+    const char *window_end = end;
+    if((size_t)(end - window) > CALC_MAP_WINDOW){
+      const char *newline = memchr(window + CALC_MAP_WINDOW, '\n', end - window - CALC_MAP_WINDOW);
+      window_end = newline ? newline+1 : end;
+    }
+
+    int piece_status = Calc_process(block, pool, window, window_end - window, name, &line_number);
+    if(piece_status > status)
+      status = piece_status;
+    if(Calc_must_stop(piece_status, block->options))
+      break;
+
+    window = window_end;
+  }
+
+  munmap((void*) data, size);
+  return status;
+}
+
+/* Function to evaluate every line of a file, regular files are mapped in memory (unless the input mode is read) and other files are read
+   It returns the exit status of the file
+   It receives the block, the thread pool and the name of the file ("-" for the standard input) */
+static int Calc_process_file(CalcBlock *block, ThreadPool *pool, const char *name){
+
+  if(strcmp(name, "-") == 0)
+    return Calc_process_stream(block, pool, stdin, "<stdin>");
+
+  int fd = open(name, O_RDONLY);
+  struct stat info;
+
+  if(fd < 0 || fstat(fd, &info) != 0){
+    fprintf(stderr, "calc: %s: %s\n", name, strerror(errno));
+    if(fd >= 0)
+      close(fd);
+    return CALC_EXIT_FAILURE;
+  }
+
+  int status;
+
+  // Empty files can not be mapped, and they have no line anyway
+  if(block->options->map && S_ISREG(info.st_mode)){
+    status = info.st_size > 0 ? Calc_process_mapped(block, pool, fd, info.st_size, name) : CALC_EXIT_OK;
+    close(fd);
+  }
+
+  else{
+
+    FILE *file = fdopen(fd, "rb");
+    if(!file){
+      fprintf(stderr, "calc: %s: %s\n", name, strerror(errno));
+      close(fd);
+      return CALC_EXIT_FAILURE;
+    }
+
+    status = Calc_process_stream(block, pool, file, name);
+    fclose(file);
+  }
+
+  return status;
+}
+
+int main(int argc, char **argv){
+
+  CalcOptions options;
+  int first_file = Calc_parse_options(argc, argv, &options);
+  if(first_file == CALC_OPTIONS_HELP)
+    return CALC_EXIT_OK;
+  if(first_file == CALC_OPTIONS_INVALID)
+    return CALC_EXIT_FAILURE;
+
+  setvbuf(stdout, NULL, _IOFBF, CALC_OUTPUT_BUFFER);
+
+  ThreadPool *pool = ThreadPool_create(options.threads);
+  if(!pool){
+    fprintf(stderr, "%s: could not create the threads\n", argv[0]);
+    return CALC_EXIT_FAILURE;
+  }
+
+  CalcBlock block = {NULL, 0, 0, &options, NULL};
+  unsigned int workers = ThreadPool_size(pool);
+  int status = CALC_EXIT_OK;
+
+  block.contexts = calloc(workers, sizeof(MathContext*));
+  for(unsigned int i=0; block.contexts && i<workers; i++){
+
+    block.contexts[i] = Math_context_create(NULL);
+    if(!block.contexts[i])
+      status = CALC_EXIT_FAILURE;
+  }
+
+  if(!block.contexts || status != CALC_EXIT_OK){
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    status = CALC_EXIT_FAILURE;
+  }
+
+  // Without files the expressions come from the standard input
+  char *standard_input[] = {"-"};
+  char **files = first_file < argc ? &argv[first_file] : standard_input;
+  int file_count = first_file < argc ? argc - first_file : 1;
+
+  for(int i=0; i<file_count && status != CALC_EXIT_FAILURE; i++){
+
+    int file_status = Calc_process_file(&block, pool, files[i]);
+    if(file_status > status)
+      status = file_status;
+
+    if(Calc_must_stop(file_status, &options))
+      break;
+  }
+
+  if(fflush(stdout) != 0){
+    fprintf(stderr, "%s: could not write the results: %s\n", argv[0], strerror(errno));
+    status = CALC_EXIT_FAILURE;
+  }
+
+  for(unsigned int i=0; block.contexts && i<workers; i++)
+    Math_context_destroy(block.contexts[i]);
+  free(block.contexts);
+
+  for(size_t i=0; i<block.task_cap; i++)
+    free(block.tasks[i].output.data);
+  free(block.tasks);
+
+  ThreadPool_destroy(pool);
+  return status;
+}
@@ -10,8 +10,9 @@
 #include <gtk-4.0/gtk/gtk.h> // gtk library for GUI
 
 #include "../include/math_interpreter.h"
+#include "../include/format.h"
+#include "../include/incremental.h"
 
-#define INITIAL_SIZE_BUFFER 2
 #define TOTAL_ELEMENTS 30
 
 
@@ -52,13 +53,13 @@ typedef enum {
 
 
 /* Struct for the program buffer, store references to the input and result fields,
-   also store the reference to the expression char array and the result char array */ 
+   also store the expression (with the state of its live evaluation) and the text of the result */ 
 typedef struct{
 
   GtkWidget *result_field, *input_field; // Reference to input and result text in the GUI
 
-  char *expression;                      // Array of char expression will be use to tokenize    
-  char *result;                          // Result of the operation          
+  IncrementalExpr expression;            // Expression typed so far, evaluated while it is typed
+  char result[FORMAT_DOUBLE_SIZE];       // Result of the operation          
 } calculator_buffer;
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -67,45 +68,21 @@ typedef struct{
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-char *double_to_string(double value){
-
-  int space_needed = snprintf(NULL, 0, "%g", value);
-
-  // Formatting failed
-  if(space_needed<0)
-    return NULL;
-  
-  space_needed++; // For the '\0'
-
-  char *str_res = malloc(space_needed * sizeof(char));
-  if(str_res==NULL)
-    return NULL;
-
-  snprintf(str_res, space_needed, "%g", value);
-  return str_res;
-}
-
-/* Function to calculate the result of the current expression 
+/* Function to calculate the result of the current expression, the expression is evaluated while it is typed so this does not parse it again
+   The result is written in the buffer with the fewest digits that represent it exactly (see format.h)
    It returns a bool telling if there was a error or not
    It receives a pointer to the buffer and a boolean flag for error checking */
 bool get_result(gpointer buffer, bool *has_err){
 
   calculator_buffer *pBuffer = buffer;
 
-  char *expression = pBuffer->expression;
-  char *result     = pBuffer->result;
-
   double expression_res;
   
-  expression_res = Math_interpreter_evaluate_expression(expression, has_err);
+  *has_err = !Incremental_result(&pBuffer->expression, &expression_res, NULL);
   if(*has_err)
     return *has_err; // Which is true
   
-  result = double_to_string(expression_res);
-  if(result==NULL)
-    return *has_err=true;
-
-  pBuffer->result = result; // Redirect the pointer to the new memory area
+  Format_double(expression_res, pBuffer->result);
 
   return *has_err;
 }
@@ -117,23 +94,10 @@ bool get_result(gpointer buffer, bool *has_err){
 int register_char(char c, gpointer buffer){
  
   calculator_buffer *pBuffer = buffer;
-  char *oldbuffer = pBuffer->expression; // Pointer to improve readability, points to main expression
 
-
-  unsigned long old_lenght = strlen(oldbuffer); // Current lenght of the array
-  unsigned long new_lenght = old_lenght+2; // Char + '\0'
-
-
-  char *newbuffer = realloc(oldbuffer, new_lenght * sizeof(char));
-
-  if(!newbuffer) // If fail
+  // The expression keeps its length and grows its memory by doubling, only the number at its end is lexed again
+  if(!Incremental_append(&pBuffer->expression, &c, 1))
     return 1;
-
-  pBuffer->expression = newbuffer; // Redirect the pointer to the new memory area
-
-  // Concat chars for the main expression
-  newbuffer[new_lenght-2] = c;
-  newbuffer[new_lenght-1] = '\0';
   
   return 0;
 }
@@ -146,32 +110,13 @@ int register_char(char c, gpointer buffer){
    and a generic pointer to the buffer */
 int register_function(char *str, gpointer buffer){
 
-  unsigned long str_lenght = strlen(str);
-
   calculator_buffer *pBuffer = buffer;
-  char *oldbuffer = pBuffer->expression; // Pointer to improve readability, points to main expression
-
-  unsigned long old_lenght = strlen(oldbuffer); // Current lenght of the array
-  unsigned long new_lenght = old_lenght + (str_lenght+1); // The lenght of the string + '\0'
-
-  char *newbuffer = realloc(oldbuffer, new_lenght * sizeof(char));
 
-  if(!newbuffer) // If fail
+  if(!Incremental_append(&pBuffer->expression, str, strlen(str)))
     return 1;
 
-  pBuffer->expression = newbuffer; // Redirect the pointer to the new memory area
-
-  unsigned long index_to_write = old_lenght; // Index to point to where it should start writing the chars
-
-  for(unsigned long i=0; i<str_lenght; i++){
-    newbuffer[index_to_write++] = str[i];
-  }
-  newbuffer[index_to_write] = '\0';
-
   // Add the '(' for the next char
-  register_char('(', pBuffer);
-
-  return 0;
+  return register_char('(', pBuffer);
 }
 
 
@@ -181,7 +126,7 @@ void clean_buffer(gpointer buffer){
 
   calculator_buffer *pBuffer = buffer;
 
-  pBuffer->expression[0] = '\0'; // Clean the expression field
+  Incremental_clear(&pBuffer->expression); // Clean the expression field
 }
 
 
@@ -190,8 +135,9 @@ void clean_buffer(gpointer buffer){
 void remove_one_char_buffer(gpointer buffer){
 
   calculator_buffer *pBuffer = buffer;
-  
-  unsigned long lenght = strlen(pBuffer->expression);
+
+  const char *expression = Incremental_text(&pBuffer->expression);
+  unsigned long lenght = pBuffer->expression.length;
 
   // If there is no char, return
   if(lenght==0)
@@ -199,33 +145,29 @@ void remove_one_char_buffer(gpointer buffer){
 
   unsigned long last_char = lenght-1; // Index to point to where the last char is written, which is the lenght - '\0'
 
-  if(pBuffer->expression[last_char]=='('){
-  
-    pBuffer->expression[last_char] = '\0'; // To delete the '('
+  // If the char before the '(' is a letter, that means that is a function, so it needs to be erased entirely
+  if(expression[last_char]=='('){
 
-    if(last_char==0)
-      return;
+    while(last_char>0 && isalpha(expression[last_char-1]))
+      last_char--;
+  }
 
-    last_char--;
+  Incremental_remove(&pBuffer->expression, lenght-last_char);
+}
 
-    // If the char to delete is a letter, that means that is a function, so it needs to be erased entirely
-    if(isalpha(pBuffer->expression[last_char])){
 
-      while(last_char>0 && isalpha(pBuffer->expression[last_char])){
-        last_char--;
-      }
-    
-      // In case last char stopped at a non letter char
-      if(!isalpha(pBuffer->expression[last_char]))
-        last_char++;
-      
-      pBuffer->expression[last_char] = '\0';
-    }
+/* Function to show the expression and its live result (nothing while the expression is not complete)
+   It receives a pointer to the buffer */
+void show_expression(calculator_buffer *pBuffer){
 
-    return;
-  }
-  
-  pBuffer->expression[last_char] = '\0';
+  gtk_label_set_label(GTK_LABEL(pBuffer->input_field), Incremental_text(&pBuffer->expression));
+
+  bool has_err=false;
+  get_result(pBuffer, &has_err);
+  if(!has_err && pBuffer->expression.length > 0)
+    gtk_label_set_label(GTK_LABEL(pBuffer->result_field), pBuffer->result);
+  else
+    gtk_label_set_label(GTK_LABEL(pBuffer->result_field), "");
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -242,7 +184,7 @@ void on_button_clicked(GtkButton *b, gpointer buffer){
   switch(button_id){
     case button_back:
       remove_one_char_buffer(pBuffer);
-      gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+      show_expression(pBuffer);
       break;
     case button_clear:
       clean_buffer(pBuffer);
@@ -251,63 +193,63 @@ void on_button_clicked(GtkButton *b, gpointer buffer){
       break;
     case button_9:
       if(register_char('9', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_8:
       if(register_char('8', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_7:
       if(register_char('7', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_mod:
       if(register_char('%', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_openbrackets:
       if(register_char('(', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_division:
       if(register_char('/', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_6:
       if(register_char('6', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_5:
       if(register_char('5', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_4:
       if(register_char('4', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_sqrt:
       if(register_function("sqrt", pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_closebrackets:
       if(register_char(')', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_minus:
       if(register_char('-', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_3:
       if(register_char('3', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_2:
       if(register_char('2', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_1:
       if(register_char('1', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_equals:
       bool has_err=false;
@@ -319,23 +261,23 @@ void on_button_clicked(GtkButton *b, gpointer buffer){
       break;
     case button_multiplication:
       if(register_char('*', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_plus:
       if(register_char('+', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_power:
       if(register_char('^', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_dot:
       if(register_char('.', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
     case button_0:
       if(register_char('0', pBuffer) == 0)
-        gtk_label_set_label(GTK_LABEL(pBuffer->input_field), pBuffer->expression);
+        show_expression(pBuffer);
       break;
   }
 }
@@ -412,15 +354,9 @@ void activate(GtkApplication *app, gpointer buffer){
 
 int main(int argc, char *argv[]){
 
-  g_setenv("LC_ALL", "C", 1); // Dot used as decimal separator
-
-  char *expression = malloc(INITIAL_SIZE_BUFFER * sizeof(char)); // Init the expression char array with INITIAL_SIZE_BUFFER times the size of char
-  
-  expression[0] = '\0'; // Initiate the expression with end of string
-
   calculator_buffer buffer = {0}; // Initiate the program buffer with 0s
 
-  buffer.expression = expression; // Assign to buffer var the dynamic allocated char array
+  Incremental_init(&buffer.expression); // Initiate the expression empty, its memory grows while it is typed
 
   // GUI --------------------------------------------------------------
 
@@ -434,7 +370,6 @@ int main(int argc, char *argv[]){
 
   // ------------------------------------------------------------------
 
-  free(buffer.expression);
-  free(buffer.result);
+  Incremental_free(&buffer.expression);
   return status;
 }
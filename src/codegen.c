@@ -0,0 +1,235 @@
+/* This program is part of the math interpreter, it writes the bytecode of expressions as standalone C functions.
+   Each instruction becomes one constant local variable (t0, t1...), the stack of the bytecode only exists while the code is written,
+   so the C compiler sees a straight line of operations that it can optimize (and people can audit). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "../include/codegen.h"
+#include "../include/format.h"
+#include "../include/kernels.h"
+
+/* Names that the generated functions can not have: C keywords, names of stddef.h and math.h, main and the local variables of the batch function */
+static const char *const Codegen_reserved_names[] = {
+  // Keywords (C11 and C23)
+  "alignas", "alignof", "auto", "bool", "break", "case", "char", "const", "constexpr", "continue", "default", "do", "double",
+  "else", "enum", "extern", "false", "float", "for", "goto", "if", "inline", "int", "long", "nullptr", "register", "restrict",
+  "return", "short", "signed", "sizeof", "static", "static_assert", "struct", "switch", "thread_local", "true", "typedef",
+  "typeof", "typeof_unqual", "union", "unsigned", "void", "volatile", "while",
+  // stddef.h
+  "NULL", "max_align_t", "nullptr_t", "offsetof", "ptrdiff_t", "size_t", "unreachable", "wchar_t",
+  // math.h macros and types
+  "INFINITY", "NAN", "HUGE_VAL", "HUGE_VALF", "HUGE_VALL", "MATH_ERRNO", "MATH_ERREXCEPT", "math_errhandling", "double_t",
+  "float_t", "fpclassify", "isfinite", "isgreater", "isgreaterequal", "isinf", "isless", "islessequal", "islessgreater",
+  "isnan", "isnormal", "isunordered", "signbit",
+  // Entry point of the programs
+  "main",
+  // Local variables of the batch function
+  "columns", "i", "out", "rows", "variables"
+};
+
+/* Functions of math.h (C11 and the ones of glibc), also reserved with the f (float) and l (long double) suffixes */
+static const char *const Codegen_math_functions[] = {
+  "acos", "acosh", "asin", "asinh", "atan", "atan2", "atanh", "cbrt", "ceil", "copysign", "cos", "cosh", "drem", "erf", "erfc",
+  "exp", "exp10", "exp2", "expm1", "fabs", "fdim", "finite", "floor", "fma", "fmax", "fmin", "fmod", "frexp", "gamma", "hypot",
+  "ilogb", "j0", "j1", "jn", "ldexp", "lgamma", "llrint", "llround", "log", "log10", "log1p", "log2", "logb", "lrint", "lround",
+  "modf", "nan", "nearbyint", "nextafter", "nexttoward", "pow", "pow10", "remainder", "remquo", "rint", "round", "scalb",
+  "scalbln", "scalbn", "significand", "sin", "sincos", "sinh", "sqrt", "tan", "tanh", "tgamma", "trunc", "y0", "y1", "yn"
+};
+
+/* Function to tell if a name is reserved by C, by the headers of the generated file or by the generated code
+   It returns true if it is, and receives the name */
+static bool Codegen_is_reserved(const char *name){
+
+  // Helpers of the prelude (math_), macros of math.h (FP_ and the M_ constants) and names reserved by C (__ or _ and a uppercase letter)
+  if(strncmp(name, "math_", 5) == 0 || strncmp(name, "FP_", 3) == 0 || strncmp(name, "M_", 2) == 0 ||
+     (name[0] == '_' && (name[1] == '_' || isupper((unsigned char) name[1]))))
+    return true;
+
+  for(size_t i=0; i<sizeof(Codegen_reserved_names)/sizeof(Codegen_reserved_names[0]); i++){
+    if(strcmp(name, Codegen_reserved_names[i]) == 0)
+      return true;
+  }
+
+  size_t length = strlen(name);
+
+  for(size_t i=0; i<sizeof(Codegen_math_functions)/sizeof(Codegen_math_functions[0]); i++){
+
+    const char *function = Codegen_math_functions[i];
+    size_t function_length = strlen(function);
+
+    if(strncmp(name, function, function_length) == 0 &&
+       (length == function_length || (length == function_length+1 && (name[length-1] == 'f' || name[length-1] == 'l'))))
+      return true;
+  }
+
+  return false;
+}
+
+/* Function to tell if a text can be the name of a generated function (a C identifier that is not reserved: C keywords,
+   names of math.h and stddef.h, main, names starting with "math_" and the local variables of the generated code)
+   It returns true if it can, and receives the text */
+bool Codegen_is_name(const char *name){
+
+  if(!name || !(isalpha((unsigned char) name[0]) || name[0] == '_') || Codegen_is_reserved(name))
+    return false;
+
+  for(const char *c=name; *c; c++){
+    if(!isalnum((unsigned char) *c) && *c != '_')
+      return false;
+  }
+
+  return true;
+}
+
+/* Function to write the start of a C file of generated functions: the includes and the helper functions with the semantics of the interpreter
+   (division and mod by 0 and the square root of negative numbers are NAN, integer powers use a squaring loop)
+   It returns false if the writing failed, and receives the stream */
+bool Codegen_write_prelude(FILE *stream){
+
+  fprintf(stream,
+          "/* Generated by the math interpreter, the functions have the same results as its bytecode interpreter */\n"
+          "\n"
+          "#include <stddef.h>\n"
+          "#include <math.h>\n"
+          "\n"
+          "#pragma STDC FP_CONTRACT OFF /* Every operation is rounded, like in the interpreter */\n"
+          "\n"
+          "static double math_div(double a, double b){ return b == 0.0 ? NAN : a / b; }\n"
+          "static double math_mod(double a, double b){ return b == 0.0 ? NAN : fmod(a, b); }\n"
+          "static double math_sqrt(double a){ return a < 0 ? NAN : sqrt(a); }\n"
+          "\n"
+          "static double math_pow(double a, double b){\n"
+          "\n"
+          "  if(!(fabs(b) <= %d) || b != trunc(b))\n"
+          "    return pow(a, b);\n"
+          "\n"
+          "  unsigned int n = (unsigned int) fabs(b);\n"
+          "  double base = a, result = 1.0;\n"
+          "  while(n){\n"
+          "    if(n & 1)\n"
+          "      result *= base;\n"
+          "    n >>= 1;\n"
+          "    if(n)\n"
+          "      base *= base;\n"
+          "  }\n"
+          "\n"
+          "  if(b > 0)\n"
+          "    return result;\n"
+          "  return result == 0.0 || isinf(result) ? pow(a, b) : 1.0 / result;\n"
+          "}\n",
+          KERNELS_MAX_SQUARING_EXPONENT);
+
+  return !ferror(stream);
+}
+
+/* Function to write a constant as a C expression that has exactly the same double
+   It receives the stream and the constant */
+static void Codegen_write_constant(FILE *stream, double value){
+
+  if(isnan(value))
+    fputs("NAN", stream);
+  else if(isinf(value))
+    fputs(value < 0 ? "-INFINITY" : "INFINITY", stream);
+  else if(value == 0.0)
+    fputs(signbit(value) ? "-0.0" : "0.0", stream); // -0 would be the integer 0
+  else{
+    char text[FORMAT_DOUBLE_SIZE];
+    Format_double(value, text);
+    fputs(text, stream);
+  }
+}
+
+/* Function to write the C functions of a expression (after Codegen_write_prelude), for a name like f they are:
+   - const char *const f_variables[]: names of the variables in the order of their indexes, terminated by NULL
+   - double f(const double *variables): value of the expression, with the values of the variables by index
+   - void f_batch(const double *const *columns, size_t rows, double *out): out[i] = f of the row i of one column per variable
+   It returns false if the bytecode is empty (the expression has no tokens), the name is not valid or the writing failed
+   It receives the stream, the optimized bytecode of the expression, the name of the functions (see Codegen_is_name)
+   and the text of the expression, that is written as a comment (can be NULL) */
+bool Codegen_write_function(FILE *stream, const Bytecode *bytecode, const char *name, const char *expression){
+
+  if(bytecode->size == 0 || !Codegen_is_name(name))
+    return false;
+
+  // Stack of the numbers of the local variables that have the values of the stack of the bytecode
+  unsigned int *stack = malloc((bytecode->max_depth ? bytecode->max_depth : 1) * sizeof(unsigned int));
+  if(!stack)
+    return false;
+
+  fputs("\n", stream);
+  if(expression && !strstr(expression, "*/"))
+    fprintf(stream, "/* %s */\n", expression);
+
+  fprintf(stream, "const char *const %s_variables[] = {", name);
+  for(unsigned int i=0; i<bytecode->variable_count; i++)
+    fprintf(stream, "\"%s\", ", bytecode->variables[i]);
+  fprintf(stream, "NULL};\n\n");
+
+  fprintf(stream, "double %s(const double *variables){\n\n", name);
+  if(bytecode->variable_count == 0)
+    fputs("  (void) variables;\n", stream);
+
+  unsigned int top = 0;
+
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    Instruction instruction = bytecode->code[i];
+    unsigned int b = top >= 1 ? stack[top-1] : 0;
+    unsigned int a = top >= 2 ? stack[top-2] : 0;
+
+    // Operands and OP_DUP push a value, unary operations replace it and binary operations replace two values by one
+    switch(instruction.op){
+      case OP_CONST: case OP_VAR: case OP_DUP: stack[top++] = i; break;
+      case OP_NEG: case OP_SQRT:              stack[top-1] = i; break;
+      default:                                stack[--top - 1] = i; break;
+    }
+
+    fprintf(stream, "  const double t%u = ", i);
+
+    switch(instruction.op){
+      case OP_CONST: Codegen_write_constant(stream, bytecode->constants[instruction.arg]); break;
+      case OP_VAR:   fprintf(stream, "variables[%u]; /* %s */\n", instruction.arg, bytecode->variables[instruction.arg]); continue;
+      case OP_DUP:   fprintf(stream, "t%u", b); break;
+      case OP_NEG:   fprintf(stream, "-t%u", b); break;
+      case OP_SQRT:  fprintf(stream, "math_sqrt(t%u)", b); break;
+      case OP_ADD:   fprintf(stream, "t%u + t%u", a, b); break;
+      case OP_SUB:   fprintf(stream, "t%u - t%u", a, b); break;
+      case OP_MUL:   fprintf(stream, "t%u * t%u", a, b); break;
+      case OP_DIV:   fprintf(stream, "math_div(t%u, t%u)", a, b); break;
+      case OP_MOD:   fprintf(stream, "math_mod(t%u, t%u)", a, b); break;
+      case OP_POW:   fprintf(stream, "math_pow(t%u, t%u)", a, b); break;
+    }
+
+    fputs(";\n", stream);
+  }
+
+  fprintf(stream, "\n  return t%u;\n}\n\n", stack[0]);
+  free(stack);
+
+  // The batch version copies the values of a row and calls the function, that the C compiler inlines
+  unsigned int count = bytecode->variable_count ? bytecode->variable_count : 1;
+  fprintf(stream,
+          "void %s_batch(const double *const *columns, size_t rows, double *out){\n"
+          "\n"
+          "  double variables[%u];\n"
+          "  for(size_t i=0; i<rows; i++){\n",
+          name, count);
+
+  if(bytecode->variable_count == 0)
+    fputs("    (void) columns;\n", stream);
+  for(unsigned int i=0; i<bytecode->variable_count; i++)
+    fprintf(stream, "    variables[%u] = columns[%u][i];\n", i, i);
+
+  fprintf(stream,
+          "    out[i] = %s(variables);\n"
+          "  }\n"
+          "}\n",
+          name);
+
+  return !ferror(stream);
+}
@@ -7,21 +7,25 @@
 
 // ------------------------------------------------ Tokens Stack ------------------------------------------------
 
-/* Function to create and initialize the stack
-   It receives a reference to the stack */
-void Stack_init(TokenStack *stack){
-
-  stack->data = NULL;
-  stack->size = stack->cap = 0;
+/* Function to create and initialize the stack (the stack points to itself, so it can not be copied after this)
+   It receives a reference to the stack and the arena to allocate from (NULL to use malloc) */
+void Stack_init(TokenStack *stack, Arena *arena){
+
+  stack->data = stack->inline_data;
+  stack->size = 0;
+  stack->cap = STACK_INLINE_SIZE;
+  stack->arena = arena;
 }
 
-/* Function to free the stack
+/* Function to free the stack (memory of a arena is only released by Arena_reset)
    It receives a reference to the stack to free */
 void Stack_free(TokenStack *stack){
 
-  free(stack->data);
-  stack->data = NULL;
-  stack->size = stack->cap = 0;
+  if(!stack->arena && stack->data != stack->inline_data)
+    free(stack->data);
+  stack->data = stack->inline_data;
+  stack->size = 0;
+  stack->cap = STACK_INLINE_SIZE;
 }
 
 /* Function to tell whether the stack is empty or not
@@ -34,59 +38,76 @@ bool Stack_is_empty(TokenStack *stack){
 
 /* Function to insert an element in the top of the stack, do the realloc if necessary
    It receives a reference to the stack and the token to push */
-void Stack_push(TokenStack *stack, char *tok){
-
-  unsigned int cap = stack->cap;
-  unsigned int size = stack->size;
-
-  if(size == cap){
-    unsigned int newcap = cap ? cap*2 : 4;
-    stack->data = realloc(stack->data, newcap * sizeof(char*));
+void Stack_push(TokenStack *stack, Token tok){
+
+  if(stack->size == stack->cap){
+
+    unsigned int newcap = stack->cap*2;
+    Token *data;
+
+    // When the inline storage is full the tokens move to the arena or the heap
+    if(stack->data == stack->inline_data){
+      data = stack->arena ? Arena_alloc(stack->arena, newcap * sizeof(Token)) : malloc(newcap * sizeof(Token));
+      if(data)
+        memcpy(data, stack->inline_data, sizeof(stack->inline_data));
+    }
+    else if(stack->arena)
+      data = Arena_grow(stack->arena, stack->data, stack->cap * sizeof(Token), newcap * sizeof(Token));
+    else
+      data = realloc(stack->data, newcap * sizeof(Token));
+
+    if(!data)
+      return;
+    stack->data = data;
     stack->cap = newcap;
   }
   stack->data[stack->size++]=tok;
 }
 
 /* Function to remove the element of the top of the stack
-   It returns the token popped
+   It returns the token popped, or a TOK_END token if empty
    It receives a reference to the stack */
-char *Stack_pop(TokenStack *stack){
+Token Stack_pop(TokenStack *stack){
 
   // If the stack is empty
-  if(Stack_is_empty(stack))
-    return NULL;
+  if(Stack_is_empty(stack)){
+    Token end = {TOK_END, 0, 0, 0.0};
+    return end;
+  }
 
   return stack->data[--stack->size];
 }
   
 /* Function to return the value of the element of the top of the stack 
-   It returns the token
+   It returns a reference to the token, or NULL if empty
    It receives a reference to the stack */
-char *Stack_peek(TokenStack *stack){
+Token *Stack_peek(TokenStack *stack){
 
   if(Stack_is_empty(stack))
     return NULL;
 
-  return stack->data[stack->size-1];
+  return &stack->data[stack->size-1];
 }
 
 // ------------------------------------------------ Token Queue ------------------------------------------------
 
 /* Function to create and initialize the queue
-   It receives a reference to the queue */
-void Queue_init(TokenQueue *queue){
+   It receives a reference to the queue and the arena to allocate from (NULL to use malloc) */
+void Queue_init(TokenQueue *queue, Arena *arena){
 
   queue->data = NULL;
-  queue->size = queue->cap = 0;
+  queue->head = queue->size = queue->cap = 0;
+  queue->arena = arena;
 }
 
-/* Function to free the queue
+/* Function to free the queue (memory of a arena is only released by Arena_reset)
    It receives a reference to the queue to free */
 void Queue_free(TokenQueue *queue){
 
-  free(queue->data);
+  if(!queue->arena)
+    free(queue->data);
   queue->data = NULL;
-  queue->size = queue->cap = 0;
+  queue->head = queue->size = queue->cap = 0;
 }
 
 /* Function to tell whether the queue is empty or not
@@ -97,73 +118,153 @@ bool Queue_is_empty(TokenQueue *queue){
   return (queue->size == 0);
 }
 
+/* Function to resize the array of the queue, the tokens that wrapped around the end are moved after the old end
+   It returns false if memory allocation failed (the queue is not changed)
+   It receives a reference to the queue and the new capacity (bigger than the current one) */
+static bool Queue_resize(TokenQueue *queue, unsigned int newcap){
+
+  Token *data;
+  if(queue->arena)
+    data = Arena_grow(queue->arena, queue->data, queue->cap * sizeof(Token), newcap * sizeof(Token));
+  else
+    data = realloc(queue->data, newcap * sizeof(Token));
+  if(!data)
+    return false;
+
+  // data[head...cap-1] and data[0...wrapped-1] -> data[head...cap+wrapped-1]
+  if(queue->head + queue->size > queue->cap){
+    unsigned int wrapped = queue->head + queue->size - queue->cap;
+    memcpy(&data[queue->cap], data, wrapped * sizeof(Token));
+  }
+
+  queue->data = data;
+  queue->cap = newcap;
+  return true;
+}
+
 /* Function to insert an element at the end of the queue, do the realloc if necessary
+   One slot is always kept free, so Queue_to_array has space for the TOK_END token
    It receives a reference to the queue and the token to push */
-void Queue_enqueue(TokenQueue *queue, char *tok){
+void Queue_enqueue(TokenQueue *queue, Token tok){
+
+  if(queue->size+1 >= queue->cap && !Queue_resize(queue, queue->cap ? queue->cap*2 : 4))
+    return;
+
+  // The capacity is a power of 2, so the position wraps with a mask
+  queue->data[(queue->head + queue->size) & (queue->cap-1)] = tok;
+  queue->size++;
+}
 
-  unsigned int cap = queue->cap;
-  unsigned int size = queue->size;
+/* Function to remove the element of the front of the queue, the queue is a circular buffer so nothing is moved
+   It returns the token dequeued, or a TOK_END token if empty
+   It receives a reference to the queue */
+Token Queue_dequeue(TokenQueue *queue){
 
-  if(size == cap){
-    unsigned int newcap = cap ? cap*2 : 4;
-    queue->data = realloc(queue->data, newcap * sizeof(char*));
-    queue->cap = newcap;
+  if(Queue_is_empty(queue)){
+    Token end = {TOK_END, 0, 0, 0.0};
+    return end;
   }
-  queue->data[queue->size++]=tok; 
+
+  Token token_dequeued = queue->data[queue->head];
+
+  queue->head = (queue->head+1) & (queue->cap-1);
+  queue->size--;
+  return token_dequeued;
 }
 
-/* Function to remove the element of the front of the queue and move the others
-   It returns the token dequeued
+/* Function to convert the current content into a TOK_END terminated array (Required to the function that will evaluate the RPN)
+   The array of the queue is given to the caller without copying the tokens (they are only moved if the queue was dequeued),
+   so the queue is empty after it
+   It returns the array, that must be released with free (if the queue has no arena)
    It receives a reference to the queue */
-char *Queue_dequeue(TokenQueue *queue){
+Token *Queue_to_array(TokenQueue *queue){
 
-  if(Queue_is_empty(queue))
+  if(queue->cap == 0 && !Queue_resize(queue, 1))
     return NULL;
 
-  char *token_dequeued = queue->data[0];
+  Token *out = queue->data;
+
+  // Tokens that wrapped around the end are unwrapped into a new array
+  if(queue->head + queue->size > queue->cap){
 
-  unsigned int index = 0;
-  unsigned int size = queue->size;
-  while(index<size-1){
+    out = queue->arena ? Arena_alloc(queue->arena, queue->cap * sizeof(Token)) : malloc(queue->cap * sizeof(Token));
+    if(!out)
+      return NULL;
 
-    queue->data[index] = queue->data[index+1];
-    index++;
+    unsigned int first = queue->cap - queue->head;
+    memcpy(out, &queue->data[queue->head], first * sizeof(Token));
+    memcpy(&out[first], queue->data, (queue->size - first) * sizeof(Token));
+
+    if(!queue->arena)
+      free(queue->data);
   }
 
-  queue->size--;
-  return token_dequeued; 
-}
-   
-/* Function to convert the current content into a NULL-terminated array (Required to the function that will evaluate the RPN)
-   It returns a new malloc
-   It receives a reference to the queue */
-char **Queue_to_array(TokenQueue *queue){
-  
-  // Transforms data[0...size-1] into a char** NULL terminated
-  char **out = malloc((queue->size+1) * sizeof(char*));
-  memcpy(out, queue->data, queue->size * sizeof(char*));
-  out[queue->size] = NULL;
-  
+  // Tokens that were dequeued left space in the beginning
+  else if(queue->head > 0)
+    memmove(out, &queue->data[queue->head], queue->size * sizeof(Token));
+
+  // Transforms out[0...size-1] into a Token* TOK_END terminated
+  out[queue->size].kind = TOK_END;
+  out[queue->size].offset = out[queue->size].length = 0;
+  out[queue->size].value = 0.0;
+
+  // The array now belongs to the caller
+  queue->data = NULL;
+  queue->head = queue->size = queue->cap = 0;
+
   return out;
 }
 
 // ------------------------------------------------ Double Stack ------------------------------------------------
 
-/* Function to create and initialize the stack
-   It receives a reference to the stack */
-void DoubleStack_init(DoubleStack *dstack){
+/* Function to create and initialize the stack (the stack points to itself, so it can not be copied after this)
+   It receives a reference to the stack and the arena to allocate from (NULL to use malloc) */
+void DoubleStack_init(DoubleStack *dstack, Arena *arena){
   
-  dstack->data = NULL;
-  dstack->size = dstack->cap = 0;
+  dstack->data = dstack->inline_data;
+  dstack->size = 0;
+  dstack->cap = STACK_INLINE_SIZE;
+  dstack->arena = arena;
 }
 
-/* Function to free the stack
+/* Function to free the stack (memory of a arena is only released by Arena_reset)
    It receives a reference to the stack to free */
 void DoubleStack_free(DoubleStack *dstack){
 
-  free(dstack->data);
-  dstack->data = NULL;
-  dstack->size = dstack->cap = 0;
+  if(!dstack->arena && dstack->data != dstack->inline_data)
+    free(dstack->data);
+  dstack->data = dstack->inline_data;
+  dstack->size = 0;
+  dstack->cap = STACK_INLINE_SIZE;
+}
+
+/* Function to make sure the stack can store a number of values, so the pushes after it never allocate memory
+   It returns false if memory allocation failed
+   It receives a reference to the stack and the number of values */
+bool DoubleStack_reserve(DoubleStack *dstack, unsigned int cap){
+
+  if(cap <= dstack->cap)
+    return true;
+
+  double *data;
+
+  // When the inline storage is not enough the values move to the arena or the heap
+  if(dstack->data == dstack->inline_data){
+    data = dstack->arena ? Arena_alloc(dstack->arena, cap * sizeof(double)) : malloc(cap * sizeof(double));
+    if(data)
+      memcpy(data, dstack->inline_data, dstack->size * sizeof(double));
+  }
+  else if(dstack->arena)
+    data = Arena_grow(dstack->arena, dstack->data, dstack->cap * sizeof(double), cap * sizeof(double));
+  else
+    data = realloc(dstack->data, cap * sizeof(double));
+
+  if(!data)
+    return false;
+
+  dstack->data = data;
+  dstack->cap = cap;
+  return true;
 }
       
 /* Function to tell whether the stack is empty or not
@@ -177,14 +278,9 @@ bool DoubleStack_is_empty(DoubleStack *dstack){
    It receives a reference to the stack and the token to push */
 void DoubleStack_push(DoubleStack *dstack, double value){
 
-  unsigned int cap = dstack->cap;
-  unsigned int size = dstack->size;
+  if(dstack->size == dstack->cap && !DoubleStack_reserve(dstack, dstack->cap*2))
+    return;
 
-  if(size == cap){
-    unsigned int newcap = cap ? cap*2 : 4;
-    dstack->data = realloc(dstack->data, newcap * sizeof(double));
-    dstack->cap = newcap;
-  }
   dstack->data[dstack->size++]=value;
 }
       
@@ -0,0 +1,391 @@
+/* This program is part of the math interpreter, it converts doubles into the shortest text that is read back as the same double (Grisu2 algorithm).
+   The double is scaled by a cached power of 10 so its digits are generated with 64 bits integer arithmetic only, without big numbers.
+   The scaling is not exact, so when a shorter text may exist near the borders of the interval (like for 1e23) it is searched with printf and strtod. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../include/format.h"
+
+#define FORMAT_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL // Bits of the significand of a double
+#define FORMAT_HIDDEN_BIT 0x0010000000000000ULL        // Implicit bit of the significand of normal doubles
+#define FORMAT_EXPONENT_BIAS 1075                      // Bias of the exponent of a double + 52 bits of significand
+#define FORMAT_FIXED_MIN_EXPONENT (-4)                 // Smallest exponent written without scientific notation
+#define FORMAT_FIXED_MAX_EXPONENT 16                   // Biggest exponent written without scientific notation
+
+/* Floating point number with 64 bits of significand, value = f * 2^e */
+typedef struct{
+
+  uint64_t f;
+  int e;
+} DiyFp;
+
+/* Powers of 10 from 10^-348 to 10^340 (step of 8) as normalized DiyFp, the significands are rounded to the nearest */
+static const DiyFp Format_cached_powers[] = {
+  {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193}, {0x8b16fb203055ac76ULL, -1166},
+  {0xcf42894a5dce35eaULL, -1140}, {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+  {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034}, {0xbe5691ef416bd60cULL, -1007},
+  {0x8dd01fad907ffc3cULL,  -980}, {0xd3515c2831559a83ULL,  -954}, {0x9d71ac8fada6c9b5ULL,  -927},
+  {0xea9c227723ee8bcbULL,  -901}, {0xaecc49914078536dULL,  -874}, {0x823c12795db6ce57ULL,  -847},
+  {0xc21094364dfb5637ULL,  -821}, {0x9096ea6f3848984fULL,  -794}, {0xd77485cb25823ac7ULL,  -768},
+  {0xa086cfcd97bf97f4ULL,  -741}, {0xef340a98172aace5ULL,  -715}, {0xb23867fb2a35b28eULL,  -688},
+  {0x84c8d4dfd2c63f3bULL,  -661}, {0xc5dd44271ad3cdbaULL,  -635}, {0x936b9fcebb25c996ULL,  -608},
+  {0xdbac6c247d62a584ULL,  -582}, {0xa3ab66580d5fdaf6ULL,  -555}, {0xf3e2f893dec3f126ULL,  -529},
+  {0xb5b5ada8aaff80b8ULL,  -502}, {0x87625f056c7c4a8bULL,  -475}, {0xc9bcff6034c13053ULL,  -449},
+  {0x964e858c91ba2655ULL,  -422}, {0xdff9772470297ebdULL,  -396}, {0xa6dfbd9fb8e5b88fULL,  -369},
+  {0xf8a95fcf88747d94ULL,  -343}, {0xb94470938fa89bcfULL,  -316}, {0x8a08f0f8bf0f156bULL,  -289},
+  {0xcdb02555653131b6ULL,  -263}, {0x993fe2c6d07b7facULL,  -236}, {0xe45c10c42a2b3b06ULL,  -210},
+  {0xaa242499697392d3ULL,  -183}, {0xfd87b5f28300ca0eULL,  -157}, {0xbce5086492111aebULL,  -130},
+  {0x8cbccc096f5088ccULL,  -103}, {0xd1b71758e219652cULL,   -77}, {0x9c40000000000000ULL,   -50},
+  {0xe8d4a51000000000ULL,   -24}, {0xad78ebc5ac620000ULL,     3}, {0x813f3978f8940984ULL,    30},
+  {0xc097ce7bc90715b3ULL,    56}, {0x8f7e32ce7bea5c70ULL,    83}, {0xd5d238a4abe98068ULL,   109},
+  {0x9f4f2726179a2245ULL,   136}, {0xed63a231d4c4fb27ULL,   162}, {0xb0de65388cc8ada8ULL,   189},
+  {0x83c7088e1aab65dbULL,   216}, {0xc45d1df942711d9aULL,   242}, {0x924d692ca61be758ULL,   269},
+  {0xda01ee641a708deaULL,   295}, {0xa26da3999aef774aULL,   322}, {0xf209787bb47d6b85ULL,   348},
+  {0xb454e4a179dd1877ULL,   375}, {0x865b86925b9bc5c2ULL,   402}, {0xc83553c5c8965d3dULL,   428},
+  {0x952ab45cfa97a0b3ULL,   455}, {0xde469fbd99a05fe3ULL,   481}, {0xa59bc234db398c25ULL,   508},
+  {0xf6c69a72a3989f5cULL,   534}, {0xb7dcbf5354e9beceULL,   561}, {0x88fcf317f22241e2ULL,   588},
+  {0xcc20ce9bd35c78a5ULL,   614}, {0x98165af37b2153dfULL,   641}, {0xe2a0b5dc971f303aULL,   667},
+  {0xa8d9d1535ce3b396ULL,   694}, {0xfb9b7cd9a4a7443cULL,   720}, {0xbb764c4ca7a44410ULL,   747},
+  {0x8bab8eefb6409c1aULL,   774}, {0xd01fef10a657842cULL,   800}, {0x9b10a4e5e9913129ULL,   827},
+  {0xe7109bfba19c0c9dULL,   853}, {0xac2820d9623bf429ULL,   880}, {0x80444b5e7aa7cf85ULL,   907},
+  {0xbf21e44003acdd2dULL,   933}, {0x8e679c2f5e44ff8fULL,   960}, {0xd433179d9c8cb841ULL,   986},
+  {0x9e19db92b4e31ba9ULL,  1013}, {0xeb96bf6ebadf77d9ULL,  1039}, {0xaf87023b9bf0ee6bULL,  1066},
+};
+
+#define FORMAT_CACHED_POWERS_FIRST (-348) // Exponent of 10 of the first cached power
+#define FORMAT_CACHED_POWERS_STEP 8       // Difference between the exponents of 10 of two cached powers
+
+static const uint64_t Format_powers_of_10[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+  10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+  10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* Function to shift the significand left until its highest bit is 1
+   It returns the normalized number and receives the number (its significand can not be 0) */
+static DiyFp Format_normalize(DiyFp x){
+
+  int shift = __builtin_clzll(x.f);
+  x.f <<= shift;
+  x.e -= shift;
+  return x;
+}
+
+/* Function to multiply two numbers, the 64 highest bits of the product are kept (rounded)
+   It returns the product and receives the numbers */
+static DiyFp Format_multiply(DiyFp x, DiyFp y){
+
+  unsigned __int128 product = (unsigned __int128) x.f * y.f;
+  DiyFp result = {(uint64_t)(product >> 64), x.e + y.e + 64};
+
+  if((uint64_t) product & (1ULL << 63))
+    result.f++;
+
+  return result;
+}
+
+/* Function to return the cached power of 10 that brings a number with binary exponent e to the exponents from -60 to -32
+   It returns the power (c = 10^-k) and receives the exponent and where to write k */
+static DiyFp Format_cached_power(int e, int *k){
+
+  double dk = (-61 - e) * 0.30102999566398114 + 347; // log10(2)
+  int rounded = (int) dk;
+  if(dk - rounded > 0.0)
+    rounded++;
+
+  unsigned int index = (rounded >> 3) + 1;
+  *k = -(FORMAT_CACHED_POWERS_FIRST + (int) index * FORMAT_CACHED_POWERS_STEP);
+  return Format_cached_powers[index];
+}
+
+/* Function to move the last digit closer to the exact value while it stays inside the interval of the numbers that round to the double
+   It receives the digits, how many there are, the size of the interval, the distance from the digits to the top of the interval,
+   the value of one unit of the last digit and the distance from the exact value to the top of the interval */
+static void Format_round(char *digits, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance){
+
+  while(rest < distance && delta - rest >= ten_kappa && (rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance)){
+    digits[length-1]--;
+    rest += ten_kappa;
+  }
+}
+
+/* Function to generate the shortest digits of a number inside the interval (high - delta, high)
+   The interval is 2 units bigger at each side than the one where the digits surely read back as the double, because the scaling is not exact:
+   the digits found are the shortest, and if they are also inside the smaller interval they are rounded inside it
+   It returns the number of digits, negative if they may not read back as the double (but no number with fewer digits does)
+   It receives the scaled number, the top of the interval, the size of the interval, the array of the digits and the decimal exponent (updated) */
+static int Format_digits(DiyFp w, DiyFp high, uint64_t delta, char *digits, int *k){
+
+  DiyFp one = {1ULL << -high.e, high.e};
+  uint64_t distance = high.f - w.f;
+  uint32_t integral = (uint32_t)(high.f >> -one.e);
+  uint64_t fractional = high.f & (one.f - 1);
+  int length = 0;
+
+  // Number of digits of the integral part
+  int kappa = 1;
+  while(kappa < 10 && integral >= Format_powers_of_10[kappa])
+    kappa++;
+
+  // Digits of the integral part
+  while(kappa > 0){
+
+    uint32_t digit = integral / Format_powers_of_10[kappa-1];
+    integral %= Format_powers_of_10[kappa-1];
+
+    if(digit || length)
+      digits[length++] = '0' + digit;
+    kappa--;
+
+    uint64_t rest = ((uint64_t) integral << -one.e) + fractional;
+    if(rest <= delta){
+
+      if(rest < 2 || delta - rest < 2)
+        return -length;
+
+      *k += kappa;
+      Format_round(digits, length, delta - 4, rest - 2, Format_powers_of_10[kappa] << -one.e, distance - 2);
+      return length;
+    }
+  }
+
+  // Digits of the fractional part
+  uint64_t unit = 1;
+  for(;;){
+
+    fractional *= 10;
+    delta *= 10;
+    unit *= 10;
+
+    char digit = (char)(fractional >> -one.e);
+    if(digit || length)
+      digits[length++] = '0' + digit;
+
+    fractional &= one.f - 1;
+    kappa--;
+
+    if(fractional < delta){
+
+      if(fractional < 2*unit || delta - fractional < 2*unit)
+        return -length;
+
+      *k += kappa;
+      Format_round(digits, length, delta - 4*unit, fractional - 2*unit, one.f, (distance - 2) * unit);
+      return length;
+    }
+  }
+}
+
+/* Function to search the shortest digits that read back as the double, for the few doubles that Format_digits can not decide (like 1e23)
+   For each number of digits, the nearest number is tried, and the next one (that can be the only one inside the interval when its lower
+   side is smaller, if the significand is a power of 2). With 17 digits the nearest number always reads back as the double
+   It returns the number of digits
+   It receives the positive double, the smallest number of digits to try, the array of the digits and where to write k */
+static int Format_shortest(double value, int minimum, char *digits, int *k){
+
+  for(int length=minimum; ; length++){
+
+    char text[FORMAT_DOUBLE_SIZE];
+    snprintf(text, sizeof(text), "%.*e", length-1, value);
+
+    char candidate[20];
+    char *exponent_text = strchr(text, 'e');
+    candidate[0] = text[0];
+    memcpy(&candidate[1], &text[2], length-1);
+    int exponent = atoi(&exponent_text[1]); // Exponent of the first digit
+
+    for(int next=0; next<2; next++){
+
+      if(next){
+
+        int i = length-1;
+        while(i >= 0 && candidate[i] == '9')
+          candidate[i--] = '0';
+        if(i < 0){
+          candidate[0] = '1';
+          exponent++;
+        }
+        else
+          candidate[i]++;
+      }
+
+      char number[FORMAT_DOUBLE_SIZE + 8];
+      snprintf(number, sizeof(number), "%.*se%d", length, candidate, exponent - length + 1);
+      if(length == 17 || strtod(number, NULL) == value){
+
+        while(length > 1 && candidate[length-1] == '0')
+          length--;
+        memcpy(digits, candidate, length);
+        *k = exponent - length + 1;
+        return length;
+      }
+    }
+  }
+}
+
+/* Function to generate the shortest digits of a positive double, value = digits * 10^k
+   It returns the number of digits
+   It receives the double, the array of the digits and where to write k */
+static int Format_grisu2(double value, char *digits, int *k){
+
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  int biased_exponent = (int)(bits >> 52);
+  DiyFp v = {bits & FORMAT_SIGNIFICAND_MASK, 1 - FORMAT_EXPONENT_BIAS};
+  if(biased_exponent){
+    v.f += FORMAT_HIDDEN_BIT;
+    v.e = biased_exponent - FORMAT_EXPONENT_BIAS;
+  }
+
+  // Boundaries of the interval of the numbers that round to the double (the lower one is closer when the significand is a power of 2)
+  DiyFp upper = {(v.f << 1) + 1, v.e - 1};
+  upper = Format_normalize(upper);
+
+  DiyFp lower = (v.f == FORMAT_HIDDEN_BIT) ? (DiyFp){(v.f << 2) - 1, v.e - 2} : (DiyFp){(v.f << 1) - 1, v.e - 1};
+  lower.f <<= lower.e - upper.e;
+  lower.e = upper.e;
+
+  DiyFp power = Format_cached_power(upper.e, k);
+
+  DiyFp w = Format_multiply(Format_normalize(v), power);
+  DiyFp high = Format_multiply(upper, power);
+  DiyFp low = Format_multiply(lower, power);
+
+  // The multiplication is not exact (1 unit at most), so the digits are searched in the interval made 1 unit bigger at each side,
+  // and they surely read back as the double only inside the interval made 1 unit smaller at each side
+  int minimum = 1;
+  if(high.f != UINT64_MAX){
+
+    int scaled_k = *k;
+    int length = Format_digits(w, (DiyFp){high.f + 1, high.e}, high.f - low.f + 2, digits, &scaled_k);
+    if(length > 0){
+      *k = scaled_k;
+      return length;
+    }
+    minimum = -length;
+  }
+
+  return Format_shortest(value, minimum, digits, k);
+}
+
+/* Function to write the exponent of the scientific notation, with sign and at least 2 digits (like printf)
+   It returns the number of chars written and receives the exponent and where to write it */
+static size_t Format_exponent(int exponent, char *buffer){
+
+  size_t length = 0;
+  buffer[length++] = 'e';
+  buffer[length++] = exponent < 0 ? '-' : '+';
+  if(exponent < 0)
+    exponent = -exponent;
+
+  if(exponent >= 100)
+    buffer[length++] = '0' + exponent / 100;
+  buffer[length++] = '0' + exponent / 10 % 10;
+  buffer[length++] = '0' + exponent % 10;
+
+  return length;
+}
+
+/* Function to write a double with the fewest digits that are read back (by strtod) as the same double
+   The text always reads back as the same double, and there is no shorter text that does (1e23 is written as 1e+23, not as 9.999999999999999e+22)
+   Numbers with exponent from -4 to 16 are written without exponent (like 0.001 or 123.25), the others in scientific notation (like 1e+21),
+   NAN is written as nan and infinity as inf or -inf
+   It returns the number of chars written (without the NULL terminator)
+   It receives the double and the array where the text is written (at least FORMAT_DOUBLE_SIZE chars) */
+size_t Format_double(double value, char *buffer){
+
+  size_t length = 0;
+
+  if(isnan(value)){
+    memcpy(buffer, "nan", 4);
+    return 3;
+  }
+
+  if(signbit(value)){
+    buffer[length++] = '-';
+    value = -value;
+  }
+
+  if(isinf(value)){
+    memcpy(&buffer[length], "inf", 4);
+    return length + 3;
+  }
+
+  if(value == 0.0){
+    memcpy(&buffer[length], "0", 2);
+    return length + 1;
+  }
+
+  char digits[20];
+  int k;
+  int count = Format_grisu2(value, digits, &k);
+  int exponent = count + k - 1; // Exponent of the first digit
+
+  // Without exponent: 123.25, 0.001 or 12300
+  if(exponent >= FORMAT_FIXED_MIN_EXPONENT && exponent <= FORMAT_FIXED_MAX_EXPONENT){
+
+    if(exponent < 0){
+
+      buffer[length++] = '0';
+      buffer[length++] = '.';
+      for(int i=-1; i>exponent; i--)
+        buffer[length++] = '0';
+      memcpy(&buffer[length], digits, count);
+      length += count;
+    }
+
+    else if(exponent+1 < count){
+
+      memcpy(&buffer[length], digits, exponent+1);
+      length += exponent+1;
+      buffer[length++] = '.';
+      memcpy(&buffer[length], &digits[exponent+1], count-exponent-1);
+      length += count-exponent-1;
+    }
+
+    else{
+
+      memcpy(&buffer[length], digits, count);
+      length += count;
+      for(int i=count; i<=exponent; i++)
+        buffer[length++] = '0';
+    }
+  }
+
+  // Scientific notation: 1.5e+300
+  else{
+
+    buffer[length++] = digits[0];
+    if(count > 1){
+      buffer[length++] = '.';
+      memcpy(&buffer[length], &digits[1], count-1);
+      length += count-1;
+    }
+    length += Format_exponent(exponent, &buffer[length]);
+  }
+
+  buffer[length] = '\0';
+  return length;
+}
+
+/* Function to write many doubles like Format_double into the same array, each one followed by a separator (like a new line)
+   It returns the number of chars written (without the NULL terminator)
+   It receives the doubles, how many there are, the separator and the array where the text is written (at least count*FORMAT_DOUBLE_SIZE+1 chars) */
+size_t Format_doubles(const double *values, size_t count, char separator, char *buffer){
+
+  size_t length = 0;
+
+  for(size_t i=0; i<count; i++){
+    length += Format_double(values[i], &buffer[length]);
+    buffer[length++] = separator;
+  }
+
+  buffer[length] = '\0';
+  return length;
+}
@@ -0,0 +1,474 @@
+/* This program is part of the math interpreter, it evaluates a expression while it is typed (like the live result of the calculator).
+   Every token applied to the Shunting-yard is a step that remembers the state before it and logs the pushes and pops of the stacks,
+   so a change at the end of the text undoes the steps of the number or name at the end (the only tokens that can change) and applies
+   the tokens of the new tail. Each char is lexed again only while it is part of that last number or name. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "../include/incremental.h"
+#include "../include/lexer.h"
+
+/* Function to return the state of a expression without tokens
+   It returns the state */
+static IncrementalState Incremental_initial_state(void){
+
+  IncrementalState state = {true, false, false, 0, TOK_END, {PARSE_OK, 0}};
+  return state;
+}
+
+/* Function to initialize a empty expression
+   It receives the expression */
+void Incremental_init(IncrementalExpr *expr){
+
+  memset(expr, 0, sizeof(IncrementalExpr));
+  expr->state = Incremental_initial_state();
+}
+
+/* Function to grow a array so it has space for a number of items
+   It returns false if memory allocation failed
+   It receives a reference to the array, a reference to its capacity, the number of items needed and the size of a item */
+static bool Incremental_reserve(void **array, size_t *cap, size_t needed, size_t item_size){
+
+  if(needed <= *cap)
+    return true;
+
+  size_t new_cap = *cap ? *cap : 16;
+  while(new_cap < needed)
+    new_cap *= 2;
+
+  void *grown = realloc(*array, new_cap * item_size);
+  if(!grown)
+    return false;
+
+  *array = grown;
+  *cap = new_cap;
+  return true;
+}
+
+/* Function to push a operator, the push is logged
+   It receives the expression (with space in the stack and in the log) and the operator */
+static void Incremental_push_operator(IncrementalExpr *expr, Token tok){
+
+  IncrementalChange change = {.pushed = true};
+  expr->operator_log[expr->operator_log_count++] = change;
+  expr->operators[expr->operator_count++] = tok;
+}
+
+/* Function to pop a operator, the popped operator is logged
+   It returns the operator and receives the expression (with space in the log) */
+static Token Incremental_pop_operator(IncrementalExpr *expr){
+
+  Token tok = expr->operators[--expr->operator_count];
+  IncrementalChange change = {.pushed = false, .token = tok};
+  expr->operator_log[expr->operator_log_count++] = change;
+  return tok;
+}
+
+/* Function to push a value, the push is logged
+   It receives the expression (with space in the stack and in the log) and the value */
+static void Incremental_push_value(IncrementalExpr *expr, IncrementalValue value){
+
+  IncrementalChange change = {.pushed = true};
+  expr->value_log[expr->value_log_count++] = change;
+  expr->values[expr->value_count++] = value;
+}
+
+/* Function to pop a value, the popped value is logged
+   It returns the value and receives the expression (with space in the log) */
+static IncrementalValue Incremental_pop_value(IncrementalExpr *expr){
+
+  IncrementalValue value = expr->values[--expr->value_count];
+  IncrementalChange change = {.pushed = false, .value = value};
+  expr->value_log[expr->value_log_count++] = change;
+  return value;
+}
+
+/* Function to execute a operator or function over values, with the constant folding of the optimizer
+   It returns the result and receives the operator and the operands (b is ignored by unary operators) */
+static IncrementalValue Incremental_fold(TokenKind op, IncrementalValue a, IncrementalValue b){
+
+  Opcode opcode = OP_ADD;
+  Bytecode_opcode_of(op, &opcode);
+
+  IncrementalValue result = {a.is_known && b.is_known, Bytecode_constant(0.0)};
+  if(result.is_known)
+    result.constant = Bytecode_fold_constant(opcode, a.constant, b.constant);
+
+  return result;
+}
+
+/* Function to execute a operator popped by the Shunting-yard (where the parser puts it in the RPN)
+   It receives the expression and the operator */
+static void Incremental_apply_operator(IncrementalExpr *expr, TokenKind op){
+
+  IncrementalValue b = Incremental_pop_value(expr);
+  IncrementalValue a = Parser_arity_of(op) == 2 ? Incremental_pop_value(expr) : b;
+
+  Incremental_push_value(expr, Incremental_fold(op, a, b));
+}
+
+/* Function to set the syntax error of the expression, the next tokens are ignored
+   It receives the expression, the kind of the error and the position of the char where it was found */
+static void Incremental_set_error(IncrementalExpr *expr, ParseErrorKind kind, unsigned int position){
+
+  expr->state.error.kind = kind;
+  expr->state.error.position = position;
+}
+
+/* Function to apply a token to the Shunting-yard, with the same rules as Parser_Shunting_yard
+   The parser looks at the next token after a function and a unary '-', here those checks are done by the next token
+   It returns false if memory allocation failed (nothing is changed then)
+   It receives the expression and the token */
+static bool Incremental_apply(IncrementalExpr *expr, Token tok){
+
+  if(expr->state.error.kind != PARSE_OK)
+    return true;
+
+  // Space for the worst case: every operator is popped, each one pops two values and pushes one
+  if(!Incremental_reserve((void **) &expr->steps, &expr->step_cap, expr->step_count + 1, sizeof(IncrementalStep)) ||
+     !Incremental_reserve((void **) &expr->operators, &expr->operator_cap, expr->operator_count + 1, sizeof(Token)) ||
+     !Incremental_reserve((void **) &expr->values, &expr->value_cap, expr->value_count + 1, sizeof(IncrementalValue)) ||
+     !Incremental_reserve((void **) &expr->operator_log, &expr->operator_log_cap, expr->operator_log_count + expr->operator_count + 1, sizeof(IncrementalChange)) ||
+     !Incremental_reserve((void **) &expr->value_log, &expr->value_log_cap, expr->value_log_count + 3*expr->operator_count + 1, sizeof(IncrementalChange)))
+    return false;
+
+  IncrementalStep step = {tok.offset, expr->operator_log_count, expr->value_log_count, expr->state};
+  expr->steps[expr->step_count++] = step;
+
+  IncrementalState *state = &expr->state;
+  state->previous = tok.kind;
+
+  // A function must be followed by "("
+  if(state->expect_open_paren && tok.kind != TOK_OPEN_PAREN){
+    Incremental_set_error(expr, PARSE_MISSING_OPEN_PAREN, tok.offset);
+    return true;
+  }
+
+  // A unary "-" can not be followed by another "-"
+  if(state->after_negate && tok.kind == TOK_MINUS){
+    Incremental_set_error(expr, PARSE_MISSING_OPERAND, state->negate_position);
+    return true;
+  }
+
+  state->expect_open_paren = false;
+  state->after_negate = false;
+
+  if(tok.kind == TOK_INVALID){
+    Incremental_set_error(expr, PARSE_INVALID_TOKEN, tok.offset);
+    return true;
+  }
+
+  if(state->expect_operand){
+
+    // Numbers and variables are pushed as values
+    if(Parser_is_operand(tok.kind)){
+
+      IncrementalValue value = {tok.kind == TOK_NUMBER, Bytecode_constant(tok.kind == TOK_NUMBER ? tok.value : 0.0)};
+      Incremental_push_value(expr, value);
+      state->expect_operand = false;
+    }
+
+    else if(Parser_is_function(tok.kind)){
+      Incremental_push_operator(expr, tok);
+      state->expect_open_paren = true;
+    }
+
+    else if(tok.kind == TOK_OPEN_PAREN)
+      Incremental_push_operator(expr, tok);
+
+    else if(tok.kind == TOK_MINUS){
+
+      tok.kind = TOK_NEGATE;
+      Incremental_push_operator(expr, tok); // Nothing has a higher precedence, so nothing is popped
+      state->after_negate = true;
+      state->negate_position = tok.offset;
+    }
+
+    else
+      Incremental_set_error(expr, PARSE_MISSING_OPERAND, tok.offset);
+  }
+
+  else{
+
+    if(Parser_is_operator(tok.kind)){
+
+      while(expr->operator_count > 0){
+
+        TokenKind top = expr->operators[expr->operator_count-1].kind;
+
+        if(Parser_is_any_operator(top) && ((Parser_assoc_of(tok.kind)==LEFT && Parser_precedence_of(tok.kind) <= Parser_precedence_of(top)) || (Parser_assoc_of(tok.kind)==RIGHT && Parser_precedence_of(tok.kind) < Parser_precedence_of(top))))
+          Incremental_apply_operator(expr, Incremental_pop_operator(expr).kind);
+        else
+          break;
+      }
+
+      Incremental_push_operator(expr, tok);
+      state->expect_operand = true;
+    }
+
+    // Apply the operators until "(", then the function before it
+    else if(tok.kind == TOK_CLOSE_PAREN){
+
+      while(expr->operator_count > 0 && expr->operators[expr->operator_count-1].kind != TOK_OPEN_PAREN)
+        Incremental_apply_operator(expr, Incremental_pop_operator(expr).kind);
+
+      if(expr->operator_count == 0){
+        Incremental_set_error(expr, PARSE_UNMATCHED_CLOSE_PAREN, tok.offset);
+        return true;
+      }
+
+      Incremental_pop_operator(expr);
+
+      if(expr->operator_count > 0 && Parser_is_function(expr->operators[expr->operator_count-1].kind))
+        Incremental_apply_operator(expr, Incremental_pop_operator(expr).kind);
+    }
+
+    else
+      Incremental_set_error(expr, PARSE_MISSING_OPERATOR, tok.offset);
+  }
+
+  return true;
+}
+
+/* Function to undo the last step, the stacks and the state go back to what they were before its token
+   It receives the expression (with at least one step) */
+static void Incremental_undo(IncrementalExpr *expr){
+
+  IncrementalStep step = expr->steps[--expr->step_count];
+
+  while(expr->operator_log_count > step.operator_changes){
+
+    IncrementalChange change = expr->operator_log[--expr->operator_log_count];
+    if(change.pushed)
+      expr->operator_count--;
+    else
+      expr->operators[expr->operator_count++] = change.token;
+  }
+
+  while(expr->value_log_count > step.value_changes){
+
+    IncrementalChange change = expr->value_log[--expr->value_log_count];
+    if(change.pushed)
+      expr->value_count--;
+    else
+      expr->values[expr->value_count++] = change.value;
+  }
+
+  expr->state = step.state;
+}
+
+/* Function to tell if a char continues the number or name before it (the same runs of chars as the streaming lexer)
+   It returns true if it does, and receives the text and the position of the char */
+static bool Incremental_continues_run(const char *text, size_t position){
+
+  unsigned char c = text[position];
+  if(isalnum(c) || c == '.' || c == '_')
+    return true;
+
+  char last = position > 0 ? text[position-1] : '\0';
+  return (c == '+' || c == '-') && (last == 'e' || last == 'E' || last == 'p' || last == 'P');
+}
+
+/* Function to find where the number or name at the end of the first chars of the text starts
+   The lexer gives the same tokens to the chars before it with or without the chars after it
+   It returns the position of its first char (the end if the text does not end with a number or name)
+   It receives the text and the number of chars */
+static size_t Incremental_run_start(const char *text, size_t end){
+
+  size_t start = end;
+  while(start > 0 && Incremental_continues_run(text, start-1))
+    start--;
+
+  // '_' and signs only continue a number or name, they do not start one
+  while(start < end && !isalnum((unsigned char) text[start]) && text[start] != '.')
+    start++;
+
+  return start;
+}
+
+/* Function to update the tokens after a change of the end of the text: the steps of the tokens that may change are undone
+   and the tail of the text is lexed again
+   It returns false if memory allocation failed
+   It receives the expression and the position of the first char that changed */
+static bool Incremental_update(IncrementalExpr *expr, size_t changed){
+
+  if(expr->out_of_memory)
+    return false;
+
+  size_t start = Incremental_run_start(expr->text, changed);
+  size_t end_start = Incremental_run_start(expr->text, expr->length);
+  if(end_start < start)
+    start = end_start;
+
+  while(expr->step_count > 0 && expr->steps[expr->step_count-1].offset >= start)
+    Incremental_undo(expr);
+
+  if(start == expr->length)
+    return true;
+
+  Token *tokens = Lexer_tokenize_span(&expr->text[start], expr->length - start, NULL);
+  bool ok = tokens != NULL;
+
+  for(size_t i=0; ok && tokens[i].kind != TOK_END; i++){
+
+    Token tok = tokens[i];
+    tok.offset += start;
+
+    // The '*' between the tail and the token before it (the lexer adds the ones inside the tail)
+    if(i == 0 && Lexer_needs_multiply(expr->state.previous, tok.kind)){
+
+      Token multiply = {TOK_MULTIPLY, tok.offset, 0, 0.0};
+      ok = Incremental_apply(expr, multiply);
+    }
+
+    ok = ok && Incremental_apply(expr, tok);
+  }
+
+  free(tokens);
+
+  if(!ok)
+    expr->out_of_memory = true;
+
+  return ok;
+}
+
+/* Function to add chars to the end of the expression
+   It returns false if memory allocation failed (the result is PARSE_OUT_OF_MEMORY until Incremental_clear)
+   It receives the expression, the chars and their number */
+bool Incremental_append(IncrementalExpr *expr, const char *chars, size_t count){
+
+  if(!Incremental_reserve((void **) &expr->text, &expr->text_cap, expr->length + count + 1, sizeof(char))){
+    expr->out_of_memory = true;
+    return false;
+  }
+
+  size_t changed = expr->length;
+  memcpy(&expr->text[expr->length], chars, count);
+  expr->length += count;
+  expr->text[expr->length] = '\0';
+
+  return Incremental_update(expr, changed);
+}
+
+/* Function to remove chars from the end of the expression
+   It returns false if memory allocation failed (the result is PARSE_OUT_OF_MEMORY until Incremental_clear)
+   It receives the expression and the number of chars (at most its length) */
+bool Incremental_remove(IncrementalExpr *expr, size_t count){
+
+  if(count > expr->length)
+    count = expr->length;
+  if(count == 0)
+    return !expr->out_of_memory;
+
+  expr->length -= count;
+  expr->text[expr->length] = '\0';
+
+  return Incremental_update(expr, expr->length);
+}
+
+/* Function to make the expression empty again, keeping its memory
+   It receives the expression */
+void Incremental_clear(IncrementalExpr *expr){
+
+  expr->length = 0;
+  if(expr->text)
+    expr->text[0] = '\0';
+
+  expr->operator_count = 0;
+  expr->value_count = 0;
+  expr->operator_log_count = 0;
+  expr->value_log_count = 0;
+  expr->step_count = 0;
+  expr->state = Incremental_initial_state();
+  expr->out_of_memory = false;
+}
+
+/* Function to return the text of the expression (with NULL terminator, valid until the next change)
+   It receives the expression */
+const char *Incremental_text(const IncrementalExpr *expr){
+
+  return expr->text ? expr->text : "";
+}
+
+/* Function to return the result of the expression, its work only depends on the depth of the open operators and parentheses
+   The operators left in the stack are applied like at the end of Parser_Shunting_yard, without changing the stacks
+   It returns true if the expression has a result, false if it has a syntax error or variables (error->kind is PARSE_OK then)
+   It receives the expression, where the result is written and a reference to the error (can be NULL) */
+bool Incremental_result(const IncrementalExpr *expr, double *result, ParseError *error){
+
+  ParseError local_error;
+  if(!error)
+    error = &local_error;
+
+  *error = expr->state.error;
+
+  if(expr->out_of_memory){
+    error->kind = PARSE_OUT_OF_MEMORY;
+    error->position = 0;
+    return false;
+  }
+
+  if(error->kind != PARSE_OK)
+    return false;
+
+  // The function at the end is not followed by "("
+  if(expr->state.expect_open_paren){
+    error->kind = PARSE_MISSING_OPEN_PAREN;
+    error->position = expr->length;
+    return false;
+  }
+
+  // The empty expression is the only one that can end without operand (its result is 0, like an empty RPN)
+  if(expr->state.expect_operand){
+
+    if(expr->operator_count == 0 && expr->value_count == 0){
+      *result = 0.0;
+      return true;
+    }
+
+    error->kind = PARSE_MISSING_OPERAND;
+    error->position = expr->length;
+    return false;
+  }
+
+  // Apply the operators left from the top, a "(" left means that the parentheses are not balanced
+  IncrementalValue value = expr->values[expr->value_count-1];
+  size_t below = expr->value_count-1;
+
+  for(size_t i=expr->operator_count; i>0; i--){
+
+    Token op = expr->operators[i-1];
+    if(op.kind == TOK_OPEN_PAREN){
+      error->kind = PARSE_UNMATCHED_OPEN_PAREN;
+      error->position = op.offset;
+      return false;
+    }
+
+    IncrementalValue a = Parser_arity_of(op.kind) == 2 ? expr->values[--below] : value;
+    value = Incremental_fold(op.kind, a, value);
+  }
+
+  // Variables have no value
+  if(!value.is_known)
+    return false;
+
+  *result = value.constant.value;
+  return true;
+}
+
+/* Function to free the memory of the expression
+   It receives the expression */
+void Incremental_free(IncrementalExpr *expr){
+
+  free(expr->text);
+  free(expr->operators);
+  free(expr->values);
+  free(expr->operator_log);
+  free(expr->value_log);
+  free(expr->steps);
+  Incremental_init(expr);
+}
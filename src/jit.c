@@ -0,0 +1,388 @@
+/* This program is part of the math interpreter, it compiles the bytecode into native x86-64 machine code (JIT).
+   The value at depth d of the stack of the bytecode lives in the register xmm<d>, so each instruction becomes one or two SSE instructions.
+   mod and pow call C functions, the registers in use are saved in the machine stack around the call (System V calling convention).
+   The code is written in a buffer, copied to pages from mmap and then made executable (never writable and executable at once). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../include/jit.h"
+#include "../include/kernels.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(MATH_NO_JIT)
+  #define JIT_X86_64
+  #include <sys/mman.h>
+#endif
+
+#ifdef JIT_X86_64
+
+// Data at the start of the pages, addressed relative to the instruction pointer
+#define JIT_SIGN_MASK_OFFSET 0   // 16 bytes, sign bit of the first double (xorpd needs them aligned)
+#define JIT_ZERO_OFFSET 16       // 0.0
+#define JIT_NAN_OFFSET 24        // NAN, result of division by 0 and of the square root of negative numbers
+#define JIT_CONSTANTS_OFFSET 32  // Constant pool of the bytecode
+
+#define JIT_SPILL_BYTES (JIT_MAX_DEPTH * 8 + 8) // Where the registers are saved around calls (the 8 more keep the stack aligned to 16 bytes)
+
+// SSE prefixes and opcodes (after 0x0F)
+#define JIT_SD 0xF2       // Scalar double
+#define JIT_PD 0x66       // Packed double
+#define JIT_MOVSD_LOAD 0x10
+#define JIT_MOVSD_STORE 0x11
+#define JIT_MOVAPD 0x28
+#define JIT_UCOMISD 0x2E
+#define JIT_SQRTSD 0x51
+#define JIT_XORPD 0x57
+#define JIT_ADDSD 0x58
+#define JIT_MULSD 0x59
+#define JIT_SUBSD 0x5C
+#define JIT_DIVSD 0x5E
+
+// Buffer where the machine code is written
+typedef struct{
+
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+  bool failed; // Memory allocation failed
+} JitBuffer;
+
+// ------------------------------------------------ Emitter ------------------------------------------------
+
+/* Function to write bytes at the end of the buffer
+   It receives the buffer, the bytes and the number of bytes */
+static void Jit_emit(JitBuffer *buffer, const void *bytes, size_t count){
+
+  if(buffer->failed)
+    return;
+
+  if(buffer->size + count > buffer->capacity){
+
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+    while(capacity < buffer->size + count)
+      capacity *= 2;
+
+    unsigned char *data = realloc(buffer->data, capacity);
+    if(!data){
+      buffer->failed = true;
+      return;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(&buffer->data[buffer->size], bytes, count);
+  buffer->size += count;
+}
+
+static void Jit_byte(JitBuffer *buffer, unsigned char byte){
+
+  Jit_emit(buffer, &byte, 1);
+}
+
+static void Jit_u32(JitBuffer *buffer, uint32_t value){
+
+  unsigned char bytes[4] = {value, value >> 8, value >> 16, value >> 24};
+  Jit_emit(buffer, bytes, 4);
+}
+
+/* Function to write the start of a SSE instruction: prefix, REX (only if a register is xmm8 or above) and opcode
+   It receives the buffer, the prefix, the opcode, the register of the reg field and the REX bits of the other operand (X and B) */
+static void Jit_sse_start(JitBuffer *buffer, unsigned char prefix, unsigned char opcode, unsigned int reg, unsigned char rex){
+
+  Jit_byte(buffer, prefix);
+  rex |= reg >= 8 ? 0x04 : 0x00;
+  if(rex)
+    Jit_byte(buffer, 0x40 | rex);
+  Jit_byte(buffer, 0x0F);
+  Jit_byte(buffer, opcode);
+}
+
+/* Function to write a SSE instruction between two registers
+   It receives the buffer, the prefix, the opcode, the destination register and the source register */
+static void Jit_sse(JitBuffer *buffer, unsigned char prefix, unsigned char opcode, unsigned int reg, unsigned int rm){
+
+  Jit_sse_start(buffer, prefix, opcode, reg, rm >= 8 ? 0x01 : 0x00);
+  Jit_byte(buffer, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+/* Function to write a SSE instruction whose memory operand is in the data at the start of the pages ([rip + displacement])
+   It receives the buffer, the prefix, the opcode, the register and the offset of the data */
+static void Jit_sse_data(JitBuffer *buffer, unsigned char prefix, unsigned char opcode, unsigned int reg, size_t offset){
+
+  Jit_sse_start(buffer, prefix, opcode, reg, 0);
+  Jit_byte(buffer, 0x05 | (reg & 7) << 3);
+  Jit_u32(buffer, (uint32_t) (offset - (buffer->size + 4))); // Relative to the end of the instruction
+}
+
+/* Function to write a SSE instruction whose memory operand is in the spill area of the machine stack ([rsp + displacement])
+   It receives the buffer, the prefix, the opcode, the register and the displacement */
+static void Jit_sse_spill(JitBuffer *buffer, unsigned char prefix, unsigned char opcode, unsigned int reg, uint32_t displacement){
+
+  Jit_sse_start(buffer, prefix, opcode, reg, 0);
+  Jit_byte(buffer, 0x84 | (reg & 7) << 3);
+  Jit_byte(buffer, 0x24);
+  Jit_u32(buffer, displacement);
+}
+
+/* Function to write a short conditional jump whose target is written later (see Jit_patch_jump)
+   It returns the position of the displacement, and receives the buffer and the opcode of the jump */
+static size_t Jit_jump(JitBuffer *buffer, unsigned char opcode){
+
+  Jit_byte(buffer, opcode);
+  Jit_byte(buffer, 0);
+  return buffer->size - 1;
+}
+
+/* Function to make a short jump land on the end of the buffer
+   It receives the buffer and the position of the displacement of the jump */
+static void Jit_patch_jump(JitBuffer *buffer, size_t position){
+
+  if(!buffer->failed)
+    buffer->data[position] = (unsigned char) (buffer->size - (position + 1));
+}
+
+// ------------------------------------------------ Operations ------------------------------------------------
+
+/* Function of the mod of the bytecode, called by the native code
+   It returns the result and receives the operands */
+static double Jit_mod(double a, double b){
+
+  return b==0.0 ? NAN : fmod(a, b); // Division by 0 -> NAN
+}
+
+/* Function to write a call to a binary C function over the two values of the top of the stack, the result replaces them
+   It receives the buffer, the function and the depth of the stack before the operation */
+static void Jit_call(JitBuffer *buffer, double (*function)(double, double), unsigned int depth){
+
+  for(unsigned int i=0; i<depth; i++)
+    Jit_sse_spill(buffer, JIT_SD, JIT_MOVSD_STORE, i, i*8);
+
+  Jit_sse_spill(buffer, JIT_SD, JIT_MOVSD_LOAD, 0, (depth-2)*8);
+  Jit_sse_spill(buffer, JIT_SD, JIT_MOVSD_LOAD, 1, (depth-1)*8);
+
+  // mov rax, function; call rax
+  uint64_t address = (uint64_t) (uintptr_t) function;
+  Jit_byte(buffer, 0x48);
+  Jit_byte(buffer, 0xB8);
+  Jit_u32(buffer, (uint32_t) address);
+  Jit_u32(buffer, (uint32_t) (address >> 32));
+  Jit_byte(buffer, 0xFF);
+  Jit_byte(buffer, 0xD0);
+
+  if(depth-2 != 0)
+    Jit_sse(buffer, JIT_PD, JIT_MOVAPD, depth-2, 0);
+
+  for(unsigned int i=0; i+2<depth; i++)
+    Jit_sse_spill(buffer, JIT_SD, JIT_MOVSD_LOAD, i, i*8);
+}
+
+/* Function to write the native code of one instruction of the bytecode
+   The columns are in rbx and the index of the row in r14
+   It receives the buffer, the instruction and the depth of the stack before it */
+static void Jit_instruction(JitBuffer *buffer, Instruction instruction, unsigned int depth){
+
+  unsigned int top = depth-1; // Register of the value of the top of the stack (b for binary operations, a for unary ones)
+  unsigned int a = depth-2;   // Register of the first operand of binary operations, where their result goes
+  size_t skip, skip_unordered;
+
+  switch(instruction.op){
+
+    case OP_CONST:
+      Jit_sse_data(buffer, JIT_SD, JIT_MOVSD_LOAD, depth, JIT_CONSTANTS_OFFSET + instruction.arg*8);
+      break;
+
+    case OP_VAR:
+      // mov rax, [rbx + 8*arg]; movsd xmm, [rax + r14*8]
+      Jit_byte(buffer, 0x48);
+      Jit_byte(buffer, 0x8B);
+      Jit_byte(buffer, 0x83);
+      Jit_u32(buffer, instruction.arg*8);
+      Jit_sse_start(buffer, JIT_SD, JIT_MOVSD_LOAD, depth, 0x02);
+      Jit_byte(buffer, 0x04 | (depth & 7) << 3);
+      Jit_byte(buffer, 0xF0);
+      break;
+
+    case OP_DUP:
+      Jit_sse(buffer, JIT_PD, JIT_MOVAPD, depth, top);
+      break;
+
+    case OP_NEG:
+      Jit_sse_data(buffer, JIT_PD, JIT_XORPD, top, JIT_SIGN_MASK_OFFSET);
+      break;
+
+    // Negative numbers -> NAN (the flags of the comparison are kept by sqrtsd)
+    case OP_SQRT:
+      Jit_sse_data(buffer, JIT_PD, JIT_UCOMISD, top, JIT_ZERO_OFFSET);
+      Jit_sse(buffer, JIT_SD, JIT_SQRTSD, top, top);
+      skip_unordered = Jit_jump(buffer, 0x7A); // jp: the value is NAN
+      skip = Jit_jump(buffer, 0x73);           // jae: the value is not negative
+      Jit_sse_data(buffer, JIT_SD, JIT_MOVSD_LOAD, top, JIT_NAN_OFFSET);
+      Jit_patch_jump(buffer, skip_unordered);
+      Jit_patch_jump(buffer, skip);
+      break;
+
+    case OP_ADD: Jit_sse(buffer, JIT_SD, JIT_ADDSD, a, top); break;
+    case OP_SUB: Jit_sse(buffer, JIT_SD, JIT_SUBSD, a, top); break;
+    case OP_MUL: Jit_sse(buffer, JIT_SD, JIT_MULSD, a, top); break;
+
+    // Division by 0 -> NAN
+    case OP_DIV:
+      Jit_sse_data(buffer, JIT_PD, JIT_UCOMISD, top, JIT_ZERO_OFFSET);
+      Jit_sse(buffer, JIT_SD, JIT_DIVSD, a, top);
+      skip_unordered = Jit_jump(buffer, 0x7A); // jp: the divisor is NAN
+      skip = Jit_jump(buffer, 0x75);           // jne: the divisor is not 0
+      Jit_sse_data(buffer, JIT_SD, JIT_MOVSD_LOAD, a, JIT_NAN_OFFSET);
+      Jit_patch_jump(buffer, skip_unordered);
+      Jit_patch_jump(buffer, skip);
+      break;
+
+    case OP_MOD: Jit_call(buffer, Jit_mod, depth); break;
+    case OP_POW: Jit_call(buffer, Kernels_pow, depth); break;
+  }
+}
+
+// ------------------------------------------------ Compilation ------------------------------------------------
+
+/* Function to compile optimized bytecode into native code, with the same results as Bytecode_evaluate_batch
+   It returns false if there is no JIT for this architecture, the stack of the bytecode is deeper than JIT_MAX_DEPTH
+   or memory allocation failed (jit->function is NULL then)
+   It receives a reference to the bytecode and the native code to fill */
+bool Jit_compile(const Bytecode *bytecode, JitCode *jit){
+
+  jit->function = NULL;
+  jit->memory = NULL;
+  jit->size = 0;
+
+  if(bytecode->size == 0 || bytecode->max_depth > JIT_MAX_DEPTH)
+    return false;
+
+  JitBuffer buffer = {NULL, 0, 0, false};
+
+  // Data: sign mask, 0, NAN and the constant pool
+  uint64_t sign_mask[2] = {UINT64_C(1) << 63, 0};
+  double zero = 0.0, nan_value = NAN;
+  Jit_emit(&buffer, sign_mask, sizeof(sign_mask));
+  Jit_emit(&buffer, &zero, sizeof(zero));
+  Jit_emit(&buffer, &nan_value, sizeof(nan_value));
+  Jit_emit(&buffer, bytecode->constants, bytecode->constant_count * sizeof(double));
+  while(buffer.size % 16)
+    Jit_byte(&buffer, 0xCC);
+
+  size_t entry = buffer.size;
+
+  // Save rbx, r12, r13 and r14, keep the columns, the rows and out in them and make room for the spill area
+  static const unsigned char prologue[] = {
+    0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, // push rbx; push r12; push r13; push r14
+    0x48, 0x81, 0xEC, JIT_SPILL_BYTES, 0, 0, 0, // sub rsp, JIT_SPILL_BYTES
+    0x48, 0x89, 0xFB,                         // mov rbx, rdi
+    0x49, 0x89, 0xF4,                         // mov r12, rsi
+    0x49, 0x89, 0xD5,                         // mov r13, rdx
+    0x4D, 0x85, 0xE4,                         // test r12, r12
+    0x0F, 0x84                                // jz end (displacement written below)
+  };
+  Jit_emit(&buffer, prologue, sizeof(prologue));
+  size_t jump_to_end = buffer.size;
+  Jit_u32(&buffer, 0);
+
+  static const unsigned char loop_start[] = {0x45, 0x31, 0xF6}; // xor r14d, r14d
+  Jit_emit(&buffer, loop_start, sizeof(loop_start));
+  size_t loop = buffer.size;
+
+  unsigned int depth = 0;
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    Instruction instruction = bytecode->code[i];
+    Jit_instruction(&buffer, instruction, depth);
+
+    switch(instruction.op){
+      case OP_CONST: case OP_VAR: case OP_DUP: depth++; break;
+      case OP_NEG: case OP_SQRT:              break;
+      default:                                depth--; break;
+    }
+  }
+
+  static const unsigned char loop_end[] = {
+    0xF2, 0x43, 0x0F, 0x11, 0x44, 0xF5, 0x00, // movsd [r13 + r14*8], xmm0
+    0x49, 0xFF, 0xC6,                         // inc r14
+    0x4D, 0x39, 0xE6,                         // cmp r14, r12
+    0x0F, 0x82                                // jb loop (displacement written below)
+  };
+  Jit_emit(&buffer, loop_end, sizeof(loop_end));
+  Jit_u32(&buffer, (uint32_t) (loop - (buffer.size + 4)));
+
+  if(!buffer.failed){
+    uint32_t displacement = (uint32_t) (buffer.size - (jump_to_end + 4));
+    memcpy(&buffer.data[jump_to_end], &displacement, 4);
+  }
+
+  static const unsigned char epilogue[] = {
+    0x48, 0x81, 0xC4, JIT_SPILL_BYTES, 0, 0, 0, // add rsp, JIT_SPILL_BYTES
+    0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B,  // pop r14; pop r13; pop r12; pop rbx
+    0xC3                                       // ret
+  };
+  Jit_emit(&buffer, epilogue, sizeof(epilogue));
+
+  if(buffer.failed){
+    free(buffer.data);
+    return false;
+  }
+
+  // Write the code to new pages and then make them executable
+  void *memory = mmap(NULL, buffer.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(memory == MAP_FAILED){
+    free(buffer.data);
+    return false;
+  }
+
+  memcpy(memory, buffer.data, buffer.size);
+  free(buffer.data);
+
+  if(mprotect(memory, buffer.size, PROT_READ | PROT_EXEC) != 0){
+    munmap(memory, buffer.size);
+    return false;
+  }
+
+  jit->memory = memory;
+  jit->size = buffer.size;
+  jit->function = (JitFunction) (void (*)(void)) ((unsigned char *) memory + entry);
+  return true;
+}
+
+/* Function to free the native code
+   It receives a reference to the native code */
+void Jit_free(JitCode *jit){
+
+  if(jit->memory)
+    munmap(jit->memory, jit->size);
+
+  jit->function = NULL;
+  jit->memory = NULL;
+  jit->size = 0;
+}
+
+#else
+
+// There is no JIT for this architecture (or it was disabled), the bytecode interpreter is used
+
+bool Jit_compile(const Bytecode *bytecode, JitCode *jit){
+
+  (void) bytecode;
+  jit->function = NULL;
+  jit->memory = NULL;
+  jit->size = 0;
+  return false;
+}
+
+void Jit_free(JitCode *jit){
+
+  jit->function = NULL;
+  jit->memory = NULL;
+  jit->size = 0;
+}
+
+#endif
@@ -0,0 +1,418 @@
+/* This program is part of the math interpreter, it implements the kernels used by the batch evaluation (one operation over a block of rows).
+   There is one version of the kernels for each instruction set (AVX-512, AVX2, SSE2, NEON and scalar), the best one is chosen at runtime. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../include/kernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #define KERNELS_X86 // The AVX2 and AVX-512 kernels are compiled with target attributes and chosen by CPU detection
+  #include <immintrin.h>
+#elif defined(__aarch64__)
+  #define KERNELS_ARM // NEON is always available on aarch64
+  #include <arm_neon.h>
+#endif
+
+// ------------------------------------------------ Scalar ------------------------------------------------
+
+/* Function to raise a number to a power, integer exponents up to KERNELS_MAX_SQUARING_EXPONENT use a squaring loop instead of pow
+   (the result may differ from pow in the last digits)
+   It returns the power and receives the base and the exponent */
+double Kernels_pow(double a, double b){
+
+  if(!(fabs(b) <= KERNELS_MAX_SQUARING_EXPONENT) || b != trunc(b))
+    return pow(a, b);
+
+  unsigned int n = (unsigned int) fabs(b);
+  double base = a;
+  double result = 1.0;
+
+  while(n){
+    if(n & 1)
+      result *= base;
+    n >>= 1;
+    if(n)
+      base *= base;
+  }
+
+  if(b > 0)
+    return result;
+
+  // 1/x^n loses the numbers near the limits of the doubles (x^n is 0 or infinity but 1/x^n is not)
+  return result == 0.0 || isinf(result) ? pow(a, b) : 1.0 / result;
+}
+
+static void Kernels_neg_scalar(double *out, const double *a, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = -a[i];
+}
+
+static void Kernels_sqrt_scalar(double *out, const double *a, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = a[i]<0 ? NAN : sqrt(a[i]); // If the number is negative -> NAN
+}
+
+static void Kernels_add_scalar(double *out, const double *a, const double *b, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = a[i] + b[i];
+}
+
+static void Kernels_sub_scalar(double *out, const double *a, const double *b, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = a[i] - b[i];
+}
+
+static void Kernels_mul_scalar(double *out, const double *a, const double *b, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = a[i] * b[i];
+}
+
+static void Kernels_div_scalar(double *out, const double *a, const double *b, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = b[i]==0.0 ? NAN : a[i] / b[i]; // Division by 0 -> NAN
+}
+
+// There is no SIMD instruction for mod and pow, so all the instruction sets use these
+static void Kernels_mod_scalar(double *out, const double *a, const double *b, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = b[i]==0.0 ? NAN : fmod(a[i], b[i]); // Division by 0 -> NAN
+}
+
+static void Kernels_pow_scalar(double *out, const double *a, const double *b, unsigned int count){
+
+  for(unsigned int i=0; i<count; i++)
+    out[i] = Kernels_pow(a[i], b[i]);
+}
+
+static const KernelTable kernels_scalar = {
+  "scalar",
+  Kernels_neg_scalar, Kernels_sqrt_scalar,
+  Kernels_add_scalar, Kernels_sub_scalar, Kernels_mul_scalar, Kernels_div_scalar,
+  Kernels_mod_scalar, Kernels_pow_scalar
+};
+
+#ifdef KERNELS_X86
+
+// ------------------------------------------------ SSE2 (2 lanes) ------------------------------------------------
+
+static void Kernels_neg_sse2(double *out, const double *a, unsigned int count){
+
+  __m128d sign = _mm_set1_pd(-0.0);
+  unsigned int i = 0;
+
+  for(; i+2<=count; i+=2)
+    _mm_storeu_pd(&out[i], _mm_xor_pd(_mm_loadu_pd(&a[i]), sign));
+
+  Kernels_neg_scalar(&out[i], &a[i], count-i);
+}
+
+static void Kernels_sqrt_sse2(double *out, const double *a, unsigned int count){
+
+  __m128d zero = _mm_setzero_pd(), nan = _mm_set1_pd(NAN);
+  unsigned int i = 0;
+
+  for(; i+2<=count; i+=2){
+
+    __m128d x = _mm_loadu_pd(&a[i]);
+    __m128d negative = _mm_cmplt_pd(x, zero);
+    _mm_storeu_pd(&out[i], _mm_or_pd(_mm_and_pd(negative, nan), _mm_andnot_pd(negative, _mm_sqrt_pd(x))));
+  }
+
+  Kernels_sqrt_scalar(&out[i], &a[i], count-i);
+}
+
+#define KERNELS_SSE2_BINARY(name, instruction)                                                   \
+static void Kernels_##name##_sse2(double *out, const double *a, const double *b, unsigned int count){ \
+                                                                                                 \
+  unsigned int i = 0;                                                                            \
+                                                                                                 \
+  for(; i+2<=count; i+=2)                                                                        \
+    _mm_storeu_pd(&out[i], instruction(_mm_loadu_pd(&a[i]), _mm_loadu_pd(&b[i])));               \
+                                                                                                 \
+  Kernels_##name##_scalar(&out[i], &a[i], &b[i], count-i);                                       \
+}
+
+KERNELS_SSE2_BINARY(add, _mm_add_pd)
+KERNELS_SSE2_BINARY(sub, _mm_sub_pd)
+KERNELS_SSE2_BINARY(mul, _mm_mul_pd)
+
+static void Kernels_div_sse2(double *out, const double *a, const double *b, unsigned int count){
+
+  __m128d zero = _mm_setzero_pd(), nan = _mm_set1_pd(NAN);
+  unsigned int i = 0;
+
+  for(; i+2<=count; i+=2){
+
+    __m128d y = _mm_loadu_pd(&b[i]);
+    __m128d is_zero = _mm_cmpeq_pd(y, zero);
+    __m128d quotient = _mm_div_pd(_mm_loadu_pd(&a[i]), y);
+    _mm_storeu_pd(&out[i], _mm_or_pd(_mm_and_pd(is_zero, nan), _mm_andnot_pd(is_zero, quotient)));
+  }
+
+  Kernels_div_scalar(&out[i], &a[i], &b[i], count-i);
+}
+
+static const KernelTable kernels_sse2 = {
+  "sse2",
+  Kernels_neg_sse2, Kernels_sqrt_sse2,
+  Kernels_add_sse2, Kernels_sub_sse2, Kernels_mul_sse2, Kernels_div_sse2,
+  Kernels_mod_scalar, Kernels_pow_scalar
+};
+
+// ------------------------------------------------ AVX2 (4 lanes) ------------------------------------------------
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static void Kernels_neg_avx2(double *out, const double *a, unsigned int count){
+
+  __m256d sign = _mm256_set1_pd(-0.0);
+  unsigned int i = 0;
+
+  for(; i+4<=count; i+=4)
+    _mm256_storeu_pd(&out[i], _mm256_xor_pd(_mm256_loadu_pd(&a[i]), sign));
+
+  Kernels_neg_scalar(&out[i], &a[i], count-i);
+}
+
+TARGET_AVX2 static void Kernels_sqrt_avx2(double *out, const double *a, unsigned int count){
+
+  __m256d zero = _mm256_setzero_pd(), nan = _mm256_set1_pd(NAN);
+  unsigned int i = 0;
+
+  for(; i+4<=count; i+=4){
+
+    __m256d x = _mm256_loadu_pd(&a[i]);
+    __m256d negative = _mm256_cmp_pd(x, zero, _CMP_LT_OQ);
+    _mm256_storeu_pd(&out[i], _mm256_blendv_pd(_mm256_sqrt_pd(x), nan, negative));
+  }
+
+  Kernels_sqrt_scalar(&out[i], &a[i], count-i);
+}
+
+#define KERNELS_AVX2_BINARY(name, instruction)                                                   \
+TARGET_AVX2 static void Kernels_##name##_avx2(double *out, const double *a, const double *b, unsigned int count){ \
+                                                                                                 \
+  unsigned int i = 0;                                                                            \
+                                                                                                 \
+  for(; i+4<=count; i+=4)                                                                        \
+    _mm256_storeu_pd(&out[i], instruction(_mm256_loadu_pd(&a[i]), _mm256_loadu_pd(&b[i])));      \
+                                                                                                 \
+  Kernels_##name##_scalar(&out[i], &a[i], &b[i], count-i);                                       \
+}
+
+KERNELS_AVX2_BINARY(add, _mm256_add_pd)
+KERNELS_AVX2_BINARY(sub, _mm256_sub_pd)
+KERNELS_AVX2_BINARY(mul, _mm256_mul_pd)
+
+TARGET_AVX2 static void Kernels_div_avx2(double *out, const double *a, const double *b, unsigned int count){
+
+  __m256d zero = _mm256_setzero_pd(), nan = _mm256_set1_pd(NAN);
+  unsigned int i = 0;
+
+  for(; i+4<=count; i+=4){
+
+    __m256d y = _mm256_loadu_pd(&b[i]);
+    __m256d is_zero = _mm256_cmp_pd(y, zero, _CMP_EQ_OQ);
+    _mm256_storeu_pd(&out[i], _mm256_blendv_pd(_mm256_div_pd(_mm256_loadu_pd(&a[i]), y), nan, is_zero));
+  }
+
+  Kernels_div_scalar(&out[i], &a[i], &b[i], count-i);
+}
+
+static const KernelTable kernels_avx2 = {
+  "avx2",
+  Kernels_neg_avx2, Kernels_sqrt_avx2,
+  Kernels_add_avx2, Kernels_sub_avx2, Kernels_mul_avx2, Kernels_div_avx2,
+  Kernels_mod_scalar, Kernels_pow_scalar
+};
+
+// ------------------------------------------------ AVX-512 (8 lanes) ------------------------------------------------
+
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+TARGET_AVX512 static void Kernels_neg_avx512(double *out, const double *a, unsigned int count){
+
+  __m512i sign = _mm512_set1_epi64((long long) 0x8000000000000000ULL);
+  unsigned int i = 0;
+
+  for(; i+8<=count; i+=8)
+    _mm512_storeu_pd(&out[i], _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(_mm512_loadu_pd(&a[i])), sign)));
+
+  Kernels_neg_scalar(&out[i], &a[i], count-i);
+}
+
+TARGET_AVX512 static void Kernels_sqrt_avx512(double *out, const double *a, unsigned int count){
+
+  __m512d zero = _mm512_setzero_pd(), nan = _mm512_set1_pd(NAN);
+  unsigned int i = 0;
+
+  for(; i+8<=count; i+=8){
+
+    __m512d x = _mm512_loadu_pd(&a[i]);
+    __mmask8 negative = _mm512_cmp_pd_mask(x, zero, _CMP_LT_OQ);
+    _mm512_storeu_pd(&out[i], _mm512_mask_blend_pd(negative, _mm512_sqrt_pd(x), nan));
+  }
+
+  Kernels_sqrt_scalar(&out[i], &a[i], count-i);
+}
+
+#define KERNELS_AVX512_BINARY(name, instruction)                                                 \
+TARGET_AVX512 static void Kernels_##name##_avx512(double *out, const double *a, const double *b, unsigned int count){ \
+                                                                                                 \
+  unsigned int i = 0;                                                                            \
+                                                                                                 \
+  for(; i+8<=count; i+=8)                                                                        \
+    _mm512_storeu_pd(&out[i], instruction(_mm512_loadu_pd(&a[i]), _mm512_loadu_pd(&b[i])));      \
+                                                                                                 \
+  Kernels_##name##_scalar(&out[i], &a[i], &b[i], count-i);                                       \
+}
+
+KERNELS_AVX512_BINARY(add, _mm512_add_pd)
+KERNELS_AVX512_BINARY(sub, _mm512_sub_pd)
+KERNELS_AVX512_BINARY(mul, _mm512_mul_pd)
+
+TARGET_AVX512 static void Kernels_div_avx512(double *out, const double *a, const double *b, unsigned int count){
+
+  __m512d zero = _mm512_setzero_pd(), nan = _mm512_set1_pd(NAN);
+  unsigned int i = 0;
+
+  for(; i+8<=count; i+=8){
+
+    __m512d y = _mm512_loadu_pd(&b[i]);
+    __mmask8 is_zero = _mm512_cmp_pd_mask(y, zero, _CMP_EQ_OQ);
+    _mm512_storeu_pd(&out[i], _mm512_mask_blend_pd(is_zero, _mm512_div_pd(_mm512_loadu_pd(&a[i]), y), nan));
+  }
+
+  Kernels_div_scalar(&out[i], &a[i], &b[i], count-i);
+}
+
+static const KernelTable kernels_avx512 = {
+  "avx512",
+  Kernels_neg_avx512, Kernels_sqrt_avx512,
+  Kernels_add_avx512, Kernels_sub_avx512, Kernels_mul_avx512, Kernels_div_avx512,
+  Kernels_mod_scalar, Kernels_pow_scalar
+};
+
+#endif
+
+#ifdef KERNELS_ARM
+
+// ------------------------------------------------ NEON (2 lanes) ------------------------------------------------
+
+static void Kernels_neg_neon(double *out, const double *a, unsigned int count){
+
+  unsigned int i = 0;
+
+  for(; i+2<=count; i+=2)
+    vst1q_f64(&out[i], vnegq_f64(vld1q_f64(&a[i])));
+
+  Kernels_neg_scalar(&out[i], &a[i], count-i);
+}
+
+static void Kernels_sqrt_neon(double *out, const double *a, unsigned int count){
+
+  float64x2_t zero = vdupq_n_f64(0.0), nan = vdupq_n_f64(NAN);
+  unsigned int i = 0;
+
+  for(; i+2<=count; i+=2){
+
+    float64x2_t x = vld1q_f64(&a[i]);
+    vst1q_f64(&out[i], vbslq_f64(vcltq_f64(x, zero), nan, vsqrtq_f64(x)));
+  }
+
+  Kernels_sqrt_scalar(&out[i], &a[i], count-i);
+}
+
+#define KERNELS_NEON_BINARY(name, instruction)                                                   \
+static void Kernels_##name##_neon(double *out, const double *a, const double *b, unsigned int count){ \
+                                                                                                 \
+  unsigned int i = 0;                                                                            \
+                                                                                                 \
+  for(; i+2<=count; i+=2)                                                                        \
+    vst1q_f64(&out[i], instruction(vld1q_f64(&a[i]), vld1q_f64(&b[i])));                         \
+                                                                                                 \
+  Kernels_##name##_scalar(&out[i], &a[i], &b[i], count-i);                                       \
+}
+
+KERNELS_NEON_BINARY(add, vaddq_f64)
+KERNELS_NEON_BINARY(sub, vsubq_f64)
+KERNELS_NEON_BINARY(mul, vmulq_f64)
+
+static void Kernels_div_neon(double *out, const double *a, const double *b, unsigned int count){
+
+  float64x2_t zero = vdupq_n_f64(0.0), nan = vdupq_n_f64(NAN);
+  unsigned int i = 0;
+
+  for(; i+2<=count; i+=2){
+
+    float64x2_t y = vld1q_f64(&b[i]);
+    vst1q_f64(&out[i], vbslq_f64(vceqq_f64(y, zero), nan, vdivq_f64(vld1q_f64(&a[i]), y)));
+  }
+
+  Kernels_div_scalar(&out[i], &a[i], &b[i], count-i);
+}
+
+static const KernelTable kernels_neon = {
+  "neon",
+  Kernels_neg_neon, Kernels_sqrt_neon,
+  Kernels_add_neon, Kernels_sub_neon, Kernels_mul_neon, Kernels_div_neon,
+  Kernels_mod_scalar, Kernels_pow_scalar
+};
+
+#endif
+
+// ------------------------------------------------ Selection ------------------------------------------------
+
+/* Function to return the kernels of a instruction set
+   It returns NULL if the instruction set is not supported by this CPU (or by this build)
+   It receives the instruction set */
+const KernelTable *Kernels_table(KernelIsa isa){
+
+  switch(isa){
+
+    case KERNELS_SCALAR:
+      return &kernels_scalar;
+
+#ifdef KERNELS_X86
+    case KERNELS_SSE2:
+      return &kernels_sse2; // Always available on x86-64
+    case KERNELS_AVX2:
+      return __builtin_cpu_supports("avx2") ? &kernels_avx2 : NULL;
+    case KERNELS_AVX512:
+      return __builtin_cpu_supports("avx512f") ? &kernels_avx512 : NULL;
+#endif
+
+#ifdef KERNELS_ARM
+    case KERNELS_NEON:
+      return &kernels_neon;
+#endif
+
+    default:
+      return NULL;
+  }
+}
+
+/* Function to return the kernels of the best instruction set supported by this CPU
+   It returns the kernels (the scalar ones if there is no SIMD support) */
+const KernelTable *Kernels_best(void){
+
+  const KernelIsa preference[] = {KERNELS_AVX512, KERNELS_AVX2, KERNELS_NEON, KERNELS_SSE2};
+
+  for(unsigned int i=0; i<sizeof(preference)/sizeof(preference[0]); i++){
+
+    const KernelTable *table = Kernels_table(preference[i]);
+    if(table)
+      return table;
+  }
+
+  return &kernels_scalar;
+}
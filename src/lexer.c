@@ -8,191 +8,309 @@
 #include <stdbool.h>
 
 #include "../include/lexer.h"
+#include "../include/number.h"
 
-/* Function to add a token, and does it by allocating memory and assigning a string to this area.
-   It returns a pointer to the string allocated, and receives a string to allocate */
-char *Lexer_add_token(const char *expression){
-
-  unsigned long expr_lenght = strlen(expression);
-  
-  char *token = malloc((expr_lenght+1) * sizeof(char));
-  
-  strcpy(token, expression);
-  
-  return token;
+/* Function to tell if the lexer should add a '*' between two tokens, like in 2(3), (2)sqrt(9) or 2x
+   It returns true if the '*' is needed, and receives the kind of the previous and of the current token */
+bool Lexer_needs_multiply(TokenKind previous, TokenKind current){
+
+  if(previous == TOK_NUMBER)
+    return current == TOK_OPEN_PAREN || current == TOK_SQRT || current == TOK_VARIABLE;
+
+  if(previous == TOK_CLOSE_PAREN || previous == TOK_VARIABLE)
+    return current == TOK_OPEN_PAREN || current == TOK_SQRT || current == TOK_VARIABLE || current == TOK_NUMBER;
+
+  return false;
+}
+
+/* Function to return the kind of a operator char
+   It returns TOK_INVALID if the char is not a supported operator, and receives the char */
+static TokenKind Lexer_operator_kind(char c){
+
+  switch(c){
+    case '+': return TOK_PLUS;
+    case '-': return TOK_MINUS;
+    case '*': return TOK_MULTIPLY;
+    case '/': return TOK_DIVIDE;
+    case '%': return TOK_MOD;
+    case '^': return TOK_POWER;
+    case '(': return TOK_OPEN_PAREN;
+    case ')': return TOK_CLOSE_PAREN;
+    default:  return TOK_INVALID;
+  }
+}
+
+/* Function to read the token that starts at a position of the expression
+   It returns the position after the chars of the token
+   It receives the expression, its lenght, the position and the token to fill (its kind is TOK_END if the char is ignored) */
+static unsigned long Lexer_read_token(const char *expression, unsigned long total_chars, unsigned long index, Token *token){
+
+  Token tok = {TOK_INVALID, index, 1, 0.0};
+  char c = expression[index];
+
+  // In case of the char is a digit or dot, read the whole real number (the value is computed here, once)
+  if(isdigit(c) || c == '.'){
+
+    index += Number_parse(&expression[index], total_chars-index, &tok.value);
+
+    // No number, or digits and dots after it (like in 1.5.2 or 5.) -> malformed number
+    if(index == tok.offset || (index < total_chars && (isdigit(expression[index]) || expression[index] == '.'))){
+
+      while(index < total_chars && (isdigit(expression[index]) || expression[index] == '.'))
+        index++;
+      tok.value = 0.0;
+    }
+    else
+      tok.kind = TOK_NUMBER;
+
+    tok.length = index - tok.offset;
+  }
+
+  // In case of the char is a letter, this is necessary to support functions like square root (sqrt) and variables
+  else if(isalpha(c)){
+
+    while(index < total_chars && isalpha(expression[index]))
+      index++;
+
+    tok.length = index - tok.offset;
+
+    if(tok.length == 4 && strncmp(&expression[tok.offset], "sqrt", 4) == 0)
+      tok.kind = TOK_SQRT;
+    else
+      tok.kind = TOK_VARIABLE;
+  }
+
+  // In case of the char is a operator
+  else if(Lexer_operator_kind(c) != TOK_INVALID){
+
+    tok.kind = Lexer_operator_kind(c);
+    index++;
+  }
+
+  // Any other char is ignored
+  else{
+    tok.kind = TOK_END;
+    index++;
+  }
+
+  *token = tok;
+  return index;
 }
-  
-  
+
 /* Function to tokenize a mathematical expression.
-   It receives a array of char (should be without spacing between chars)
-   and returns a array of string */
-char **Lexer_tokenize(char *expression){
-    
-  char **tokens; // Array of strings to store the tokens
-  char supported_operators[] = {'+', '-', '/', '*', '%', '(', ')', '^', '\0'}; // Array of supported operators
-      
-    
-  unsigned long total_chars = strlen(expression);
-  unsigned long max_tokens = (total_chars*2)+1; // Have some margin
-    
-  tokens = malloc(max_tokens * sizeof(*tokens));
-  if(!tokens) 
+   Tokens only store the position of their chars in the expression, so no string is allocated
+   It receives a array of char (should be without spacing between chars) and the arena to allocate from (NULL to use malloc)
+   and returns a array of tokens terminated by a TOK_END token (a single allocation, release it with free if there is no arena) */
+Token *Lexer_tokenize(const char *expression, Arena *arena){
+
+  return Lexer_tokenize_span(expression, strlen(expression), arena);
+}
+
+/* Function to tokenize the first chars of a array, like Lexer_tokenize but the expression does not need a NULL terminator
+   (for example a line of a file mapped in memory, that can not be changed)
+   It receives the first char of the expression, its lenght and the arena to allocate from (NULL to use malloc)
+   and returns a array of tokens terminated by a TOK_END token (a single allocation, release it with free if there is no arena) */
+Token *Lexer_tokenize_span(const char *expression, size_t length, Arena *arena){
+
+  unsigned long total_chars = length;
+  unsigned long max_tokens = (total_chars*2)+1; // Have some margin for the '*' added by the lexer
+
+  Token *tokens = arena ? Arena_alloc(arena, max_tokens * sizeof(Token)) : malloc(max_tokens * sizeof(Token));
+  if(!tokens)
     return NULL;
-      
-    
+
   unsigned long index = 0;
   unsigned long token_index = 0;
-  unsigned long tmp_for_realnum_index = 0;
-  unsigned long tmp_for_letter_index = 0; 
-
-  char tmp_for_realnum[(total_chars*2)+1]; // Temporary array to store digits, in order to tokenize a real number
-  tmp_for_realnum[0] = '\0'; // Initialize the array with 0
-  
-  char tmp_for_letter[total_chars+1]; // Temporary array to store letters, in order to tokenize a function like sqrt 
-  tmp_for_letter[0] = '\0'; // Initialize the array with 0
 
   while(index < total_chars){
 
-    // In case of the char is a digit or dot
-    if(isdigit(expression[index]) || expression[index] == '.'){
-  
-      // In case of the first char of the number is a dot -> add a 0 before
-      if(expression[index] == '.' && tmp_for_realnum_index == 0){
-        tmp_for_realnum[tmp_for_realnum_index++] = '0'; // Store digit 0 and increase index by 1
-      }
+    Token tok;
+    index = Lexer_read_token(expression, total_chars, index, &tok);
+    if(tok.kind == TOK_END)
+      continue;
 
-      tmp_for_realnum[tmp_for_realnum_index++] = expression[index]; // Store current digit and increase index by 1
-      tmp_for_realnum[tmp_for_realnum_index] = '\0'; // Add NULL terminator
-  
-      // If the next char is not a digit or a dot or if the next position is the NULL terminator
-      if(index+1 >= total_chars || (!isdigit(expression[index+1]) && expression[index+1] != '.')){
-
-        // Add the token, see if the pointer is not NULL (if so, free all memory already allocated), and increase the token index by 1
-        tokens[token_index] = Lexer_add_token(tmp_for_realnum); 
-        if(!tokens[token_index]){
-
-          for(unsigned long i = 0; i < token_index; i++){
-            free(tokens[i]);
-          }
-          free(tokens);
-          return NULL;
-        }
-        token_index++;
-          
-        // Reset tmp_for_realnum
-        tmp_for_realnum[0] = '\0';
-        tmp_for_realnum_index = 0;
-      }
+    // Add the '*' that is implicit in expressions like 2(3)
+    if(token_index > 0 && Lexer_needs_multiply(tokens[token_index-1].kind, tok.kind)){
+
+      Token multiply = {TOK_MULTIPLY, tok.offset, 0, 0.0};
+      tokens[token_index++] = multiply;
     }
-  
-    // In case of the char is a operator
-    else if(strchr(supported_operators, expression[index])){
-      
-      char str_tmp[2] = {expression[index], '\0'};
-
-      // In case the char is a ( and the previous char is a number or ')'
-      if(index>0 && expression[index] == '(' && (isdigit(expression[index-1]) || expression[index-1]==')')){
-
-        char str_tmp2[2] = {'*', '\0'}; 
-
-        tokens[token_index] = Lexer_add_token(str_tmp2);
-        if(!tokens[token_index]){
-
-          for(unsigned long i = 0; i < token_index; i++){
-            free(tokens[i]);
-          }
-          free(tokens);
-          return NULL;
-        }
-        token_index++;
-      }
 
-      int flag_add_asterisk=0;
-
-      // In case the char is a ) and the next char is a number
-      if(index+1<total_chars && expression[index] == ')' && isdigit(expression[index+1]))
-        flag_add_asterisk=1;
-    
-      // Add the token, see if the pointer is not NULL (if so, free all memory already allocated), and increase the token index by 1
-      tokens[token_index] = Lexer_add_token(str_tmp); 
-      if(!tokens[token_index]){
-
-        for(unsigned long i = 0; i < token_index; i++){
-          free(tokens[i]);
-        }
-        free(tokens);
-        return NULL;
-      }
-      token_index++;
+    tokens[token_index++] = tok;
+  }
 
-      // In case the char is a ) and the next char is a number
-      if(flag_add_asterisk==1){
+  Token end = {TOK_END, total_chars, 0, 0.0};
+  tokens[token_index] = end; // Indicates the end of the used memory positions
 
-        char str_tmp2[2] = {'*', '\0'}; 
+  return tokens;
+}
 
-        tokens[token_index] = Lexer_add_token(str_tmp2);
-        if(!tokens[token_index]){
+// ------------------------------------------------ Streaming ------------------------------------------------
 
-          for(unsigned long i = 0; i < token_index; i++){
-            free(tokens[i]);
-          }
-          free(tokens);
-          return NULL;
-        }
-        token_index++;
-      }
-    }
-  
-    // In case of the char is a letter, this is necessary to support functions like square root (sqrt)
-    else if(isalpha(expression[index])){
+/* Function to start a lexer of a expression that arrives in chunks
+   It receives the lexer to initialize, the function that receives the tokens and its context */
+void Lexer_stream_init(LexerStream *stream, LexerTokenSink sink, void *context){
 
-      // In case the char is a ( and the previous char is a number or ')'
-      if(index>0 && (isdigit(expression[index-1]) || expression[index-1]==')')){
+  stream->sink = sink;
+  stream->context = context;
+  stream->run = NULL;
+  stream->run_length = 0;
+  stream->run_cap = 0;
+  stream->run_offset = 0;
+  stream->position = 0;
+  stream->previous = TOK_END;
+}
 
-        char str_tmp2[2] = {'*', '\0'}; 
+/* Function to tell if a char continues the run of chars of the current number or name
+   Runs have every char a number can have (digits, letters of hex numbers and exponents, dots, '_' and the sign after a exponent letter),
+   so the tokens of a run are the same as in the whole expression even when the next chunk is not known
+   It returns true if the char is part of the run, and receives the lexer and the char */
+static bool Lexer_stream_continues(const LexerStream *stream, char c){
 
-        tokens[token_index] = Lexer_add_token(str_tmp2);
-        if(!tokens[token_index]){
+  if(isalnum(c) || c == '.' || c == '_')
+    return true;
 
-          for(unsigned long i = 0; i < token_index; i++){
-            free(tokens[i]);
-          }
-          free(tokens);
-          return NULL;
-        }
-        token_index++;
-      }
-      
-      while(index < total_chars && isalpha(expression[index])){
+  char last = stream->run[stream->run_length-1];
+  return (c == '+' || c == '-') && (last == 'e' || last == 'E' || last == 'p' || last == 'P');
+}
 
-        tmp_for_letter[tmp_for_letter_index++] = expression[index]; // Store current letter and increase index by 1
-        tmp_for_letter[tmp_for_letter_index] = '\0'; // Add NULL terminator
+/* Function to give a token to the sink, after the '*' that is implicit before it (like in 2(3))
+   It returns the result of the sink, and receives the lexer and the token */
+static bool Lexer_stream_emit(LexerStream *stream, Token tok){
 
-        index++;
-      }
+  if(Lexer_needs_multiply(stream->previous, tok.kind)){
+
+    Token multiply = {TOK_MULTIPLY, tok.offset, 0, 0.0};
+    if(!stream->sink(stream->context, &multiply))
+      return false;
+  }
+
+  stream->previous = tok.kind;
+  return stream->sink(stream->context, &tok);
+}
+
+/* Function to tokenize the complete run of chars of a number or name, with the same rules as Lexer_tokenize_span
+   It returns false if the sink stopped the lexer, and receives the lexer */
+static bool Lexer_stream_flush(LexerStream *stream){
+
+  unsigned long index = 0;
+  unsigned long total_chars = stream->run_length;
+  stream->run_length = 0;
+
+  while(index < total_chars){
+
+    Token tok;
+    index = Lexer_read_token(stream->run, total_chars, index, &tok);
+    if(tok.kind == TOK_END)
+      continue;
+
+    tok.offset += stream->run_offset;
+    if(!Lexer_stream_emit(stream, tok))
+      return false;
+  }
+
+  return true;
+}
+
+/* Function to add chars to the run of the current number or name
+   It returns false if memory allocation failed, and receives the lexer, the first char and the number of chars */
+static bool Lexer_stream_append(LexerStream *stream, const char *chars, size_t count){
+
+  if(stream->run_length + count > stream->run_cap){
+
+    size_t cap = stream->run_cap ? stream->run_cap : LEXER_STREAM_RUN_SIZE;
+    while(cap < stream->run_length + count)
+      cap *= 2;
+
+    char *grown = realloc(stream->run, cap);
+    if(!grown)
+      return false;
+    stream->run = grown;
+    stream->run_cap = cap;
+  }
+
+  memcpy(&stream->run[stream->run_length], chars, count);
+  stream->run_length += count;
+  return true;
+}
+
+/* Function to tokenize the next chunk of the expression, the chunk can end in the middle of a number or name
+   (its chars are kept until the chunk where it ends), every other token is given to the sink before it returns
+   The tokens are the same as the ones of Lexer_tokenize_span for the whole expression, with offsets from its first char
+   It returns false if the sink stopped the lexer or memory allocation failed
+   It receives the lexer, the chars of the chunk (without NULL terminator) and their number */
+bool Lexer_stream_feed(LexerStream *stream, const char *chunk, size_t length){
+
+  size_t index = 0;
+
+  while(index < length){
 
-      // Add the token, see if the pointer is not NULL (if so, free all memory already allocated), and increase the token index by 1
-      tokens[token_index] = Lexer_add_token(tmp_for_letter); 
-      if(!tokens[token_index]){
+    char c = chunk[index];
 
-        for(unsigned long i = 0; i < token_index; i++){
-          free(tokens[i]);
-        }
-        free(tokens);
-        return NULL;
+    // The run of the current number or name ends at the first char that can not be part of it
+    if(stream->run_length > 0){
+
+      size_t end = index;
+      while(end < length && Lexer_stream_continues(stream, chunk[end])){
+
+        // The sign of a exponent depends on the char before it, so the run is extended before checking the next char
+        if(!Lexer_stream_append(stream, &chunk[end], 1))
+          return false;
+        end++;
       }
-      token_index++;
 
-      // Reset tmp_for_letter 
-      tmp_for_letter[0] = '\0';
-      tmp_for_letter_index = 0;
+      index = end;
+      if(index < length && !Lexer_stream_flush(stream))
+        return false;
+      continue;
+    }
+
+    if(isalnum(c) || c == '.'){
 
-      continue; // Go to the next iteration of while in order to skip the index incrementation below
+      stream->run_offset = stream->position + index;
+      if(!Lexer_stream_append(stream, &c, 1))
+        return false;
+      index++;
+      continue;
     }
 
-    index++; // Increments index
+    Token tok;
+    Lexer_read_token(chunk, length, index, &tok);
+    if(tok.kind != TOK_END){
+
+      tok.offset += stream->position;
+      if(!Lexer_stream_emit(stream, tok))
+        return false;
+    }
+    index++;
   }
-  
-  tokens[token_index] = NULL; // Indicates the end of the used memory positions
-  return tokens;
-}
\ No newline at end of file
+
+  stream->position += length;
+  return true;
+}
+
+/* Function to end the expression: the last number or name and a TOK_END token are given to the sink
+   The lexer can then receive the chunks of another expression (the offsets of its tokens start again at 0)
+   It returns false if the sink stopped the lexer, and receives the lexer */
+bool Lexer_stream_finish(LexerStream *stream){
+
+  bool flushed = stream->run_length == 0 || Lexer_stream_flush(stream);
+
+  Token end = {TOK_END, stream->position, 0, 0.0};
+  bool ended = flushed && stream->sink(stream->context, &end);
+
+  stream->run_length = 0;
+  stream->position = 0;
+  stream->previous = TOK_END;
+  return ended;
+}
+
+/* Function to free the memory of the lexer (the sink is not called)
+   It receives the lexer */
+void Lexer_stream_free(LexerStream *stream){
+
+  free(stream->run);
+  stream->run = NULL;
+  stream->run_length = 0;
+  stream->run_cap = 0;
+}
@@ -5,17 +5,966 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include "../include/math_interpreter.h"
 
-/* Function to free tokens memory 
-   It receives tokens as a array of string */
-void free_tokens(char **tokens){
+#define MATH_SCRATCH_SIZE 4096 // Size of the buffer in the stack used as first block of the arenas
+#define MATH_CHUNK_ROWS 16384  // Number of rows of each task of the parallel batch evaluation
+#define MATH_CACHE_DEFAULT_BYTES (1 << 20) // Default memory limit of the expression cache
+#define MATH_CACHE_NO_ENTRY (-1)            // End of a chain of the hash table of the cache
 
-  for(char **tok=tokens; *tok; tok++){
-    free(*tok);
+
+/* Function that does the lexing, the parsing (syntax analysis + Shunting-Yard), the bytecode lowering and the optimization parts
+   The tokens and the RPN are taken from the scratch arena, the bytecode from bytecode_arena (NULL to use malloc)
+   It returns true if the expression was converted into bytecode, false if the syntax is not correct
+   It receives the expression and its lenght, the scratch arena, a reference to the bytecode to fill, the arena of the bytecode
+   and a reference to the error that is filled when false is returned (can be NULL) */
+static bool Math_build_bytecode(const char *expression, size_t length, Arena *scratch, Bytecode *bytecode, Arena *bytecode_arena, ParseError *error){
+
+  ParseError local_error;
+  if(!error)
+    error = &local_error;
+
+  error->kind = PARSE_OUT_OF_MEMORY;
+  error->position = 0;
+
+  Token *tokens = Lexer_tokenize_span(expression, length, scratch);
+  if(!tokens)
+    return false;
+
+  Token *rpn = Parser_Shunting_yard(tokens, scratch, error);
+  if(!rpn)
+    return false;
+
+  error->kind = PARSE_OUT_OF_MEMORY;
+
+  if(!Bytecode_from_rpn(rpn, expression, bytecode, bytecode_arena))
+    return false;
+
+  if(!Bytecode_optimize(bytecode)){
+    Bytecode_free(bytecode);
+    return false;
+  }
+
+  error->kind = PARSE_OK;
+  return true;
+}
+
+/* Function that compiles a math expression like Math_compile, the tokens and the RPN are taken from a scratch arena
+   It returns a new CompiledExpr or NULL if the syntax is not correct
+   It receives the expression and its lenght, the scratch arena and a reference to the error (can be NULL) */
+static CompiledExpr *Math_compile_arena(const char *expression, size_t length, Arena *scratch, ParseError *error){
+
+  CompiledExpr *compiled = malloc(sizeof(CompiledExpr));
+  if(!compiled && error){
+    error->kind = PARSE_OUT_OF_MEMORY;
+    error->position = 0;
+  }
+
+  if(compiled && !Math_build_bytecode(expression, length, scratch, &compiled->bytecode, NULL, error)){
+    free(compiled);
+    compiled = NULL;
+  }
+
+  if(compiled){
+    compiled->jit.function = NULL;
+    compiled->jit.memory = NULL;
+    compiled->jit.size = 0;
+    atomic_init(&compiled->references, 1);
+  }
+
+  return compiled;
+}
+
+/* Function that compiles a math expression, it does the lexing, the parsing and the bytecode lowering parts only once
+   It returns a new CompiledExpr (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the expression as a array of chars and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_compile(const char *expression, ParseError *error){
+
+  char buffer[MATH_SCRATCH_SIZE];
+  Arena scratch;
+  Arena_init(&scratch, buffer, sizeof(buffer));
+
+  CompiledExpr *compiled = Math_compile_arena(expression, strlen(expression), &scratch, error);
+
+  Arena_free(&scratch);
+  return compiled;
+}
+
+/* Function that compiles a math expression like Math_compile, and then compiles its bytecode into native machine code (see jit.h)
+   The evaluations of the compiled expression run the native code, without interpreter dispatch. Where there is no JIT
+   (other architectures, builds with MATH_NO_JIT or very deep expressions) the bytecode interpreter is used, with the same results
+   It returns a new CompiledExpr (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the expression as a array of chars and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_compile_native(const char *expression, ParseError *error){
+
+  CompiledExpr *compiled = Math_compile(expression, error);
+  if(compiled)
+    Jit_compile(&compiled->bytecode, &compiled->jit); // If it fails the interpreter is used
+
+  return compiled;
+}
+
+/* Function to tell if a compiled expression runs native code (see Math_compile_native)
+   It receives a reference to the compiled expression */
+bool Math_is_native(const CompiledExpr *compiled){
+
+  return compiled->jit.function != NULL;
+}
+
+/* Function that evaluates a compiled expression, it only runs the bytecode interpreter (or the native code)
+   It returns the result as a double (NAN if the expression has variables, use Math_eval_batch for them)
+   It receives a reference to the compiled expression */
+double Math_eval(const CompiledExpr *compiled){
+
+  if(compiled->bytecode.variable_count > 0)
+    return NAN;
+
+  if(compiled->jit.function){
+    double result;
+    compiled->jit.function(NULL, 1, &result);
+    return result;
+  }
+
+  char buffer[MATH_SCRATCH_SIZE];
+  Arena scratch;
+  Arena_init(&scratch, buffer, sizeof(buffer));
+
+  double result = Bytecode_evaluate(&compiled->bytecode, NULL, &scratch);
+
+  Arena_free(&scratch);
+  return result;
+}
+
+/* Function to find the column of each variable of a compiled expression
+   It returns a new malloc with one column per variable (by index), or NULL if a variable has no binding or memory allocation failed
+   It receives a reference to the compiled expression and a array of bindings terminated by a binding with NULL name */
+static const double **Math_bind_columns(const CompiledExpr *compiled, const MathBinding *bindings){
+
+  const Bytecode *bytecode = &compiled->bytecode;
+
+  const double **columns = malloc((bytecode->variable_count ? bytecode->variable_count : 1) * sizeof(double*));
+  if(!columns)
+    return NULL;
+
+  for(unsigned int i=0; i<bytecode->variable_count; i++){
+
+    columns[i] = NULL;
+    for(const MathBinding *binding=bindings; binding && binding->name; binding++){
+
+      if(strcmp(binding->name, bytecode->variables[i]) == 0){
+        columns[i] = binding->values;
+        break;
+      }
+    }
+
+    // Variable without binding
+    if(!columns[i]){
+      free(columns);
+      return NULL;
+    }
+  }
+
+  return columns;
+}
+
+/* Function that evaluates a compiled expression for many rows, the variables of the expression take their values from columns
+   For example, a*x^2+b*x+c with the bindings {{"a", a}, {"b", b}, {"c", c}, {"x", x}, {NULL, NULL}} writes out[i] = a[i]*x[i]^2+b[i]*x[i]+c[i]
+   It returns true if the evaluation succeeded (false if a variable of the expression has no binding or memory allocation failed)
+   It receives a reference to the compiled expression, a array of bindings terminated by a binding with NULL name,
+   the number of rows and the array where the results are written (one per row) */
+bool Math_eval_batch(const CompiledExpr *compiled, const MathBinding *bindings, size_t n, double *out){
+
+  const double **columns = Math_bind_columns(compiled, bindings);
+  if(!columns)
+    return false;
+
+  bool is_evaluated = true;
+  if(compiled->jit.function)
+    compiled->jit.function(columns, n, out);
+  else
+    is_evaluated = Bytecode_evaluate_batch(&compiled->bytecode, columns, n, out, NULL);
+
+  free(columns);
+  return is_evaluated;
+}
+
+// Context shared by the tasks of a parallel batch evaluation
+typedef struct{
+
+  const Bytecode *bytecode;
+  JitFunction function; // Native code of the expression (NULL to use the interpreter)
+  const double **columns;
+  size_t rows;
+  double *out;
+  Arena *arenas;       // One arena per worker, so each worker has its own stack of blocks
+  atomic_bool failed;  // Set if the evaluation of a chunk failed
+} MathBatchContext;
+
+/* Function that evaluates one chunk of rows, executed by the workers of the thread pool
+   It receives the context of the batch, the index of the worker and the index of the chunk */
+static void Math_eval_chunk(void *context, unsigned int worker, size_t chunk){
+
+  MathBatchContext *batch = context;
+  Arena *arena = &batch->arenas[worker];
+  const Bytecode *bytecode = batch->bytecode;
+
+  size_t first_row = chunk * MATH_CHUNK_ROWS;
+  size_t rows = (batch->rows - first_row) < MATH_CHUNK_ROWS ? (batch->rows - first_row) : MATH_CHUNK_ROWS;
+
+  // The columns of the chunk start at its first row
+  const double **columns = Arena_alloc(arena, (bytecode->variable_count ? bytecode->variable_count : 1) * sizeof(double*));
+
+  if(columns){
+
+    for(unsigned int i=0; i<bytecode->variable_count; i++)
+      columns[i] = &batch->columns[i][first_row];
+  }
+
+  if(columns && batch->function)
+    batch->function(columns, rows, &batch->out[first_row]);
+  else if(!columns || !Bytecode_evaluate_batch(bytecode, columns, rows, &batch->out[first_row], arena))
+    atomic_store(&batch->failed, true);
+
+  Arena_reset(arena);
+}
+
+/* Function that evaluates a compiled expression for many rows like Math_eval_batch, but the rows are split in chunks evaluated by the workers of a thread pool
+   Each chunk writes its own rows of out, so the output is the same as the one of Math_eval_batch whatever the number of threads
+   It returns true if the evaluation succeeded (false if a variable of the expression has no binding or memory allocation failed)
+   It receives a reference to the compiled expression, a array of bindings terminated by a binding with NULL name,
+   the number of rows, the array where the results are written (one per row) and the thread pool (see threadpool.h) */
+bool Math_eval_batch_parallel(const CompiledExpr *compiled, const MathBinding *bindings, size_t n, double *out, ThreadPool *pool){
+
+  // Not enough rows to split
+  if(n <= MATH_CHUNK_ROWS || ThreadPool_size(pool) == 1)
+    return Math_eval_batch(compiled, bindings, n, out);
+
+  const double **columns = Math_bind_columns(compiled, bindings);
+  if(!columns)
+    return false;
+
+  unsigned int workers = ThreadPool_size(pool);
+  Arena *arenas = malloc(workers * sizeof(Arena));
+  if(!arenas){
+    free(columns);
+    return false;
+  }
+
+  for(unsigned int i=0; i<workers; i++)
+    Arena_init(&arenas[i], NULL, 0);
+
+  MathBatchContext batch = {&compiled->bytecode, compiled->jit.function, columns, n, out, arenas, false};
+
+  size_t chunks = (n + MATH_CHUNK_ROWS-1) / MATH_CHUNK_ROWS;
+  ThreadPool_run(pool, chunks, Math_eval_chunk, &batch);
+
+  for(unsigned int i=0; i<workers; i++)
+    Arena_free(&arenas[i]);
+
+  free(arenas);
+  free(columns);
+
+  return !atomic_load(&batch.failed);
+}
+
+/* Function to return the number of different variables of a compiled expression
+   It receives a reference to the compiled expression */
+unsigned int Math_variable_count(const CompiledExpr *compiled){
+
+  return compiled->bytecode.variable_count;
+}
+
+/* Function to return the name of a variable of a compiled expression
+   It returns the name, or NULL if the index is not valid
+   It receives a reference to the compiled expression and the index of the variable (from 0 to Math_variable_count-1) */
+const char *Math_variable_name(const CompiledExpr *compiled, unsigned int index){
+
+  if(index >= compiled->bytecode.variable_count)
+    return NULL;
+
+  return compiled->bytecode.variables[index];
+}
+
+/* Function to free a compiled expression (the memory is only released when the expression cache does not use it anymore)
+   It receives a reference to the compiled expression (can be NULL) */
+void Math_free_compiled(CompiledExpr *compiled){
+
+  if(!compiled || atomic_fetch_sub(&compiled->references, 1) != 1)
+    return;
+
+  Jit_free(&compiled->jit);
+  Bytecode_free(&compiled->bytecode);
+  free(compiled);
+}
+
+// ------------------------------------------------ Expression cache ------------------------------------------------
+
+/* Entry of the expression cache, a compiled expression or a syntax error */
+typedef struct{
+
+  char *key;              // Normalized expression (NULL if the slot is free)
+  size_t length;          // Lenght of the key
+  uint64_t hash;          // Hash of the key
+  CompiledExpr *compiled; // Compiled expression (NULL if the syntax is not correct)
+  double value;           // Result of the expression, if it has no variables
+  size_t bytes;           // Memory used by the entry
+  bool referenced;        // Used since the clock hand passed (CLOCK replacement)
+  int next;               // Next entry of the same bucket of the hash table, or next free slot
+} MathCacheEntry;
+
+/* Bounded cache of compiled expressions, it replaces entries with the CLOCK algorithm (an approximation of LRU) */
+typedef struct{
+
+  pthread_mutex_t lock;
+  MathCacheEntry *entries; // Slots of the entries
+  int capacity;            // Number of slots
+  int *buckets;            // Hash table, first entry of each bucket (capacity*2 buckets, a power of 2)
+  int free_slot;           // First free slot (they are linked by next)
+  int hand;                // Position of the clock hand
+  MathCacheStats stats;
+} MathCache;
+
+static MathCache Math_cache = {PTHREAD_MUTEX_INITIALIZER, NULL, 0, NULL, MATH_CACHE_NO_ENTRY, 0, {0, 0, 0, 0, 0, MATH_CACHE_DEFAULT_BYTES}};
+
+/* Function to tell if the lexer uses a char (digits, letters, dots and operators), any other char only separates tokens
+   It receives the char */
+static bool Math_is_significant(char c){
+
+  return isalnum((unsigned char) c) || c == '.' || c == '_' || (c != '\0' && strchr("+-*/%^()", c) != NULL);
+}
+
+/* Function to tell if a char is part of a number or name (digits, letters, dots and the '_' separator of digits)
+   It receives the char */
+static bool Math_is_word(char c){
+
+  return isalnum((unsigned char) c) || c == '.' || c == '_';
+}
+
+/* Function to tell if a char is the letter of a exponent, the sign after it is part of the number (like in 1e+3)
+   It receives the char */
+static bool Math_is_exponent(char c){
+
+  return c == 'e' || c == 'E' || c == 'p' || c == 'P';
+}
+
+/* Function to normalize a expression, so expressions that only differ in spaces have the same key in the cache
+   Ignored chars are removed, except a single space where the chars around them would be one number or name
+   (2 3 is not 23, 1 _000 is not 1_000 and 1e +3 is not 1e+3)
+   The key must have the same tokens as the expression (two expressions with the same key share the compiled expression),
+   so a ignored char is only removed when the chars around it can not be read as one token without it
+   It returns the lenght of the normalized expression
+   It receives the expression, its lenght and the array where the normalized expression is written (at least as long as the expression) */
+static size_t Math_normalize(const char *expression, size_t expression_length, char *normalized){
+
+  size_t length = 0;
+  bool separated = false;
+
+  for(const char *c=expression; c<expression+expression_length; c++){
+
+    if(!Math_is_significant(*c)){
+      separated = true;
+      continue;
+    }
+
+    // The last kept char is part of a number or name, also the sign of a exponent (like the + of 1e+)
+    if(separated && length > 0){
+
+      char last = normalized[length-1];
+      bool after_word = Math_is_word(last) || ((last == '+' || last == '-') && length > 1 && Math_is_exponent(normalized[length-2]));
+      bool is_sign = *c == '+' || *c == '-';
+
+      if((Math_is_word(*c) && after_word) || (is_sign && Math_is_exponent(last)))
+        normalized[length++] = ' ';
+    }
+
+    normalized[length++] = *c;
+    separated = false;
   }
-  free(tokens);
+
+  normalized[length] = '\0';
+  return length;
+}
+
+/* Function to hash a key of the cache (FNV-1a)
+   It receives the key and its lenght */
+static uint64_t Math_hash(const char *key, size_t length){
+
+  uint64_t hash = 14695981039346656037ULL;
+
+  for(size_t i=0; i<length; i++){
+    hash ^= (unsigned char) key[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/* Function to return the bucket of a hash
+   It receives the cache and the hash */
+static int *Math_cache_bucket(MathCache *cache, uint64_t hash){
+
+  return &cache->buckets[hash & (size_t)(cache->capacity*2 - 1)];
+}
+
+/* Function to find a key in the cache, the cache must be locked
+   It returns the index of the entry or MATH_CACHE_NO_ENTRY
+   It receives the cache, the key, its lenght and its hash */
+static int Math_cache_find(MathCache *cache, const char *key, size_t length, uint64_t hash){
+
+  if(cache->capacity == 0)
+    return MATH_CACHE_NO_ENTRY;
+
+  for(int i=*Math_cache_bucket(cache, hash); i!=MATH_CACHE_NO_ENTRY; i=cache->entries[i].next){
+
+    MathCacheEntry *entry = &cache->entries[i];
+    if(entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0)
+      return i;
+  }
+
+  return MATH_CACHE_NO_ENTRY;
+}
+
+/* Function to remove a entry of the cache, the cache must be locked
+   It receives the cache and the index of the entry */
+static void Math_cache_remove(MathCache *cache, int index){
+
+  MathCacheEntry *entry = &cache->entries[index];
+
+  int *link = Math_cache_bucket(cache, entry->hash);
+  while(*link != index)
+    link = &cache->entries[*link].next;
+  *link = entry->next;
+
+  Math_free_compiled(entry->compiled);
+  free(entry->key);
+
+  cache->stats.bytes -= entry->bytes;
+  cache->stats.entries--;
+
+  entry->key = NULL;
+  entry->next = cache->free_slot;
+  cache->free_slot = index;
+}
+
+/* Function to evict entries with the CLOCK algorithm until there is space for more bytes, the cache must be locked
+   Entries used since the last pass of the hand get a second chance
+   It receives the cache and the number of bytes needed */
+static void Math_cache_evict(MathCache *cache, size_t bytes){
+
+  while(cache->stats.entries > 0 && cache->stats.bytes + bytes > cache->stats.max_bytes){
+
+    MathCacheEntry *entry = &cache->entries[cache->hand];
+
+    if(entry->key && entry->referenced)
+      entry->referenced = false;
+    else if(entry->key){
+      Math_cache_remove(cache, cache->hand);
+      cache->stats.evictions++;
+    }
+
+    cache->hand = (cache->hand + 1) % cache->capacity;
+  }
+}
+
+/* Function to double the number of slots of the cache, the cache must be locked
+   It returns false if memory allocation failed
+   It receives the cache */
+static bool Math_cache_grow(MathCache *cache){
+
+  int capacity = cache->capacity ? cache->capacity*2 : 16;
+
+  MathCacheEntry *entries = realloc(cache->entries, capacity * sizeof(MathCacheEntry));
+  if(!entries)
+    return false;
+  cache->entries = entries;
+
+  int *buckets = realloc(cache->buckets, capacity * 2 * sizeof(int));
+  if(!buckets)
+    return false;
+  cache->buckets = buckets;
+
+  // New slots go to the free list
+  for(int i=capacity-1; i>=cache->capacity; i--){
+    entries[i].key = NULL;
+    entries[i].next = cache->free_slot;
+    cache->free_slot = i;
+  }
+  cache->capacity = capacity;
+
+  // Rebuild the hash table
+  for(int i=0; i<capacity*2; i++)
+    buckets[i] = MATH_CACHE_NO_ENTRY;
+
+  for(int i=0; i<capacity; i++){
+
+    if(!entries[i].key)
+      continue;
+
+    int *bucket = Math_cache_bucket(cache, entries[i].hash);
+    entries[i].next = *bucket;
+    *bucket = i;
+  }
+
+  return true;
+}
+
+/* Function to return the memory used by a compiled expression
+   It receives the compiled expression (can be NULL) */
+static size_t Math_compiled_size(const CompiledExpr *compiled){
+
+  if(!compiled)
+    return 0;
+
+  const Bytecode *bytecode = &compiled->bytecode;
+  size_t size = sizeof(CompiledExpr) + bytecode->size * sizeof(Instruction) + bytecode->constant_count * sizeof(double);
+
+  for(unsigned int i=0; i<bytecode->variable_count; i++)
+    size += sizeof(char*) + strlen(bytecode->variables[i]) + 1;
+
+  return size;
+}
+
+/* Function to add a entry to the cache, the cache must be locked
+   The cache takes a reference of the compiled expression, nothing is added if the entry does not fit in the memory limit
+   It receives the cache, the key, its lenght and hash, the compiled expression (NULL for a syntax error) and its value */
+static void Math_cache_insert(MathCache *cache, const char *key, size_t length, uint64_t hash, CompiledExpr *compiled, double value){
+
+  size_t bytes = sizeof(MathCacheEntry) + length + 1 + Math_compiled_size(compiled);
+  if(bytes > cache->stats.max_bytes || Math_cache_find(cache, key, length, hash) != MATH_CACHE_NO_ENTRY)
+    return;
+
+  Math_cache_evict(cache, bytes);
+
+  if(cache->free_slot == MATH_CACHE_NO_ENTRY && !Math_cache_grow(cache))
+    return;
+
+  char *copy = malloc(length + 1);
+  if(!copy)
+    return;
+  memcpy(copy, key, length + 1);
+
+  int index = cache->free_slot;
+  MathCacheEntry *entry = &cache->entries[index];
+  cache->free_slot = entry->next;
+
+  entry->key = copy;
+  entry->length = length;
+  entry->hash = hash;
+  entry->compiled = compiled;
+  entry->value = value;
+  entry->bytes = bytes;
+  entry->referenced = false;
+
+  int *bucket = Math_cache_bucket(cache, hash);
+  entry->next = *bucket;
+  *bucket = index;
+
+  if(compiled)
+    atomic_fetch_add(&compiled->references, 1);
+
+  cache->stats.bytes += bytes;
+  cache->stats.entries++;
+}
+
+/* Function to initialize a empty cache
+   It receives the cache and its memory limit in bytes (0 disables the cache) */
+static void Math_cache_init(MathCache *cache, size_t max_bytes){
+
+  pthread_mutex_init(&cache->lock, NULL);
+  cache->entries = NULL;
+  cache->capacity = 0;
+  cache->buckets = NULL;
+  cache->free_slot = MATH_CACHE_NO_ENTRY;
+  cache->hand = 0;
+  memset(&cache->stats, 0, sizeof(MathCacheStats));
+  cache->stats.max_bytes = max_bytes;
+}
+
+/* Function to remove every entry of a cache (the counters are kept)
+   It receives the cache */
+static void Math_cache_remove_all(MathCache *cache){
+
+  pthread_mutex_lock(&cache->lock);
+
+  for(int i=0; i<cache->capacity; i++){
+
+    if(cache->entries[i].key)
+      Math_cache_remove(cache, i);
+  }
+
+  pthread_mutex_unlock(&cache->lock);
+}
+
+/* Function to free the memory of a cache
+   It receives the cache */
+static void Math_cache_destroy(MathCache *cache){
+
+  Math_cache_remove_all(cache);
+  free(cache->entries);
+  free(cache->buckets);
+  pthread_mutex_destroy(&cache->lock);
+}
+
+/* Function that looks up a expression in the cache and compiles it if it is not there
+   It returns true if the syntax is correct, in this case the compiled expression (with a new reference, can be NULL) and its value (NAN if it has variables) are written
+   It receives the cache, the expression, the scratch arena, where to write the compiled expression and the value and a reference to the error (can be NULL) */
+static bool Math_cache_get(MathCache *cache, const char *expression, size_t expression_length, Arena *scratch, CompiledExpr **compiled, double *value, ParseError *error){
+
+  *compiled = NULL;
+  *value = NAN;
+
+  char *key = Arena_alloc(scratch, expression_length + 1);
+  if(!key){
+    if(error){
+      error->kind = PARSE_OUT_OF_MEMORY;
+      error->position = 0;
+    }
+    return false;
+  }
+
+  size_t length = Math_normalize(expression, expression_length, key);
+  uint64_t hash = Math_hash(key, length);
+
+  pthread_mutex_lock(&cache->lock);
+
+  int index = Math_cache_find(cache, key, length, hash);
+  if(index != MATH_CACHE_NO_ENTRY){
+
+    MathCacheEntry *entry = &cache->entries[index];
+    entry->referenced = true;
+    cache->stats.hits++;
+
+    *compiled = entry->compiled;
+    *value = entry->value;
+    if(*compiled)
+      atomic_fetch_add(&(*compiled)->references, 1);
+
+    pthread_mutex_unlock(&cache->lock);
+
+    // Positions of the errors are not cached (they depend on the spaces), so the expression is compiled again to find it
+    if(!*compiled && error)
+      Math_free_compiled(Math_compile_arena(expression, expression_length, scratch, error));
+
+    return *compiled != NULL;
+  }
+
+  cache->stats.misses++;
+  pthread_mutex_unlock(&cache->lock);
+
+  // The cache is not locked while the expression is compiled, so other threads are not blocked
+  ParseError local_error;
+  if(!error)
+    error = &local_error;
+
+  *compiled = Math_compile_arena(expression, expression_length, scratch, error);
+  if(*compiled && Math_variable_count(*compiled) == 0)
+    *value = Bytecode_evaluate(&(*compiled)->bytecode, NULL, scratch);
+
+  // Running out of memory is not a property of the expression
+  if(*compiled || error->kind != PARSE_OUT_OF_MEMORY){
+
+    pthread_mutex_lock(&cache->lock);
+    Math_cache_insert(cache, key, length, hash, *compiled, *value);
+    pthread_mutex_unlock(&cache->lock);
+  }
+
+  return *compiled != NULL;
+}
+
+/* Function that compiles a math expression like Math_compile, but the compiled expression is taken from the expression cache when possible
+   Expressions that only differ in spaces (like "2 + 3" and "2+3") share the same entry
+   It returns a compiled expression (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the expression as a array of chars and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_cache_compile(const char *expression, ParseError *error){
+
+  char buffer[MATH_SCRATCH_SIZE];
+  Arena scratch;
+  Arena_init(&scratch, buffer, sizeof(buffer));
+
+  CompiledExpr *compiled;
+  double value;
+  Math_cache_get(&Math_cache, expression, strlen(expression), &scratch, &compiled, &value, error);
+
+  Arena_free(&scratch);
+  return compiled;
+}
+
+/* Function to change the memory limit of the expression cache, entries are evicted until it is respected
+   It receives the limit in bytes (0 disables the cache) */
+void Math_cache_set_limit(size_t max_bytes){
+
+  pthread_mutex_lock(&Math_cache.lock);
+  Math_cache.stats.max_bytes = max_bytes;
+  Math_cache_evict(&Math_cache, 0);
+  pthread_mutex_unlock(&Math_cache.lock);
+}
+
+/* Function to read the counters of the expression cache
+   It receives a reference to the struct to fill */
+void Math_cache_stats(MathCacheStats *stats){
+
+  pthread_mutex_lock(&Math_cache.lock);
+  *stats = Math_cache.stats;
+  pthread_mutex_unlock(&Math_cache.lock);
+}
+
+/* Function to remove every entry of the expression cache (the counters are kept) */
+void Math_cache_clear(void){
+
+  Math_cache_remove_all(&Math_cache);
+}
+
+// ------------------------------------------------ Context ------------------------------------------------
+
+/* Everything a thread needs to evaluate expressions, see Math_context_create */
+struct MathContext{
+
+  MathConfig config;
+  void *buffer;    // First block of the scratch arena
+  Arena scratch;   // Memory of the tokens, the RPN and the stack of values, reset after each evaluation
+  MathCache cache; // Cache of the expressions evaluated with this context
+};
+
+/* Function to create a context, the context owns its scratch memory, its expression cache and its configuration
+   A context must only be used by one thread at a time, but different threads can use different contexts at the same time without sharing anything
+   It returns the new context (must be released with Math_context_destroy) or NULL if memory allocation failed
+   It receives the configuration (NULL for the default one, see MathConfig) */
+MathContext *Math_context_create(const MathConfig *config){
+
+  MathContext *context = malloc(sizeof(MathContext));
+  if(!context)
+    return NULL;
+
+  MathConfig defaults = {MATH_CACHE_DEFAULT_BYTES, MATH_SCRATCH_SIZE};
+  context->config = config ? *config : defaults;
+
+  context->buffer = malloc(context->config.scratch_bytes);
+  if(!context->buffer){
+    free(context);
+    return NULL;
+  }
+
+  Arena_init(&context->scratch, context->buffer, context->config.scratch_bytes);
+
+  Math_cache_init(&context->cache, context->config.cache_bytes);
+  return context;
+}
+
+/* Function to free a context and everything it owns (compiled expressions returned by Math_context_compile stay valid)
+   It receives the context (can be NULL) */
+void Math_context_destroy(MathContext *context){
+
+  if(!context)
+    return;
+
+  Math_cache_destroy(&context->cache);
+  Arena_free(&context->scratch);
+  free(context->buffer);
+  free(context);
+}
+
+/* Function that compiles a math expression using the memory and the expression cache of a context
+   It returns a compiled expression (must be released with Math_free_compiled) or NULL if the syntax is not correct
+   It receives the context, the expression and a reference to the error that tells what is wrong and where when NULL is returned (can be NULL) */
+CompiledExpr *Math_context_compile(MathContext *context, const char *expression, ParseError *error){
+
+  CompiledExpr *compiled;
+  double value;
+  Math_cache_get(&context->cache, expression, strlen(expression), &context->scratch, &compiled, &value, error);
+
+  Arena_reset(&context->scratch);
+  return compiled;
+}
+
+/* Function that evaluates a math expression using the memory and the expression cache of a context
+   It returns the result as a double
+   It receives the context, the expression, a flag that is set to true if there is a syntax error (or a variable)
+   and a reference to the error that tells what is wrong and where when there is a syntax error (can be NULL) */
+double Math_context_evaluate(MathContext *context, const char *expression, bool *flag_err, ParseError *error){
+
+  return Math_context_evaluate_span(context, expression, strlen(expression), flag_err, error);
+}
+
+/* Function that evaluates the first chars of a array like Math_context_evaluate, but the expression does not need a NULL terminator
+   (for example a line of a file mapped in memory), so it is not copied
+   It returns the result as a double
+   It receives the context, the first char of the expression, its lenght, a flag that is set to true if there is a syntax error (or a variable)
+   and a reference to the error that tells what is wrong and where when there is a syntax error (can be NULL) */
+double Math_context_evaluate_span(MathContext *context, const char *expression, size_t length, bool *flag_err, ParseError *error){
+
+  CompiledExpr *compiled;
+  double result = 0.0;
+
+  // Variables have no value here, so they are an error
+  if(!Math_cache_get(&context->cache, expression, length, &context->scratch, &compiled, &result, error) || Math_variable_count(compiled) > 0){
+    *flag_err = true;
+    result = 0.0;
+  }
+
+  Math_free_compiled(compiled);
+  Arena_reset(&context->scratch);
+  return result;
+}
+
+/* Function to read the counters of the expression cache of a context
+   It receives the context and a reference to the struct to fill */
+void Math_context_stats(MathContext *context, MathCacheStats *stats){
+
+  pthread_mutex_lock(&context->cache.lock);
+  *stats = context->cache.stats;
+  pthread_mutex_unlock(&context->cache.lock);
+}
+
+// ------------------------------------------------ Arbitrary precision ------------------------------------------------
+
+/* Function to compile a math expression into bytecode that is not optimized, for the evaluators that read the numbers again from their text
+   It returns the RPN of the expression (NULL if there is a syntax error or memory allocation failed)
+   It receives the expression and its lenght, the arena of the scratch memory, the bytecode to write and the error (PARSE_OUT_OF_MEMORY if memory allocation failed) */
+static Token *Math_compile_exact(const char *expression, size_t length, Arena *scratch, Bytecode *bytecode, ParseError *error){
+
+  error->kind = PARSE_OUT_OF_MEMORY;
+  error->position = 0;
+
+  Token *tokens = Lexer_tokenize_span(expression, length, scratch);
+  Token *rpn = tokens ? Parser_Shunting_yard(tokens, scratch, error) : NULL;
+  if(!rpn)
+    return NULL;
+
+  error->kind = PARSE_OUT_OF_MEMORY;
+  return Bytecode_from_rpn(rpn, expression, bytecode, scratch) ? rpn : NULL;
+}
+
+/* Function that evaluates a math expression with arbitrary precision (big numbers, see bignum.h) instead of doubles
+   The expression goes through the same lexer, parser and bytecode, but the bytecode is not optimized (its constants would be folded as doubles)
+   and the numbers are read again from their text, exactly (even 0.1 and numbers with more digits than the result)
+   It returns the number of chars of the result (0 if there is a syntax error, a variable or memory allocation failed)
+   It receives the expression and its lenght (it does not need a NULL terminator), the number of significant digits of the result,
+   the array where the result is written as text (at least BIGNUM_TEXT_SIZE(digits) chars)
+   and a reference to the error that tells what is wrong and where when 0 is returned (PARSE_OK for variables, can be NULL) */
+size_t Math_evaluate_precise(const char *expression, size_t length, unsigned int digits, char *result, ParseError *error){
+
+  ParseError local_error;
+  if(!error)
+    error = &local_error;
+
+  char buffer[MATH_SCRATCH_SIZE];
+  Arena scratch;
+  Arena_init(&scratch, buffer, sizeof(buffer));
+
+  unsigned int precision = Bignum_precision(digits);
+  size_t written = 0;
+  Bytecode bytecode;
+
+  Token *rpn = Math_compile_exact(expression, length, &scratch, &bytecode, error);
+  if(rpn){
+
+    // The constant pool has the numbers in the order of the RPN
+    BigNum *constants = Arena_alloc(&scratch, (bytecode.constant_count ? bytecode.constant_count : 1) * sizeof(BigNum));
+    unsigned int count = 0;
+    bool ok = constants != NULL;
+
+    for(unsigned int i=0; ok && rpn[i].kind!=TOK_END; i++){
+      if(Parser_is_number(rpn[i].kind)){
+        Bignum_init(&constants[count]);
+        ok = Bignum_from_text(&expression[rpn[i].offset], rpn[i].length, &constants[count++], UINT_MAX); // Numbers of the expression are exact
+      }
+    }
+
+    BigNum value;
+    Bignum_init(&value);
+
+    // Variables have no value here, so they are an error
+    if(ok && bytecode.variable_count > 0)
+      error->kind = PARSE_OK;
+    else if(ok && Bignum_evaluate(&bytecode, constants, precision, &value)){
+      written = Bignum_to_text(&value, digits, result);
+      error->kind = written ? PARSE_OK : PARSE_OUT_OF_MEMORY;
+    }
+
+    Bignum_free(&value);
+    for(unsigned int i=0; i<count; i++)
+      Bignum_free(&constants[i]);
+  }
+
+  Arena_free(&scratch);
+  return written;
+}
+
+// ------------------------------------------------ Exact rationals ------------------------------------------------
+
+/* Function that evaluates a math expression with exact fractions (rationals, see rational.h) instead of doubles, so .1*10 is exactly 1
+   Numbers are read again from their text, + - * / % and integer powers are exact while the fractions fit in 64 bits,
+   sqrt and other powers are exact when their result is rational, and the rest falls back to doubles (the result is then not exact)
+   It returns false if there is a syntax error, a variable or memory allocation failed
+   It receives the expression and its lenght (it does not need a NULL terminator), where the result is written
+   and a reference to the error that tells what is wrong and where when false is returned (PARSE_OK for variables, can be NULL) */
+bool Math_evaluate_rational(const char *expression, size_t length, Rational *result, ParseError *error){
+
+  ParseError local_error;
+  if(!error)
+    error = &local_error;
+
+  char buffer[MATH_SCRATCH_SIZE];
+  Arena scratch;
+  Arena_init(&scratch, buffer, sizeof(buffer));
+
+  bool ok = false;
+  Bytecode bytecode;
+
+  Token *rpn = Math_compile_exact(expression, length, &scratch, &bytecode, error);
+  Rational *constants = rpn ? Arena_alloc(&scratch, (bytecode.constant_count ? bytecode.constant_count : 1) * sizeof(Rational)) : NULL;
+
+  if(constants){
+
+    // The constant pool has the numbers in the order of the RPN, their doubles are used when they do not fit
+    unsigned int count = 0;
+    for(unsigned int i=0; rpn[i].kind!=TOK_END; i++){
+      if(Parser_is_number(rpn[i].kind)){
+        constants[count] = Rational_from_text(&expression[rpn[i].offset], rpn[i].length, bytecode.constants[count]);
+        count++;
+      }
+    }
+
+    // Variables have no value here, so they are an error
+    if(bytecode.variable_count > 0)
+      error->kind = PARSE_OK;
+    else if(Rational_evaluate(&bytecode, constants, result)){
+      error->kind = PARSE_OK;
+      ok = true;
+    }
+  }
+
+  Arena_free(&scratch);
+  return ok;
+}
+
+// ------------------------------------------------ Default context ------------------------------------------------
+
+/* Function that evaluates a math expression taking all the scratch memory from a arena, that is reset at the end
+   Repeated expressions are found in the expression cache, without lexing nor parsing them again and without any malloc/free
+   It returns the result as a double
+   It receives the expression as a array of chars, the arena and a flag that is set to true if there is a syntax error (or a variable) */
+double Math_interpreter_evaluate_expression_arena(const char *expression, Arena *arena, bool *flag_err){
+
+  CompiledExpr *compiled;
+  double result = 0.0;
+
+  // Variables have no value here, so they are an error
+  if(!Math_cache_get(&Math_cache, expression, strlen(expression), arena, &compiled, &result, NULL) || Math_variable_count(compiled) > 0){
+    *flag_err = true;
+    result = 0.0;
+  }
+
+  Math_free_compiled(compiled);
+  Arena_reset(arena);
+  return result;
 }
 
 /* Function that evaluates a math expression, it does the lexing and parsing (Shunting-Yard+RPN evaluation) parts
@@ -25,23 +974,12 @@ void free_tokens(char **tokens){
    It receives the expression as a array of chars */
 double Math_interpreter_evaluate_expression(char *expression, bool *flag_err){
 
-  char *copy = strdup(expression);
-  char **tokens = Lexer_tokenize(copy);
-  free(copy);
+  char buffer[MATH_SCRATCH_SIZE];
+  Arena arena;
+  Arena_init(&arena, buffer, sizeof(buffer));
 
-  bool is_valid = Parser_is_syntax_correct(tokens);
-  if(!is_valid){
-    *flag_err = true;
-    free_tokens(tokens);
-    return 0.0;
-  }
-  
-  char **rpn = Parser_Shunting_yard(tokens);
-    
-  double result = Parser_evaluate_rpn(rpn);
-
-  free_tokens(tokens);
-  free_tokens(rpn);
+  double result = Math_interpreter_evaluate_expression_arena(expression, &arena, flag_err);
 
+  Arena_free(&arena);
   return result;
-}
\ No newline at end of file
+}
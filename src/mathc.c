@@ -0,0 +1,343 @@
+/* This program is a ahead of time compiler of expressions, it writes the expressions of files (or of the standard input),
+   one per line like "name = expression", as C functions (see codegen.h) and can compile them into a shared library
+   that programs load with dlopen and call without the interpreter. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "../include/math_interpreter.h"
+#include "../include/codegen.h"
+
+#define MATHC_NAME_SIZE 64 // Chars of the names of the functions, including the NULL terminator
+#define MATHC_SYMBOL_SIZE (MATHC_NAME_SIZE + sizeof("_variables") - 1) // Chars of the symbols of a function (name, name_batch and name_variables)
+
+// Exit status
+#define MATHC_EXIT_OK 0         // Every expression was compiled
+#define MATHC_EXIT_EXPRESSION 1 // At least one expression has a error (the library is not built)
+#define MATHC_EXIT_FAILURE 2    // Wrong options, input that can not be read, compiler failure or memory allocation failure
+
+#define MATHC_OPTIONS_INVALID (-1) // Returned by Mathc_parse_options when a option is not valid
+#define MATHC_OPTIONS_HELP (-2)    // Returned by Mathc_parse_options when the help was shown
+
+extern char **environ;
+
+typedef struct{
+
+  const char *library; // Shared library to build (NULL to only write the C source)
+  const char *source;  // File where the C source is written (NULL for the standard output, or a temporary file if there is a library)
+} MathcOptions;
+
+/* Symbols of the functions already written (name, name_batch and name_variables of each one), to report repeated names */
+typedef struct{
+
+  char (*symbols)[MATHC_SYMBOL_SIZE];
+  size_t count;
+  size_t cap;
+} MathcNames;
+
+/* Function to show how the program is used
+   It receives the stream where it is written and the name of the program */
+static void Mathc_usage(FILE *stream, const char *program){
+
+  fprintf(stream,
+          "Usage: %s [options] [file...]\n"
+          "Writes the expressions of the files (or of the standard input, also with -) as C functions.\n"
+          "Each line is \"name = expression\" (or only a expression, named expression_LINE), blank lines and lines starting with # are skipped.\n"
+          "For a name like f the functions are double f(const double *variables), that receives the variables in the order of\n"
+          "f_variables (a NULL terminated array of their names), and void f_batch(const double *const *columns, size_t rows, double *out).\n"
+          "\n"
+          "Options:\n"
+          "  -o LIBRARY    compile the functions into a shared library with the C compiler of the CC variable (default cc)\n"
+          "  -s SOURCE     write the C source to SOURCE (default the standard output, or a temporary file with -o)\n"
+          "  -h            show this help\n"
+          "\n"
+          "Exit status: %d if every expression was compiled, %d if some expression has a error, %d on other failures.\n",
+          program, MATHC_EXIT_OK, MATHC_EXIT_EXPRESSION, MATHC_EXIT_FAILURE);
+}
+
+/* Function to read the options of the command line
+   It returns the index of the first file in argv, MATHC_OPTIONS_INVALID or MATHC_OPTIONS_HELP
+   It receives the arguments of the program and the options to fill */
+static int Mathc_parse_options(int argc, char **argv, MathcOptions *options){
+
+  options->library = NULL;
+  options->source = NULL;
+
+  int i;
+  for(i=1; i<argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++){
+
+    const char *option = argv[i];
+
+    if(strcmp(option, "--") == 0)
+      return i+1;
+
+    if(strcmp(option, "-h") == 0){
+      Mathc_usage(stdout, argv[0]);
+      return MATHC_OPTIONS_HELP;
+    }
+
+    // Every other option has a value, in the same argument (-olib.so) or in the next one (-o lib.so)
+    bool attached = option[2] != '\0';
+    if(!strchr("os", option[1]) || (!attached && i+1 >= argc)){
+      fprintf(stderr, "%s: unknown option or missing value: %s\n", argv[0], option);
+      Mathc_usage(stderr, argv[0]);
+      return MATHC_OPTIONS_INVALID;
+    }
+
+    const char *value = attached ? &option[2] : argv[++i];
+    if(option[1] == 'o')
+      options->library = value;
+    else
+      options->source = value;
+  }
+
+  return i;
+}
+
+/* Function to remember the symbols of a function (name, name_batch and name_variables)
+   It returns false if one of the symbols was already used (like f_batch after f) or memory allocation failed (out_of_memory is set then)
+   It receives the names, the name of the function and the flag of memory allocation failure */
+static bool Mathc_add_name(MathcNames *names, const char *name, bool *out_of_memory){
+
+  char symbols[3][MATHC_SYMBOL_SIZE];
+  snprintf(symbols[0], MATHC_SYMBOL_SIZE, "%s", name);
+  snprintf(symbols[1], MATHC_SYMBOL_SIZE, "%s_batch", name);
+  snprintf(symbols[2], MATHC_SYMBOL_SIZE, "%s_variables", name);
+
+  for(size_t i=0; i<names->count; i++){
+    for(int j=0; j<3; j++){
+      if(strcmp(names->symbols[i], symbols[j]) == 0)
+        return false;
+    }
+  }
+
+  if(names->count + 3 > names->cap){
+
+    size_t cap = names->cap ? names->cap * 2 : 192;
+    char (*grown)[MATHC_SYMBOL_SIZE] = realloc(names->symbols, cap * sizeof(*grown));
+    if(!grown){
+      *out_of_memory = true;
+      return false;
+    }
+    names->symbols = grown;
+    names->cap = cap;
+  }
+
+  memcpy(names->symbols[names->count], symbols, sizeof(symbols));
+  names->count += 3;
+  return true;
+}
+
+/* Function to split a line in the name of the function and the expression
+   It returns false if the name is not valid (a C identifier of less than MATHC_NAME_SIZE chars)
+   It receives the line (it is changed, the expression ends where the line ends), the number of the line,
+   where the name is written and where the start of the expression is written */
+static bool Mathc_split_line(char *line, size_t line_number, char *name, char **expression){
+
+  char *equals = strchr(line, '=');
+  if(!equals){
+    snprintf(name, MATHC_NAME_SIZE, "expression_%zu", line_number);
+    *expression = line;
+    return true;
+  }
+
+  // The name without the spaces around it
+  char *start = line;
+  char *end = equals;
+  while(start < end && isspace((unsigned char) *start))
+    start++;
+  while(end > start && isspace((unsigned char) end[-1]))
+    end--;
+
+  *expression = equals + 1;
+  while(isspace((unsigned char) **expression))
+    (*expression)++;
+
+  if((size_t) (end - start) >= MATHC_NAME_SIZE)
+    return false;
+
+  memcpy(name, start, end - start);
+  name[end - start] = '\0';
+  return Codegen_is_name(name);
+}
+
+/* Function to write the functions of the expressions of a file
+   It returns MATHC_EXIT_OK, MATHC_EXIT_EXPRESSION if some expression has a error or MATHC_EXIT_FAILURE
+   It receives the name of the file ("-" for the standard input), the stream of the C source and the names already used */
+static int Mathc_process_file(const char *path, FILE *output, MathcNames *names){
+
+  bool is_stdin = strcmp(path, "-") == 0;
+  FILE *input = is_stdin ? stdin : fopen(path, "r");
+  if(!input){
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return MATHC_EXIT_FAILURE;
+  }
+
+  char *line = NULL;
+  size_t line_cap = 0;
+  size_t line_number = 0;
+  ssize_t length;
+  int status = MATHC_EXIT_OK;
+  bool out_of_memory = false;
+
+  while(status != MATHC_EXIT_FAILURE && (length = getline(&line, &line_cap, input)) >= 0){
+
+    line_number++;
+    while(length > 0 && (line[length-1] == '\n' || line[length-1] == '\r'))
+      line[--length] = '\0';
+
+    char *first = line;
+    while(isspace((unsigned char) *first))
+      first++;
+    if(*first == '\0' || *first == '#')
+      continue;
+
+    char name[MATHC_NAME_SIZE];
+    char *expression;
+    if(!Mathc_split_line(line, line_number, name, &expression)){
+      fprintf(stderr, "%s:%zu: the name is not valid (it must be a C identifier that is not a keyword, main, a name of math.h or start with math_)\n", path, line_number);
+      status = MATHC_EXIT_EXPRESSION;
+      continue;
+    }
+
+    ParseError error;
+    CompiledExpr *compiled = Math_compile(expression, &error);
+
+    if(!compiled && error.kind == PARSE_OUT_OF_MEMORY)
+      out_of_memory = true;
+    else if(!compiled){
+      fprintf(stderr, "%s:%zu: %s (at char %u of the expression)\n", path, line_number, Parser_error_message(error.kind), error.position + 1);
+      status = MATHC_EXIT_EXPRESSION;
+    }
+    else if(compiled->bytecode.size == 0){
+      fprintf(stderr, "%s:%zu: missing expression after the name %s\n", path, line_number, name);
+      status = MATHC_EXIT_EXPRESSION;
+    }
+    else if(!Mathc_add_name(names, name, &out_of_memory)){
+      if(!out_of_memory){
+        fprintf(stderr, "%s:%zu: the name %s is repeated\n", path, line_number, name);
+        status = MATHC_EXIT_EXPRESSION;
+      }
+    }
+    else if(!Codegen_write_function(output, &compiled->bytecode, name, expression))
+      out_of_memory = true;
+
+    Math_free_compiled(compiled);
+
+    if(out_of_memory){
+      fprintf(stderr, "%s:%zu: out of memory or the source could not be written\n", path, line_number);
+      status = MATHC_EXIT_FAILURE;
+    }
+  }
+
+  if(ferror(input)){
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    status = MATHC_EXIT_FAILURE;
+  }
+
+  free(line);
+  if(!is_stdin)
+    fclose(input);
+
+  return status;
+}
+
+/* Function to compile the C source into a shared library with the C compiler (floating point contraction off, like the interpreter)
+   It returns true if the library was built
+   It receives the name of the program, the C source and the library */
+static bool Mathc_build_library(const char *program, const char *source, const char *library){
+
+  const char *compiler = getenv("CC");
+  if(!compiler || compiler[0] == '\0')
+    compiler = "cc";
+
+  char *arguments[] = {(char *) compiler, "-O2", "-ffp-contract=off", "-shared", "-fPIC", "-x", "c", (char *) source, "-x", "none",
+                       "-o", (char *) library, "-lm", NULL};
+
+  pid_t pid;
+  int error = posix_spawnp(&pid, compiler, NULL, NULL, arguments, environ);
+  if(error != 0){
+    fprintf(stderr, "%s: could not run %s: %s\n", program, compiler, strerror(error));
+    return false;
+  }
+
+  int status;
+  while(waitpid(pid, &status, 0) < 0){
+    if(errno != EINTR){
+      fprintf(stderr, "%s: could not wait for %s: %s\n", program, compiler, strerror(errno));
+      return false;
+    }
+  }
+
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+    fprintf(stderr, "%s: %s could not compile the library\n", program, compiler);
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv){
+
+  MathcOptions options;
+  int first_file = Mathc_parse_options(argc, argv, &options);
+  if(first_file == MATHC_OPTIONS_HELP)
+    return MATHC_EXIT_OK;
+  if(first_file == MATHC_OPTIONS_INVALID)
+    return MATHC_EXIT_FAILURE;
+
+  // The source goes to its file, to a temporary file if it is only needed by the compiler, or to the standard output
+  char temporary[] = "/tmp/mathcXXXXXX";
+  const char *source = options.source;
+  FILE *output = stdout;
+
+  if(!source && options.library){
+    int descriptor = mkstemp(temporary);
+    output = descriptor >= 0 ? fdopen(descriptor, "w") : NULL;
+    source = temporary;
+  }
+  else if(source)
+    output = fopen(source, "w");
+
+  if(!output){
+    fprintf(stderr, "%s: could not write the source %s: %s\n", argv[0], source, strerror(errno));
+    return MATHC_EXIT_FAILURE;
+  }
+
+  int status = Codegen_write_prelude(output) ? MATHC_EXIT_OK : MATHC_EXIT_FAILURE;
+  MathcNames names = {NULL, 0, 0};
+
+  // Without files the expressions come from the standard input
+  char *standard_input[] = {"-"};
+  char **files = first_file < argc ? &argv[first_file] : standard_input;
+  int file_count = first_file < argc ? argc - first_file : 1;
+
+  for(int i=0; i<file_count && status != MATHC_EXIT_FAILURE; i++){
+
+    int file_status = Mathc_process_file(files[i], output, &names);
+    if(file_status > status)
+      status = file_status;
+  }
+
+  free(names.symbols);
+
+  if((output == stdout ? fflush(output) : fclose(output)) != 0 && status != MATHC_EXIT_FAILURE){
+    fprintf(stderr, "%s: could not write the source: %s\n", argv[0], strerror(errno));
+    status = MATHC_EXIT_FAILURE;
+  }
+
+  if(options.library && status == MATHC_EXIT_OK && !Mathc_build_library(argv[0], source, options.library))
+    status = MATHC_EXIT_FAILURE;
+
+  if(source == temporary)
+    unlink(temporary);
+
+  return status;
+}
@@ -1,73 +1,93 @@
-/* This program is part of the math interpreter, it is a parser that implements an expression syntax verifier, Shunting-yard algorithm
-   and a RPN evaluator. All of those functions depends on the infix expression being already tokenized by the lexer and in a array of string format.
+/* This program is part of the math interpreter, it is a parser that implements a Shunting-yard algorithm that also verifies the syntax of the expression
+   and a RPN evaluator. All of those functions depends on the infix expression being already tokenized by the lexer into a TOK_END terminated array of tokens.
    It was made by Pedro Arthur Marchi [github.com/PAMarchi]. */
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
 #include <stdbool.h>
-#include <stddef.h>
 #include <math.h>
-#include <errno.h>
 
 #include "../include/parser.h"
+#include "../include/bytecode.h"
 
 /* Function to tell if a token is a operator or not
    It returns true if the token is a operator
-   It receives the token */
-bool Parser_is_operator(const char *tok){
-
-  return strlen(tok) == 1 && strchr("+-*/%^", tok[0]);
+   It receives the kind of the token */
+bool Parser_is_operator(TokenKind tok){
+
+  switch(tok){
+    case TOK_PLUS:
+    case TOK_MINUS:
+    case TOK_MULTIPLY:
+    case TOK_DIVIDE:
+    case TOK_MOD:
+    case TOK_POWER:
+      return true;
+    default:
+      return false;
+  }
 }
 
 /* Similar to Parser_is_operator, but considers unary operator as such 
    It returns true if the token is a operator
-   It receives the token */
-bool Parser_is_any_operator(const char *tok){
+   It receives the kind of the token */
+bool Parser_is_any_operator(TokenKind tok){
   
-  return Parser_is_operator(tok) || strcmp(tok, "u-") == 0;
+  return Parser_is_operator(tok) || tok == TOK_NEGATE;
 }
 
 /* Function to tell if a token is a number or not
    It returns true if the token is a number
-   It receives the token */
-bool Parser_is_number(const char *tok){
+   It receives the kind of the token */
+bool Parser_is_number(TokenKind tok){
+
+  return tok == TOK_NUMBER;
+}
+
+/* Function to tell if a token is a operand (number or variable) or not
+   It returns true if the token is a operand
+   It receives the kind of the token */
+bool Parser_is_operand(TokenKind tok){
 
-  return isdigit(tok[0]) || tok[0] == '.';
+  return tok == TOK_NUMBER || tok == TOK_VARIABLE;
 }
 
 /* Function to tell if a token is a function or not
    It returns true if the token is a function
-   It receives the token */
-bool Parser_is_function(const char *tok){
+   It receives the kind of the token */
+bool Parser_is_function(TokenKind tok){
 
-  return isalpha(tok[0]) && strlen(tok)>1;
+  return tok == TOK_SQRT;
 }
 
 /* Function to return the precendence of a operator 
    It returns the precedence in form of a int
-   It receives the operator to evaluate */
-int Parser_precedence_of(const char *op){
-
-  if(strcmp(op, "u-")==0)  
-    return 5;
-  if(strcmp(op, "^")==0)   
-    return 4;
-  if(strchr("*/%", op[0])) 
-    return 3;
-  if(strchr("+-", op[0]))  
-    return 2;
-
-  return 0;
+   It receives the kind of the operator to evaluate */
+int Parser_precedence_of(TokenKind op){
+
+  switch(op){
+    case TOK_NEGATE:
+      return 5;
+    case TOK_POWER:
+      return 4;
+    case TOK_MULTIPLY:
+    case TOK_DIVIDE:
+    case TOK_MOD:
+      return 3;
+    case TOK_PLUS:
+    case TOK_MINUS:
+      return 2;
+    default:
+      return 0;
+  }
 }
 
 /* Function to return the associativity of a operator
    It returns if the operator has RIGHT or LEFT associativity 
-   It receives a operator */
-Associativity Parser_assoc_of(const char *op){
+   It receives the kind of a operator */
+Associativity Parser_assoc_of(TokenKind op){
 
-  if(strcmp(op, "^")==0 || strcmp(op, "u-")==0)
+  if(op == TOK_POWER || op == TOK_NEGATE)
     return RIGHT;
 
   return LEFT;
@@ -75,9 +95,9 @@ Associativity Parser_assoc_of(const char *op){
 
 /* Function to return the arity of an operator 
    It returns 1 if is unary or 2 for binary */
-int Parser_arity_of(const char *op){
+int Parser_arity_of(TokenKind op){
 
-  if(Parser_is_function(op) || strcmp(op, "u-")==0) 
+  if(Parser_is_function(op) || op == TOK_NEGATE) 
     return 1;
   if(Parser_is_operator(op)) 
     return 2;
@@ -85,283 +105,195 @@ int Parser_arity_of(const char *op){
   return 0;
 }
 
-/* Function to analyse the syntax of the array representing the expression
-   It returns true if the syntax is correct
-   It receives the whole expression array */
-bool Parser_is_syntax_correct(char **expression){
-
-  int parentheses=0;
-  char *previous_tok = NULL; // Previous token
+/* Function to set the error of the parser
+   It returns NULL, so it can be used as the return value of Parser_Shunting_yard
+   It receives a reference to the error (can be NULL), the kind of the error and the position of the char where it was found */
+static Token *Parser_set_error(ParseError *error, ParseErrorKind kind, unsigned int position){
 
-  for(unsigned int i=0; expression[i]!=NULL; i++){
+  if(error){
+    error->kind = kind;
+    error->position = position;
+  }
 
-    char *current_token = expression[i];
-    char *next_token = expression[i+1]; // Could be NULL
+  return NULL;
+}
 
-    // If the token is a number
-    if(Parser_is_number(current_token)){
+/* Function to return a message that describes a kind of error of the parser
+   It receives the kind of the error */
+const char *Parser_error_message(ParseErrorKind kind){
+
+  switch(kind){
+    case PARSE_OK:                 return "no error";
+    case PARSE_INVALID_TOKEN:      return "invalid number or symbol";
+    case PARSE_MISSING_OPERAND:    return "missing operand";
+    case PARSE_MISSING_OPERATOR:   return "missing operator";
+    case PARSE_MISSING_OPEN_PAREN: return "missing '(' after function";
+    case PARSE_UNMATCHED_OPEN_PAREN:  return "'(' is never closed";
+    case PARSE_UNMATCHED_CLOSE_PAREN: return "')' without '('";
+    case PARSE_OUT_OF_MEMORY:      return "out of memory";
+    default:                       return "unknown error";
+  }
+}
 
-      unsigned int number_lenght = strlen(current_token);
-      unsigned int dot_count=0;
+/* Function to validate infix (The infix is the TOK_END terminated array of tokens) tokens and convert them in RPN, in a single pass
+   The parser alternates between expecting an operand (number, variable, '(', function or unary '-') and expecting an operator (binary operator or ')'),
+   so the syntax is checked while the Shunting-yard algorithm runs. An empty expression is valid (its RPN is empty)
+   It returns a new TOK_END terminated array of tokens in Reverse Polish Notation (RPN), or NULL if the syntax is not correct
+   It receives an TOK_END terminated array of tokens, the arena to allocate from (NULL to use malloc)
+   and a reference to the error that is filled when NULL is returned (can be NULL) */
+Token *Parser_Shunting_yard(const Token *infix, Arena *arena, ParseError *error){
 
-      // Roam token to see if it find 2 dots, which is -> syntax error
-      for(unsigned int j=0; j<(number_lenght-1); j++){
+  TokenStack operator_stack;
+  TokenQueue output_queue;
+  Stack_init(&operator_stack, arena);
+  Queue_init(&output_queue, arena);
 
-        if(current_token[j]=='.')
-          dot_count++;
-      }
+  Parser_set_error(error, PARSE_OK, 0);
 
-      // If there is more than 1 dot in the expression -> error
-      if(dot_count>1)
-        return false;
+  bool expect_operand = infix[0].kind != TOK_END; // The empty expression is the only one that can end without operand
+  ParseErrorKind kind = PARSE_OK;
+  unsigned int i;
 
-      // If the number has a dot as the last char (no numbers after) -> syntax error
-      if(current_token[number_lenght-1] == '.')
-        return false;
-    }
+  for(i=0; infix[i].kind!=TOK_END; i++){
 
-    // If the token is a function (like sqrt)
-    else if(Parser_is_function(current_token)){
+    Token tok = infix[i];
 
-      // It should necessarily have a parentheses after, but it still checks right here
-      if(next_token==NULL || strcmp(next_token, "(")!=0)
-        return false;
-      
+    if(tok.kind == TOK_INVALID){
+      kind = PARSE_INVALID_TOKEN;
+      break;
     }
 
-    // If is a '(', which here is not listed as an operator
-    else if(strcmp(current_token, "(")==0)
-      parentheses++;
-
-    // If is a ')', which here is not listed as an operator
-    else if(strcmp(current_token, ")")==0){
+    if(expect_operand){
 
-      if(parentheses==0)
-        return false;
-      
-      parentheses--;
-    }
+      // If the token is a number or variable place it in the output queue
+      if(Parser_is_operand(tok.kind)){
+        Queue_enqueue(&output_queue, tok);
+        expect_operand = false;
+      }
 
-    // If the token is a operator
-    else if(Parser_is_operator(current_token)){
+      // If the token is a function push it to the stack, it must be followed by a "("
+      else if(Parser_is_function(tok.kind)){
 
-      bool is_unary = false;
+        if(infix[i+1].kind != TOK_OPEN_PAREN){
+          i++;
+          kind = PARSE_MISSING_OPEN_PAREN;
+          break;
+        }
+        Stack_push(&operator_stack, tok);
+      }
 
-      // Detect unary operator if "-" comes 
-      // in the beginning of the expression, or
-      // after "(" or another operator
-      if(strcmp(current_token, "-")==0 && (previous_tok==NULL || Parser_is_operator(previous_tok) || strcmp(previous_tok, "(")==0))
-        is_unary = true;
+      // If the token is a "("
+      else if(tok.kind == TOK_OPEN_PAREN)
+        Stack_push(&operator_stack, tok);
 
-      if(is_unary){
+      // A "-" where an operand is expected is unary, it can not be followed by another "-"
+      else if(tok.kind == TOK_MINUS && infix[i+1].kind != TOK_MINUS){
 
-        // Unary only comes before number, "(" or function
-        if(next_token==NULL || !(Parser_is_number(next_token) || strcmp(next_token, "(")==0 || Parser_is_function(next_token)))
-          return false;
+        tok.kind = TOK_NEGATE;
+        Stack_push(&operator_stack, tok); // Nothing has a higher precedence, so nothing is popped
       }
-      // If its binary
-      else{
-
-        // Binary only comes after number or ")"
-        if(!(previous_tok && (Parser_is_number(previous_tok) || strcmp(previous_tok, ")")==0)))
-          return false;
 
-        // Binary only comes before number, "(", function or unary
-        if(next_token==NULL || !(Parser_is_number(next_token) || strcmp(next_token, "(")==0 || Parser_is_function(next_token) || strcmp(next_token, "-")==0))
-          return false;
+      else{
+        kind = PARSE_MISSING_OPERAND;
+        break;
       }
     }
-  
-    // If the token is nothing listed
-    else
-      return false;
-
-    previous_tok = current_token;
-  }
-
-  // Parentheses not balanced
-  if(parentheses!=0)
-    return false;
-  
-  // Last token cant be a binary operator
-  if(previous_tok && Parser_is_operator(previous_tok))
-    return false;
-  
-  return true;
-}
-
-/* Function to allocate memory for a string 
-   Used in the Shunting-yard to duplicate tokens of the original array
-   It returns a pointer to the string 
-   It receives a string */
-char *Parser_add_token(const char *src){
-
-  size_t lenght = strlen(src);
-
-  char *tok = malloc(lenght + 1);
-  if (!tok) 
-    return NULL;
-  
-  memcpy(tok, src, lenght + 1);
-
-  return tok;
-}
-
-/* Function to convert infix (The infix is the NULL terminated array of tokens) tokens in RPN 
-   It must be called after is_syntax_correct and only if the returned value is true
-   It returns a new NULL terminated array of tokens in Reverse Polish Notation (RPN)
-   It receives an NULL terminated array of tokens */
-char **Parser_Shunting_yard(char **infix){
 
-  TokenStack operator_stack;
-  TokenQueue output_queue;
-  Stack_init(&operator_stack);
-  Queue_init(&output_queue);
+    else{
 
-  for(unsigned int i=0; infix[i]!=NULL; i++){
+      if(Parser_is_operator(tok.kind)){
 
-    char *tok          = infix[i];
-    char *previous_tok = (i>0 ? infix[i-1] : NULL);
+        while(!Stack_is_empty(&operator_stack)){
 
-    // If the token is a number place the number in the output queue
-    if(Parser_is_number(tok))
-      Queue_enqueue(&output_queue, Parser_add_token(tok));
+          TokenKind top = Stack_peek(&operator_stack)->kind;
 
-    // If the token is a function push it to the stack
-    else if(Parser_is_function(tok))
-      Stack_push(&operator_stack, Parser_add_token(tok));
+          if(Parser_is_any_operator(top) && ((Parser_assoc_of(tok.kind)==LEFT && Parser_precedence_of(tok.kind) <= Parser_precedence_of(top)) || (Parser_assoc_of(tok.kind)==RIGHT && Parser_precedence_of(tok.kind) < Parser_precedence_of(top))))
+            Queue_enqueue(&output_queue, Stack_pop(&operator_stack));
+          else
+            break;
+        }
 
-    else if(Parser_is_operator(tok)){
+        Stack_push(&operator_stack, tok);
+        expect_operand = true;
+      }
 
-      // Analyse if "-" is unary and if so, change to "u-"
-      if(strcmp(tok, "-")==0 && (previous_tok==NULL || Parser_is_operator(previous_tok) || strcmp(previous_tok, "(")==0)){
+      // If the token is a ")"
+      else if(tok.kind == TOK_CLOSE_PAREN){
 
-        tok = "u-";
-      }
+        // Pop until "("
+        while(!Stack_is_empty(&operator_stack) && Stack_peek(&operator_stack)->kind != TOK_OPEN_PAREN)
+          Queue_enqueue(&output_queue, Stack_pop(&operator_stack));
 
-      while(!Stack_is_empty(&operator_stack)){
+        if(Stack_is_empty(&operator_stack)){
+          kind = PARSE_UNMATCHED_CLOSE_PAREN;
+          break;
+        }
 
-        char *top = Stack_peek(&operator_stack);
+        // Remove "("
+        Stack_pop(&operator_stack);
 
-        if(Parser_is_any_operator(top) && ((Parser_assoc_of(tok)==LEFT && Parser_precedence_of(tok) <= Parser_precedence_of(top)) || (Parser_assoc_of(tok)==RIGHT && Parser_precedence_of(tok) < Parser_precedence_of(top))))
+        // If there is a function
+        if(!Stack_is_empty(&operator_stack) && Parser_is_function(Stack_peek(&operator_stack)->kind))
           Queue_enqueue(&output_queue, Stack_pop(&operator_stack));
-        else
-          break;
       }
 
-      Stack_push(&operator_stack, Parser_add_token(tok));
+      else{
+        kind = PARSE_MISSING_OPERATOR;
+        break;
+      }
     }
+  }
 
-    // If the token is a "("
-    else if(strcmp(tok, "(")==0)
-      Stack_push(&operator_stack, Parser_add_token(tok));
+  unsigned int position = infix[i].offset;
 
-    // If the token is a ")"
-    else if(strcmp(tok, ")")==0){
+  // The expression can not end with an operator, "(" or function
+  if(kind == PARSE_OK && expect_operand)
+    kind = PARSE_MISSING_OPERAND;
 
-      // Pop until "("
-      while(!Stack_is_empty(&operator_stack) && strcmp(Stack_peek(&operator_stack), "(")!=0)
-        Queue_enqueue(&output_queue, Stack_pop(&operator_stack));
+  // When the infix is over -> place everything of the stack in the output queue, a "(" left means that the parentheses are not balanced
+  while(kind == PARSE_OK && !Stack_is_empty(&operator_stack)){
 
-      // Remove "("
-      if(!Stack_is_empty(&operator_stack) && strcmp(Stack_peek(&operator_stack), "(")==0)
-        free(Stack_pop(&operator_stack));
+    Token tok = Stack_pop(&operator_stack);
 
-      // If there is a function
-      if(!Stack_is_empty(&operator_stack) && Parser_is_function(Stack_peek(&operator_stack)))
-        Queue_enqueue(&output_queue, Stack_pop(&operator_stack));
+    if(tok.kind == TOK_OPEN_PAREN){
+      kind = PARSE_UNMATCHED_OPEN_PAREN;
+      position = tok.offset;
     }
+    else
+      Queue_enqueue(&output_queue, tok);
   }
 
-  //quando o infix está vazio -> colocar tudo de stack no output queue
-  while(!Stack_is_empty(&operator_stack))
-    Queue_enqueue(&output_queue, Stack_pop(&operator_stack));
-
   // Convert the output_queue in array RPN
-  char **rpn = Queue_to_array(&output_queue);
+  Token *rpn = NULL;
+  if(kind == PARSE_OK){
+
+    rpn = Queue_to_array(&output_queue);
+    if(!rpn)
+      kind = PARSE_OUT_OF_MEMORY;
+  }
+
   Stack_free(&operator_stack);
   Queue_free(&output_queue);
+
+  if(kind != PARSE_OK)
+    return Parser_set_error(error, kind, position);
+
   return rpn;
 }
 
-/* Function to evaluete a NULL terminated array of tokens in RPN 
+/* Function to evaluete a TOK_END terminated array of tokens in RPN 
+   The RPN is lowered into bytecode first (see bytecode.h), to evaluate the same RPN many times use Bytecode_evaluate directly
+   The RPN can not have variables (the result is NAN)
    It returns the result of the expression in double format
-   It receives a NULL terminated array in RPN */
-double Parser_evaluate_rpn(char **rpn){
-
-  DoubleStack values;
-  DoubleStack_init(&values);
+   It receives a TOK_END terminated array in RPN */
+double Parser_evaluate_rpn(const Token *rpn){
 
-  for(unsigned int i=0; rpn[i]!=NULL; i++){
+  Bytecode bytecode;
+  if(!Bytecode_from_rpn(rpn, NULL, &bytecode, NULL))
+    return NAN;
 
-    char *tok = rpn[i];
+  double result = Bytecode_evaluate(&bytecode, NULL, NULL);
+  Bytecode_free(&bytecode);
 
-    // If its a number
-    if(Parser_is_number(tok))
-      DoubleStack_push(&values,atof(tok));
-    
-    // If its an operator or function
-    else{
-
-      int arity = Parser_arity_of(tok); // Returns 1 for "-u" or "sqrt"; 2 for the rest of operators
-      double args[2];
-
-      for(int j=arity-1; j>=0; j--)
-        args[j] = DoubleStack_pop(&values);
-
-      double result;
-      
-      // Unary functions
-      if(arity==1){
-
-        if(strcmp(tok, "u-")==0)
-          result = -args[0];
-        else if(strcmp(tok, "sqrt")==0){
-
-          if(args[0]<0) // If the number is negative
-            result = NAN;
-          else
-            result = sqrt(args[0]);
-        }
-          
-      }
-
-      // Binary functions
-      else{
-
-        if(strcmp(tok, "+")==0)
-          result = args[0] + args[1];
-        else if(strcmp(tok, "-")==0)
-          result = args[0] - args[1];
-        else if(strcmp(tok, "*")==0)
-          result = args[0] * args[1];
-        else if(strcmp(tok, "^")==0)
-          result = pow(args[0], args[1]);
-        else if(strcmp(tok, "/")==0){
-
-          if(args[1]==0.0) // Division by 0
-            result=NAN;
-          else 
-            result = args[0] / args[1];
-        }
-        else if(strcmp(tok, "%")==0){
-          
-          if(args[1]==0.0) // Division by 0
-            result=NAN;
-          else 
-            result = (int) args[0] % (int) args[1];
-        }
-      }
-
-      DoubleStack_push(&values, result);
-    }
-  }
-
-  double final_result = DoubleStack_pop(&values);
-  DoubleStack_free(&values);
-
-  return final_result;
+  return result;
 }
-
-
-  
\ No newline at end of file
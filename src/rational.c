@@ -0,0 +1,464 @@
+/* This program is part of the math interpreter, it implements exact fractions of 64 bits integers (rational numbers).
+   The operations are done with 128 bits integers, so their results never overflow, and the fractions are only reduced
+   (with the binary GCD) when the result does not fit in 64 bits. Results that still do not fit, or that are not rational
+   (like sqrt(2)), fall back to doubles. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../include/rational.h"
+#include "../include/format.h"
+
+#define RATIONAL_MAX_SCALE 38         // Biggest power of 10 that fits in 128 bits
+#define RATIONAL_MAX_EXPONENT 100000  // Exponents of the text of a number are clamped to this
+
+typedef __int128 Wide;
+typedef unsigned __int128 UWide;
+
+// ------------------------------------------------ Fractions ------------------------------------------------
+
+/* Function to make a rational that is not exact
+   It returns the rational and receives its value */
+static Rational Rational_inexact(double value){
+
+  Rational r = {false, 0, 1, value};
+  return r;
+}
+
+/* Function to tell if a 128 bits integer fits in 64 bits
+   It returns true if it fits and receives the integer */
+static bool Rational_fits(Wide x){
+
+  return x >= INT64_MIN && x <= INT64_MAX;
+}
+
+/* Function to count the trailing zero bits of a 128 bits integer
+   It returns the number of bits and receives the integer (not 0) */
+static int Rational_trailing_zeros(UWide x){
+
+  uint64_t low = (uint64_t) x;
+  return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t) (x >> 64));
+}
+
+/* Function to calculate the greatest common divisor with the binary GCD (only shifts and subtractions)
+   It returns the divisor (the other number if one of them is 0), and receives the two numbers */
+static UWide Rational_gcd(UWide a, UWide b){
+
+  if(!a)
+    return b;
+  if(!b)
+    return a;
+
+  int shift = Rational_trailing_zeros(a | b);
+  a >>= Rational_trailing_zeros(a);
+
+  do{
+    b >>= Rational_trailing_zeros(b);
+    if(a > b){
+      UWide t = a;
+      a = b;
+      b = t;
+    }
+    b -= a;
+  } while(b);
+
+  return a << shift;
+}
+
+/* Function to make a rational from a fraction of 128 bits integers, it is only reduced if it does not fit in 64 bits
+   It returns the rational (not exact if it does not fit even reduced), and receives the numerator and the denominator (not 0) */
+static Rational Rational_from_wide(Wide num, Wide den){
+
+  if(den < 0){
+    num = -num;
+    den = -den;
+  }
+
+  if(!Rational_fits(num) || !Rational_fits(den)){
+    Wide divisor = (Wide) Rational_gcd(num < 0 ? (UWide) -num : (UWide) num, (UWide) den);
+    num /= divisor;
+    den /= divisor;
+    if(!Rational_fits(num) || !Rational_fits(den))
+      return Rational_inexact((double) num / (double) den);
+  }
+
+  Rational r = {true, (int64_t) num, (int64_t) den, 0.0};
+  return r;
+}
+
+/* Function to make a exact fraction
+   It returns the rational (not exact if den is 0), and receives the numerator and the denominator */
+Rational Rational_make(int64_t num, int64_t den){
+
+  if(den == 0)
+    return Rational_inexact((double) num / 0.0);
+
+  return Rational_from_wide(num, den);
+}
+
+/* Function to reduce a fraction to its lowest terms (binary GCD)
+   It returns the reduced rational and receives the rational */
+Rational Rational_reduce(Rational r){
+
+  if(!r.exact)
+    return r;
+
+  Wide num = r.num;
+  int64_t divisor = (int64_t) Rational_gcd(num < 0 ? (UWide) -num : (UWide) num, (UWide) r.den);
+  if(divisor > 1){
+    r.num = (int64_t) (num / divisor);
+    r.den /= divisor;
+  }
+
+  return r;
+}
+
+/* Function to convert a rational into a double
+   It returns the double and receives the rational */
+double Rational_to_double(Rational r){
+
+  if(!r.exact)
+    return r.value;
+
+  r = Rational_reduce(r);
+  return (double) r.num / (double) r.den;
+}
+
+// ------------------------------------------------ Conversions ------------------------------------------------
+
+/* Function to convert a double into a rational, exact when the double is a fraction of 64 bits integers (like 0.5 or 3)
+   It returns the rational and receives the double */
+Rational Rational_from_double(double value){
+
+  if(!isfinite(value))
+    return Rational_inexact(value);
+  if(value == 0.0)
+    return Rational_make(0, 1);
+
+  // value = mantissa * 2^exponent, with a odd mantissa of at most 53 bits
+  int exponent;
+  int64_t mantissa = (int64_t) ldexp(frexp(value, &exponent), 53);
+  exponent -= 53;
+  int zeros = __builtin_ctzll((uint64_t) mantissa);
+  mantissa >>= zeros;
+  exponent += zeros;
+
+  if(exponent < 0)
+    return exponent >= -62 ? Rational_make(mantissa, (int64_t) 1 << -exponent) : Rational_inexact(value);
+
+  if(exponent >= 63 || llabs(mantissa) > (INT64_MAX >> exponent))
+    return Rational_inexact(value);
+
+  return Rational_make(mantissa * ((int64_t) 1 << exponent), 1);
+}
+
+/* Function to convert the text of a number (see number.h) into a rational, decimals are exact (like 0.1 = 1/10) if they fit in 64 bits
+   It returns the rational, and receives the first char, the number of chars and the value of the number as a double (used when it does not fit) */
+Rational Rational_from_text(const char *text, size_t length, double value){
+
+  // Hex numbers are fractions with a power of 2 as denominator, like their double
+  if(length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+    return Rational_from_double(value);
+
+  // Digits, with the number of decimals as scale (value = num / 10^scale)
+  Wide num = 0;
+  long scale = 0;
+  bool decimals = false;
+  size_t i = 0;
+
+  for(; i<length; i++){
+
+    char c = text[i];
+    if(c == '_')
+      continue;
+    if(c == '.'){
+      decimals = true;
+      continue;
+    }
+    if(c < '0' || c > '9')
+      break;
+
+    if(num >= (Wide) 1e37){
+      if(c != '0')
+        return Rational_inexact(value);
+      if(!decimals)
+        scale--; // Zeros that do not fit are a power of 10, and the ones after the dot do not change the number
+      continue;
+    }
+
+    num = num * 10 + (c - '0');
+    if(decimals)
+      scale++;
+  }
+
+  if(i < length && (text[i] == 'e' || text[i] == 'E')){
+
+    i++;
+    bool negative = i < length && text[i] == '-';
+    if(i < length && (text[i] == '-' || text[i] == '+'))
+      i++;
+
+    long exponent = 0;
+    for(; i<length; i++){
+      if(text[i] >= '0' && text[i] <= '9' && exponent < RATIONAL_MAX_EXPONENT)
+        exponent = exponent * 10 + (text[i] - '0');
+    }
+    scale += negative ? exponent : -exponent;
+  }
+
+  if(num == 0)
+    return Rational_make(0, 1);
+
+  while(scale > 0 && num % 10 == 0){
+    num /= 10;
+    scale--;
+  }
+
+  for(; scale < 0; scale++){
+    if(num > INT64_MAX / 10)
+      return Rational_inexact(value);
+    num *= 10;
+  }
+
+  if(scale > RATIONAL_MAX_SCALE)
+    return Rational_inexact(value);
+
+  Wide den = 1;
+  for(; scale > 0; scale--)
+    den *= 10;
+
+  return Rational_from_wide(num, den);
+}
+
+/* Function to write a rational, exact ones as a reduced fraction (like 1/3 or 2) and the others as a double (like 1.4142135623730951)
+   It returns the number of chars written (without the NULL terminator)
+   It receives the rational and the array where the text is written (at least RATIONAL_TEXT_SIZE chars) */
+size_t Rational_to_text(Rational r, char *buffer){
+
+  if(!r.exact)
+    return Format_double(r.value, buffer);
+
+  r = Rational_reduce(r);
+  if(r.den == 1)
+    return (size_t) snprintf(buffer, RATIONAL_TEXT_SIZE, "%" PRId64, r.num);
+
+  return (size_t) snprintf(buffer, RATIONAL_TEXT_SIZE, "%" PRId64 "/%" PRId64, r.num, r.den);
+}
+
+// ------------------------------------------------ Operations ------------------------------------------------
+
+/* Functions of the operations on rationals, the result is exact when the operands are exact and it fits in 64 bits
+   sqrt and ^ are exact when the result is rational (like sqrt(9/4) or 8^(1/3)), % is the remainder of the truncated division (like fmod)
+   They return the result and receive the operands */
+Rational Rational_add(Rational a, Rational b){
+
+  if(!a.exact || !b.exact)
+    return Rational_inexact(Rational_to_double(a) + Rational_to_double(b));
+
+  if(a.den == b.den)
+    return Rational_from_wide((Wide) a.num + b.num, a.den);
+
+  return Rational_from_wide((Wide) a.num * b.den + (Wide) b.num * a.den, (Wide) a.den * b.den);
+}
+
+Rational Rational_sub(Rational a, Rational b){
+
+  if(!a.exact || !b.exact)
+    return Rational_inexact(Rational_to_double(a) - Rational_to_double(b));
+
+  if(a.den == b.den)
+    return Rational_from_wide((Wide) a.num - b.num, a.den);
+
+  return Rational_from_wide((Wide) a.num * b.den - (Wide) b.num * a.den, (Wide) a.den * b.den);
+}
+
+Rational Rational_mul(Rational a, Rational b){
+
+  if(!a.exact || !b.exact)
+    return Rational_inexact(Rational_to_double(a) * Rational_to_double(b));
+
+  return Rational_from_wide((Wide) a.num * b.num, (Wide) a.den * b.den);
+}
+
+Rational Rational_div(Rational a, Rational b){
+
+  // Division by 0 is NAN, like in the double evaluation
+  if(Rational_to_double(b) == 0.0)
+    return Rational_inexact(NAN);
+
+  if(!a.exact || !b.exact)
+    return Rational_inexact(Rational_to_double(a) / Rational_to_double(b));
+
+  return Rational_from_wide((Wide) a.num * b.den, (Wide) a.den * b.num);
+}
+
+Rational Rational_mod(Rational a, Rational b){
+
+  if(!a.exact || !b.exact || b.num == 0)
+    return Rational_inexact(fmod(Rational_to_double(a), Rational_to_double(b)));
+
+  // a - trunc(a/b)*b = (n % d) / (a.den*b.den), with a/b = n/d
+  Wide n = (Wide) a.num * b.den;
+  Wide d = (Wide) a.den * b.num;
+  return Rational_from_wide(n % d, (Wide) a.den * b.den);
+}
+
+/* Function to calculate the power of a 64 bits integer (squaring loop)
+   It returns false if it overflows, and receives the base, the exponent and where the power is written */
+static bool Rational_integer_power(int64_t base, uint64_t exponent, int64_t *power){
+
+  int64_t result = 1;
+  while(exponent){
+    if((exponent & 1) && __builtin_mul_overflow(result, base, &result))
+      return false;
+    exponent >>= 1;
+    if(exponent && __builtin_mul_overflow(base, base, &base))
+      return false;
+  }
+
+  *power = result;
+  return true;
+}
+
+/* Function to calculate the exact n-th root of a 64 bits integer
+   It returns false if the root is not a integer, and receives the integer (not negative), n (at least 2) and where the root is written */
+static bool Rational_integer_root(int64_t x, uint64_t n, int64_t *root){
+
+  if(x < 2){
+    *root = x;
+    return true;
+  }
+  if(n >= 63)
+    return false;
+
+  // The root of the double is at most one unit away from the exact one
+  int64_t guess = llround(pow((double) x, 1.0 / (double) n));
+  for(int64_t candidate = guess > 0 ? guess - 1 : 0; candidate <= guess + 1; candidate++){
+    int64_t power;
+    if(Rational_integer_power(candidate, n, &power) && power == x){
+      *root = candidate;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Function to raise a reduced fraction to a integer exponent (powers of reduced fractions are reduced)
+   It returns the result (not exact if it does not fit), and receives the fraction, the exponent and the value of the power as a double */
+static Rational Rational_power_integer(Rational a, int64_t exponent, double value){
+
+  uint64_t magnitude = exponent < 0 ? -(uint64_t) exponent : (uint64_t) exponent;
+  int64_t num, den;
+
+  if(exponent < 0){
+    if(a.num == 0)
+      return Rational_inexact(value);
+    int64_t t = a.num;
+    a.num = a.den;
+    a.den = t;
+    if(a.den < 0){
+      if(a.den == INT64_MIN)
+        return Rational_inexact(value);
+      a.num = -a.num;
+      a.den = -a.den;
+    }
+  }
+
+  if(!Rational_integer_power(a.num, magnitude, &num) || !Rational_integer_power(a.den, magnitude, &den))
+    return Rational_inexact(value);
+
+  return Rational_make(num, den);
+}
+
+Rational Rational_pow(Rational a, Rational b){
+
+  double value = pow(Rational_to_double(a), Rational_to_double(b));
+  if(!a.exact || !b.exact)
+    return Rational_inexact(value);
+
+  a = Rational_reduce(a);
+  b = Rational_reduce(b);
+
+  if(b.den == 1)
+    return Rational_power_integer(a, b.num, value);
+
+  // a^(p/q) is the q-th root of a raised to p, exact when the numerator and the denominator of a are q-th powers
+  // Negative bases have no real root here, even for odd q (NAN, like pow in the double evaluation)
+  Rational root = {true, 0, 1, 0.0};
+  if(a.num < 0 || !Rational_integer_root(a.num, (uint64_t) b.den, &root.num) ||
+     !Rational_integer_root(a.den, (uint64_t) b.den, &root.den))
+    return Rational_inexact(value);
+
+  return Rational_power_integer(root, b.num, value);
+}
+
+Rational Rational_sqrt(Rational a){
+
+  if(!a.exact || a.num < 0)
+    return Rational_inexact(sqrt(Rational_to_double(a)));
+
+  a = Rational_reduce(a);
+  Rational root = {true, 0, 1, 0.0};
+  if(Rational_integer_root(a.num, 2, &root.num) && Rational_integer_root(a.den, 2, &root.den))
+    return root;
+
+  return Rational_inexact(sqrt(Rational_to_double(a)));
+}
+
+// ------------------------------------------------ Evaluation ------------------------------------------------
+
+/* Function to evaluate the bytecode with rationals
+   The bytecode must not be optimized (the optimizer folds constants as doubles) and must not have variables
+   It returns false if the bytecode has variables or memory allocation failed
+   It receives a reference to the bytecode, its constant pool as rationals and where the result is written */
+bool Rational_evaluate(const Bytecode *bytecode, const Rational *constants, Rational *result){
+
+  if(bytecode->variable_count > 0)
+    return false;
+
+  // The empty expression is 0, like in the double evaluation
+  if(bytecode->size == 0){
+    *result = Rational_make(0, 1);
+    return true;
+  }
+
+  Rational *stack = malloc(bytecode->max_depth * sizeof(Rational));
+  if(!stack)
+    return false;
+
+  unsigned int top = 0;
+
+  for(unsigned int i=0; i<bytecode->size; i++){
+
+    const Instruction *instruction = &bytecode->code[i];
+    Rational *a = top >= 2 ? &stack[top-2] : NULL;
+    Rational *b = top >= 1 ? &stack[top-1] : NULL;
+
+    switch(instruction->op){
+      case OP_CONST: stack[top++] = constants[instruction->arg]; continue;
+      case OP_DUP:   stack[top] = *b; top++; continue;
+      case OP_NEG:   *b = b->exact ? Rational_sub(Rational_make(0, 1), *b) : Rational_inexact(-b->value); continue;
+      case OP_SQRT:  *b = Rational_sqrt(*b); continue;
+      case OP_ADD:   *a = Rational_add(*a, *b); break;
+      case OP_SUB:   *a = Rational_sub(*a, *b); break;
+      case OP_MUL:   *a = Rational_mul(*a, *b); break;
+      case OP_DIV:   *a = Rational_div(*a, *b); break;
+      case OP_MOD:   *a = Rational_mod(*a, *b); break;
+      case OP_POW:   *a = Rational_pow(*a, *b); break;
+      default:
+        free(stack);
+        return false;
+    }
+
+    top--;
+  }
+
+  *result = stack[0];
+  free(stack);
+  return true;
+}
@@ -0,0 +1,254 @@
+/* This program is part of the math interpreter, it is a thread pool used by the parallel batch evaluation.
+   The tasks of a run are split between the workers, and a worker that finishes its part steals half of the remaining tasks of another. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../include/threadpool.h"
+
+// Tasks that a worker still has to execute, [begin, end)
+typedef struct{
+
+  pthread_mutex_t lock;
+  size_t begin;
+  size_t end;
+} WorkerRange;
+
+struct ThreadPool{
+
+  unsigned int size;       // Number of workers (the threads + the thread that calls ThreadPool_run)
+  pthread_t *threads;      // Background threads, workers 1 to size-1
+  WorkerRange *ranges;     // Tasks of each worker
+
+  pthread_mutex_t lock;    // Protects the fields below
+  pthread_cond_t start;    // Signaled when a run starts (or the pool stops)
+  pthread_cond_t done;     // Signaled when a worker finishes its part of the run
+  unsigned long generation; // Incremented at each run, so the threads know there is new work
+  unsigned int running;    // Number of background threads still working in the current run
+  bool stop;               // True when the pool is being destroyed
+
+  ThreadTask task;         // Function of the current run
+  void *context;           // Context of the current run
+};
+
+// Argument of each background thread
+typedef struct{
+
+  ThreadPool *pool;
+  unsigned int worker;
+} WorkerArgs;
+
+/* Function to take the next task of a worker, stealing from the others if it has no more tasks
+   It returns true if a task was taken
+   It receives a reference to the pool, the index of the worker and a reference to where the index of the task is written */
+static bool ThreadPool_next_task(ThreadPool *pool, unsigned int worker, size_t *task){
+
+  WorkerRange *own = &pool->ranges[worker];
+
+  pthread_mutex_lock(&own->lock);
+  if(own->begin < own->end){
+
+    *task = own->begin++;
+    pthread_mutex_unlock(&own->lock);
+    return true;
+  }
+  pthread_mutex_unlock(&own->lock);
+
+  // Steal half of the remaining tasks of the first worker that has some
+  for(unsigned int i=1; i<pool->size; i++){
+
+    WorkerRange *victim = &pool->ranges[(worker+i) % pool->size];
+
+    pthread_mutex_lock(&victim->lock);
+    size_t remaining = victim->end - victim->begin;
+
+    if(victim->begin >= victim->end){
+      pthread_mutex_unlock(&victim->lock);
+      continue;
+    }
+
+    size_t middle = victim->end - (remaining+1)/2; // The thief takes the tasks at the end
+    size_t stolen_end = victim->end;
+    victim->end = middle;
+    pthread_mutex_unlock(&victim->lock);
+
+    *task = middle;
+
+    pthread_mutex_lock(&own->lock);
+    own->begin = middle+1;
+    own->end = stolen_end;
+    pthread_mutex_unlock(&own->lock);
+
+    return true;
+  }
+
+  return false;
+}
+
+/* Function to execute tasks until there is no task left in any worker
+   It receives a reference to the pool and the index of the worker */
+static void ThreadPool_work(ThreadPool *pool, unsigned int worker){
+
+  size_t task;
+
+  while(ThreadPool_next_task(pool, worker, &task))
+    pool->task(pool->context, worker, task);
+}
+
+/* Function executed by the background threads, it waits for runs until the pool stops
+   It receives a reference to the arguments of the thread */
+static void *ThreadPool_thread(void *args){
+
+  WorkerArgs worker_args = *(WorkerArgs*) args;
+  free(args);
+
+  ThreadPool *pool = worker_args.pool;
+  unsigned long seen_generation = 0;
+
+  while(true){
+
+    pthread_mutex_lock(&pool->lock);
+    while(!pool->stop && pool->generation == seen_generation)
+      pthread_cond_wait(&pool->start, &pool->lock);
+
+    if(pool->stop){
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+
+    seen_generation = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    ThreadPool_work(pool, worker_args.worker);
+
+    pthread_mutex_lock(&pool->lock);
+    if(--pool->running == 0)
+      pthread_cond_signal(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+/* Function to create the pool and start its threads
+   It returns the pool or NULL if it could not be created
+   It receives the number of workers (0 to use one per CPU), the thread that calls ThreadPool_run is also one of the workers */
+ThreadPool *ThreadPool_create(unsigned int threads){
+
+  if(threads == 0){
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (unsigned int) cpus : 1;
+  }
+
+  ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+  if(!pool)
+    return NULL;
+
+  pool->threads = malloc(threads * sizeof(pthread_t));
+  pool->ranges = malloc(threads * sizeof(WorkerRange));
+  if(!pool->threads || !pool->ranges){
+
+    free(pool->threads);
+    free(pool->ranges);
+    free(pool);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  for(unsigned int i=0; i<threads; i++){
+
+    pthread_mutex_init(&pool->ranges[i].lock, NULL);
+    pool->ranges[i].begin = pool->ranges[i].end = 0;
+  }
+
+  // The worker 0 is the thread that calls ThreadPool_run
+  pool->size = 1;
+  for(unsigned int i=1; i<threads; i++){
+
+    WorkerArgs *args = malloc(sizeof(WorkerArgs));
+    if(!args)
+      break;
+
+    args->pool = pool;
+    args->worker = i;
+
+    if(pthread_create(&pool->threads[i], NULL, ThreadPool_thread, args) != 0){
+      free(args);
+      break;
+    }
+    pool->size++;
+  }
+
+  return pool;
+}
+
+/* Function to stop the threads and free the pool
+   It receives a reference to the pool (can be NULL) */
+void ThreadPool_destroy(ThreadPool *pool){
+
+  if(!pool)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  for(unsigned int i=1; i<pool->size; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  for(unsigned int i=0; i<pool->size; i++)
+    pthread_mutex_destroy(&pool->ranges[i].lock);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->start);
+  pthread_cond_destroy(&pool->done);
+
+  free(pool->threads);
+  free(pool->ranges);
+  free(pool);
+}
+
+/* Function to return the number of workers of the pool
+   It receives a reference to the pool */
+unsigned int ThreadPool_size(const ThreadPool *pool){
+
+  return pool->size;
+}
+
+/* Function to execute the tasks 0 to task_count-1 in the workers of the pool, it only returns when all of them are done
+   Each worker starts with a contiguous part of the tasks, so the tasks of a worker are usually next to each other
+   It can not be called by more than one thread at the same time for the same pool
+   It receives a reference to the pool, the number of tasks, the function to execute and the context passed to it */
+void ThreadPool_run(ThreadPool *pool, size_t task_count, ThreadTask task, void *context){
+
+  // Split the tasks in equal parts
+  for(unsigned int i=0; i<pool->size; i++){
+
+    pthread_mutex_lock(&pool->ranges[i].lock);
+    pool->ranges[i].begin = task_count * i / pool->size;
+    pool->ranges[i].end = task_count * (i+1) / pool->size;
+    pthread_mutex_unlock(&pool->ranges[i].lock);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->task = task;
+  pool->context = context;
+  pool->running = pool->size-1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  ThreadPool_work(pool, 0);
+
+  // Wait for the background threads
+  pthread_mutex_lock(&pool->lock);
+  while(pool->running > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -3,8 +3,15 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "../include/math_interpreter.h"
+#include "../include/kernels.h"
+#include "../include/format.h"
+#include "../include/number.h"
+#include "../include/codegen.h"
+#include "../include/incremental.h"
 
 typedef struct{
 
@@ -44,6 +51,51 @@ bool is_result_correct(double expected_res, double real_res, bool expected_err,
     return false;
 }
 
+/* Function executed by each thread of the context test, it evaluates many expressions with its own context
+   It returns NULL and receives a reference to the number of wrong results */
+void *context_thread(void *wrong){
+
+  MathConfig config = {4096, 64}; // Small limits, so the cache evicts and the scratch memory grows
+  MathContext *context = Math_context_create(&config);
+  if(!context){
+    (*(int*)wrong)++;
+    return NULL;
+  }
+
+  for(int i=0; i<2000; i++){
+
+    char expression[64];
+    snprintf(expression, sizeof(expression), "(%d+1)*2-sqrt(16)", i%100);
+
+    bool error = false;
+    double result = Math_context_evaluate(context, expression, &error, NULL);
+    if(error || result != ((i%100)+1)*2-4)
+      (*(int*)wrong)++;
+  }
+
+  Math_context_destroy(context);
+  return NULL;
+}
+
+/* Tokens received from a streaming lexer */
+typedef struct{
+
+  Token tokens[64];
+  size_t count;
+} StreamTokens;
+
+/* Function that receives the tokens of the streaming lexer test
+   It returns false when there is no space for more tokens, and receives the tokens received and the new token */
+bool stream_sink(void *context, const Token *token){
+
+  StreamTokens *received = context;
+  if(received->count == sizeof(received->tokens)/sizeof(received->tokens[0]))
+    return false;
+
+  received->tokens[received->count++] = *token;
+  return true;
+}
+
 int main(){
 
   Test to_test[] = {
@@ -60,16 +112,31 @@ int main(){
                     // Unary
                     {"-2.2(.5+1.5)"    ,  -4.4, false},
                     {"2^-3"            , 0.125, false},
+                    {"(-2)^5+2^10"     ,   992, false},
                     // Functions
                     {"2sqrt(9)2"       ,    12, false},
                     {"-2*(sqrt(6+3)/2)",  -3.0, false},
                     {"sqrt(-2)"        ,   NAN, false},
                     // Mod
                     {"5%2"             ,   1.0, false},
+                    {"7.5%2"           ,   1.5, false},
+                    {"-7%3"            ,  -1.0, false},
+                    {"2^40%7"          ,   2.0, false},
+                    {"123456789*987654321%1000", 269.0, false},
+                    {"5%0"             ,   NAN, false},
                     // Syntax errors
                     {"."               ,   0.0,  true},
                     {"5%"              ,   0.0,  true},
                     {"(1+2"            ,   0.0,  true},
+                    {"1.5.2"           ,   0.0,  true},
+                    {"abc(1)"          ,   0.0,  true},
+                    {"2x"              ,   0.0,  true},
+                    {"1e5.5"           ,   0.0,  true},
+                    // Number notations
+                    {"1e-9*1e9"        ,   1.0, false},
+                    {"2.5E+2"          , 250.0, false},
+                    {"1_000+0x10"      ,1016.0, false},
+                    {"0x1.8p1"         ,   3.0, false},
                     // NULL
                     {NULL              ,   0.0,  true}
                   };
@@ -95,6 +162,765 @@ int main(){
 
   }
 
+  // Compiled expressions: compile once, evaluate many times
+  CompiledExpr *compiled = Math_compile("2sqrt(9)2", NULL);
+  if(!compiled){
+
+    fprintf(stderr, "\nCompile test failed. Expression was not compiled\n");
+    fail++;
+  }
+  else{
+
+    for(int i=0; i<3; i++){
+
+      double result = Math_eval(compiled);
+      if(!is_result_correct(12.0, result, false, false)){
+
+        fprintf(stderr, "\nCompile test failed. Output: %lf; Expected output: %lf\n", result, 12.0);
+        fail++;
+      }
+    }
+    Math_free_compiled(compiled);
+  }
+
+  // Syntax errors are reported with their kind and position
+  struct{ char *expression; ParseErrorKind kind; unsigned int position; } errors[] = {
+                    {"(1+2"   , PARSE_UNMATCHED_OPEN_PAREN , 0},
+                    {"1+2)"   , PARSE_UNMATCHED_CLOSE_PAREN, 3},
+                    {"5%"     , PARSE_MISSING_OPERAND      , 2},
+                    {"2*(+3)" , PARSE_MISSING_OPERAND      , 3},
+                    {"2 3"    , PARSE_MISSING_OPERATOR     , 2},
+                    {"1+1.5.2", PARSE_INVALID_TOKEN        , 2},
+                    {"2+sqrt4", PARSE_MISSING_OPEN_PAREN   , 6},
+                    {"---1"   , PARSE_MISSING_OPERAND      , 0}
+                  };
+
+  for(unsigned int i=0; i<sizeof(errors)/sizeof(errors[0]); i++){
+
+    ParseError error;
+    compiled = Math_compile(errors[i].expression, &error);
+
+    if(compiled || error.kind != errors[i].kind || error.position != errors[i].position){
+
+      fprintf(stderr, "\nCompile test failed (%s). Error: %s at %u; Expected error: %s at %u\n", errors[i].expression,
+              Parser_error_message(error.kind), error.position, Parser_error_message(errors[i].kind), errors[i].position);
+      Math_free_compiled(compiled);
+      fail++;
+    }
+  }
+
+  // Batch evaluation with variables bound to columns (more rows than one block)
+  enum { BATCH_ROWS = 1000 };
+  static double a[BATCH_ROWS], b[BATCH_ROWS], c[BATCH_ROWS], x[BATCH_ROWS], out[BATCH_ROWS];
+
+  for(int i=0; i<BATCH_ROWS; i++){
+    a[i] = i%7;
+    b[i] = -i;
+    c[i] = 0.5*i;
+    x[i] = i/4.0;
+  }
+
+  MathBinding bindings[] = {{"a", a}, {"b", b}, {"c", c}, {"x", x}, {NULL, NULL}};
+
+  compiled = Math_compile("a*x^2+b*x+c", NULL);
+  if(!compiled || !Math_eval_batch(compiled, bindings, BATCH_ROWS, out)){
+
+    fprintf(stderr, "\nBatch test failed. Expression was not evaluated\n");
+    fail++;
+  }
+  else{
+
+    for(int i=0; i<BATCH_ROWS; i++){
+
+      double expected = a[i]*pow(x[i], 2)+b[i]*x[i]+c[i];
+      if(!is_result_correct(expected, out[i], false, false)){
+
+        fprintf(stderr, "\nBatch test failed at row %d. Output: %lf; Expected output: %lf\n", i, out[i], expected);
+        fail++;
+        break;
+      }
+    }
+  }
+  Math_free_compiled(compiled);
+
+  // Integer powers become chains of multiplications (exact for these small integers)
+  compiled = Math_compile("a^13-a^6+a^3", NULL);
+  if(!compiled || !Math_eval_batch(compiled, bindings, BATCH_ROWS, out)){
+
+    fprintf(stderr, "\nPower chain test failed. Expression was not evaluated\n");
+    fail++;
+  }
+  else{
+
+    for(int i=0; i<BATCH_ROWS; i++){
+
+      double expected = pow(a[i], 13)-pow(a[i], 6)+pow(a[i], 3);
+      if(!is_result_correct(expected, out[i], false, false)){
+
+        fprintf(stderr, "\nPower chain test failed at row %d. Output: %lf; Expected output: %lf\n", i, out[i], expected);
+        fail++;
+        break;
+      }
+    }
+  }
+  Math_free_compiled(compiled);
+
+  // Native code (where there is a JIT) must give the same output as the interpreter, also for NAN, division by 0 and calls to pow and fmod
+  const char *native_expressions[] = {"a*x^2+b*x+c", "sqrt(b)/a-(-x)", "x%a+c^x/(a-3)", "((a+1)*(b+2)*(c+3)*(x+4))^-2", NULL};
+  static double native_out[BATCH_ROWS];
+
+  for(int i=0; native_expressions[i]!=NULL; i++){
+
+    CompiledExpr *interpreted = Math_compile(native_expressions[i], NULL);
+    CompiledExpr *native = Math_compile_native(native_expressions[i], NULL);
+
+    if(!interpreted || !native || !Math_eval_batch(interpreted, bindings, BATCH_ROWS, out) || !Math_eval_batch(native, bindings, BATCH_ROWS, native_out)){
+
+      fprintf(stderr, "\nNative test failed for %s. Expression was not evaluated\n", native_expressions[i]);
+      fail++;
+    }
+    else{
+
+      for(int j=0; j<BATCH_ROWS; j++){
+
+        if(!is_result_correct(out[j], native_out[j], false, false)){
+
+          fprintf(stderr, "\nNative test failed for %s at row %d. Output: %lf; Expected output: %lf\n", native_expressions[i], j, native_out[j], out[j]);
+          fail++;
+          break;
+        }
+      }
+    }
+
+    Math_free_compiled(interpreted);
+    Math_free_compiled(native);
+  }
+
+  // Generated C code: one constant per instruction, the same helpers as the interpreter
+  compiled = Math_compile("x^2+1", NULL);
+  FILE *generated = tmpfile();
+  char generated_text[4096] = "";
+
+  if(compiled && generated && Codegen_write_prelude(generated) && Codegen_write_function(generated, &compiled->bytecode, "square_plus_one", "x^2+1")){
+    rewind(generated);
+    generated_text[fread(generated_text, 1, sizeof(generated_text)-1, generated)] = '\0';
+  }
+
+  const char *generated_lines[] = {"static double math_div(double a, double b)", "const char *const square_plus_one_variables[] = {\"x\", NULL};",
+                                   "const double t2 = t0 * t1;", "return t4;", "out[i] = square_plus_one(variables);", NULL};
+  for(int i=0; generated_lines[i]!=NULL; i++){
+
+    if(!strstr(generated_text, generated_lines[i])){
+      fprintf(stderr, "\nCode generation test failed. Missing line: %s\n", generated_lines[i]);
+      fail++;
+    }
+  }
+
+  if(!Codegen_is_name("rate_2") || Codegen_is_name("2rate") || Codegen_is_name("math_pow") || Codegen_is_name("a-b") ||
+     Codegen_is_name("sqrt") || Codegen_is_name("int") || Codegen_is_name("sinf") || Codegen_is_name("NAN") || Codegen_is_name("rows") || Codegen_is_name("main") ||
+     !Codegen_is_name("sqrt2") || !Codegen_is_name("integral")){
+    fprintf(stderr, "\nCode generation test failed. Wrong function names\n");
+    fail++;
+  }
+
+  if(generated)
+    fclose(generated);
+  Math_free_compiled(compiled);
+
+  // Parallel batch evaluation must give the same output as the serial one
+  enum { PARALLEL_ROWS = 100003 };
+  double *px = malloc(PARALLEL_ROWS * sizeof(double));
+  double *serial_out = malloc(PARALLEL_ROWS * sizeof(double));
+  double *parallel_out = malloc(PARALLEL_ROWS * sizeof(double));
+  ThreadPool *pool = ThreadPool_create(4);
+
+  for(int i=0; i<PARALLEL_ROWS; i++)
+    px[i] = (i%1000)/7.0 - 50;
+
+  MathBinding parallel_bindings[] = {{"x", px}, {NULL, NULL}};
+  compiled = Math_compile("sqrt(x)*x^2-3/(x+2)", NULL);
+
+  if(!compiled || !pool || !Math_eval_batch(compiled, parallel_bindings, PARALLEL_ROWS, serial_out)
+     || !Math_eval_batch_parallel(compiled, parallel_bindings, PARALLEL_ROWS, parallel_out, pool)){
+
+    fprintf(stderr, "\nParallel batch test failed. Expression was not evaluated\n");
+    fail++;
+  }
+  else{
+
+    for(int i=0; i<PARALLEL_ROWS; i++){
+
+      if(!is_result_correct(serial_out[i], parallel_out[i], false, false)){
+
+        fprintf(stderr, "\nParallel batch test failed at row %d. Output: %lf; Expected output: %lf\n", i, parallel_out[i], serial_out[i]);
+        fail++;
+        break;
+      }
+    }
+  }
+  Math_free_compiled(compiled);
+  ThreadPool_destroy(pool);
+  free(px);
+  free(serial_out);
+  free(parallel_out);
+
+  // Optimized bytecode: constant subtrees are folded and identities removed, without changing the results
+  compiled = Math_compile("2*sqrt(9)*x", NULL);
+  if(!compiled || compiled->bytecode.size != 3){
+
+    fprintf(stderr, "\nOptimization test failed. Constant subtree was not folded\n");
+    fail++;
+  }
+  Math_free_compiled(compiled);
+
+  compiled = Math_compile("-(-x^2)*1+0-x^0.5/1+x^1+(1/0)*0", NULL);
+  if(!compiled || !Math_eval_batch(compiled, bindings, BATCH_ROWS, out)){
+
+    fprintf(stderr, "\nOptimization test failed. Expression was not evaluated\n");
+    fail++;
+  }
+  else{
+
+    for(int i=0; i<BATCH_ROWS; i++){
+
+      if(!is_result_correct(NAN, out[i], false, false)){
+
+        fprintf(stderr, "\nOptimization test failed at row %d. Output: %lf; Expected output: %lf\n", i, out[i], NAN);
+        fail++;
+        break;
+      }
+    }
+  }
+  Math_free_compiled(compiled);
+
+  compiled = Math_compile("-(-x^2)*1+0-x^0.5/1+x^1", NULL);
+  if(!compiled || !Math_eval_batch(compiled, bindings, BATCH_ROWS, out)){
+
+    fprintf(stderr, "\nOptimization test failed. Expression was not evaluated\n");
+    fail++;
+  }
+  else{
+
+    for(int i=0; i<BATCH_ROWS; i++){
+
+      double expected = -pow(-x[i], 2)-sqrt(x[i])+x[i];
+      if(!is_result_correct(expected, out[i], false, false)){
+
+        fprintf(stderr, "\nOptimization test failed at row %d. Output: %lf; Expected output: %lf\n", i, out[i], expected);
+        fail++;
+        break;
+      }
+    }
+  }
+  Math_free_compiled(compiled);
+
+  // Variable without binding
+  MathBinding missing[] = {{"x", x}, {NULL, NULL}};
+  compiled = Math_compile("2x+y", NULL);
+  if(!compiled || Math_eval_batch(compiled, missing, BATCH_ROWS, out)){
+
+    fprintf(stderr, "\nBatch test failed. Variable without binding was accepted\n");
+    fail++;
+  }
+  Math_free_compiled(compiled);
+
+  // SIMD kernels of every instruction set supported by this CPU must match the scalar ones (including the NAN cases)
+  const KernelTable *scalar = Kernels_table(KERNELS_SCALAR);
+  enum { KERNEL_ROWS = 37 };
+  double ka[KERNEL_ROWS], kb[KERNEL_ROWS], expected_out[KERNEL_ROWS], kernel_out[KERNEL_ROWS];
+
+  for(int i=0; i<KERNEL_ROWS; i++){
+    ka[i] = (i%5==0) ? -0.0 : (i-18)*1.25;
+    kb[i] = (i%3==0) ? 0.0 : (i%4)-1.5;
+  }
+
+  for(int isa=0; isa<KERNELS_TOTAL; isa++){
+
+    const KernelTable *kernels = Kernels_table(isa);
+    if(!kernels)
+      continue;
+
+    UnaryKernel unary[][2] = {{scalar->neg, kernels->neg}, {scalar->sqrt, kernels->sqrt}};
+    BinaryKernel binary[][2] = {{scalar->add, kernels->add}, {scalar->sub, kernels->sub}, {scalar->mul, kernels->mul}, {scalar->div, kernels->div}};
+
+    for(int k=0; k<2+4; k++){
+
+      if(k<2){
+        unary[k][0](expected_out, ka, KERNEL_ROWS);
+        unary[k][1](kernel_out, ka, KERNEL_ROWS);
+      }
+      else{
+        binary[k-2][0](expected_out, ka, kb, KERNEL_ROWS);
+        binary[k-2][1](kernel_out, ka, kb, KERNEL_ROWS);
+      }
+
+      for(int i=0; i<KERNEL_ROWS; i++){
+
+        bool same = isnan(expected_out[i]) ? isnan(kernel_out[i]) : memcmp(&expected_out[i], &kernel_out[i], sizeof(double))==0;
+        if(!same){
+
+          fprintf(stderr, "\nKernel test failed (%s, kernel %d, row %d). Output: %lf; Expected output: %lf\n", kernels->name, k, i, kernel_out[i], expected_out[i]);
+          fail++;
+          break;
+        }
+      }
+    }
+  }
+
+  // Expression cache: expressions that only differ in spaces share the same entry, entries are evicted to respect the memory limit
+  MathCacheStats stats, previous;
+  Math_cache_clear();
+  Math_cache_stats(&previous);
+
+  bool cache_error = false;
+  double cached = Math_interpreter_evaluate_expression("2 + 3*x", &cache_error);
+  cache_error = false;
+  cached = Math_interpreter_evaluate_expression("2+3 * 4", &cache_error) + Math_interpreter_evaluate_expression("2 +3*4", &cache_error);
+
+  CompiledExpr *first = Math_cache_compile("2 3", NULL);
+  ParseError cache_parse_error;
+  CompiledExpr *second = Math_cache_compile("2  3", &cache_parse_error);
+  Math_cache_stats(&stats);
+
+  if(cache_error || cached != 28.0 || first || second || cache_parse_error.kind != PARSE_MISSING_OPERATOR || cache_parse_error.position != 3 ||
+     stats.hits - previous.hits != 2 || stats.misses - previous.misses != 3 || stats.entries != 3){
+
+    fprintf(stderr, "\nCache test failed. Output: %lf; Hits: %lu; Misses: %lu; Entries: %zu\n", cached,
+            stats.hits - previous.hits, stats.misses - previous.misses, stats.entries);
+    fail++;
+  }
+
+  first = Math_cache_compile("x^2+1", NULL);
+  second = Math_cache_compile("x ^ 2 + 1", NULL);
+  if(!first || first != second){
+
+    fprintf(stderr, "\nCache test failed. Compiled expression was not shared\n");
+    fail++;
+  }
+  Math_free_compiled(first);
+  Math_free_compiled(second);
+
+  Math_cache_set_limit(stats.bytes);
+  for(int i=0; i<50; i++){
+
+    char expression[32];
+    snprintf(expression, sizeof(expression), "%d+%d", i, i);
+    Math_free_compiled(Math_cache_compile(expression, NULL));
+  }
+  Math_cache_stats(&stats);
+
+  if(stats.bytes > stats.max_bytes || stats.evictions == previous.evictions){
+
+    fprintf(stderr, "\nCache test failed. Memory limit was not respected. Bytes: %zu; Limit: %zu\n", stats.bytes, stats.max_bytes);
+    fail++;
+  }
+  Math_cache_clear();
+
+  // Expressions whose spaces separate the chars of a number do not share the entry, in any order
+  const char *unshared[][2] = {{"1_000", "1 _000"}, {"1e+3", "1e +3"}, {"1e+3", "1e+ 3"}, {"2 3", "23"}};
+
+  for(unsigned int i=0; i<2*sizeof(unshared)/sizeof(unshared[0]); i++){
+
+    Math_cache_clear();
+
+    for(unsigned int j=0; j<2; j++){
+
+      const char *expression = unshared[i/2][(i+j)%2];
+      bool error = false, expected_error = false;
+      double result = Math_interpreter_evaluate_expression((char *) expression, &error);
+
+      CompiledExpr *compiled = Math_compile(expression, NULL);
+      double expected = compiled && Math_variable_count(compiled) == 0 ? Math_eval(compiled) : 0.0;
+      expected_error = !compiled || Math_variable_count(compiled) > 0;
+      Math_free_compiled(compiled);
+
+      if(!is_result_correct(expected, result, expected_error, error)){
+        fprintf(stderr, "\nCache test failed for %s. Output: %lf; Expected output: %lf\n", expression, result, expected);
+        fail++;
+      }
+    }
+  }
+  Math_cache_clear();
+
+  // Contexts: each thread evaluates with its own context, with nothing shared
+  enum { CONTEXT_THREADS = 4 };
+  pthread_t threads[CONTEXT_THREADS];
+  int wrong[CONTEXT_THREADS] = {0};
+
+  for(int i=0; i<CONTEXT_THREADS; i++)
+    pthread_create(&threads[i], NULL, context_thread, &wrong[i]);
+
+  for(int i=0; i<CONTEXT_THREADS; i++){
+
+    pthread_join(threads[i], NULL);
+    if(wrong[i]){
+      fprintf(stderr, "\nContext test failed. Thread %d had %d wrong result(s)\n", i, wrong[i]);
+      fail++;
+    }
+  }
+
+  MathContext *context = Math_context_create(NULL);
+  ParseError context_error;
+  bool context_flag = false;
+  Math_context_evaluate(context, "2*(3", &context_flag, &context_error);
+
+  if(!context_flag || context_error.kind != PARSE_UNMATCHED_OPEN_PAREN || context_error.position != 2){
+
+    fprintf(stderr, "\nContext test failed. Syntax error was not reported\n");
+    fail++;
+  }
+  Math_context_destroy(context);
+
+  // Token queue: dequeues and enqueues wrap around the circular buffer, the array keeps the order
+  TokenQueue queue;
+  Queue_init(&queue, NULL);
+  unsigned int next_in = 0, next_out = 0;
+  bool queue_ok = true;
+
+  for(int round=0; round<100; round++){
+
+    for(int i=0; i<round%7+1; i++){
+      Token tok = {TOK_NUMBER, next_in++, 1, 0.0};
+      Queue_enqueue(&queue, tok);
+    }
+    for(int i=0; i<round%5 && !Queue_is_empty(&queue); i++)
+      queue_ok = queue_ok && Queue_dequeue(&queue).offset == next_out++;
+  }
+
+  Token *queue_array = Queue_to_array(&queue);
+  for(unsigned int i=0; queue_ok && next_out+i<next_in; i++)
+    queue_ok = queue_array[i].offset == next_out+i;
+
+  if(!queue_ok || queue_array[next_in-next_out].kind != TOK_END || !Queue_is_empty(&queue)){
+
+    fprintf(stderr, "\nQueue test failed. Tokens are out of order\n");
+    fail++;
+  }
+  free(queue_array);
+  Queue_free(&queue);
+
+  // Deep expression: the stacks spill out of their inline storage
+  char deep_expression[512] = "";
+  for(int i=0; i<STACK_INLINE_SIZE+8; i++)
+    strcat(deep_expression, "2-(");
+  strcat(deep_expression, "1");
+  for(int i=0; i<STACK_INLINE_SIZE+8; i++)
+    strcat(deep_expression, ")");
+
+  bool deep_error = false;
+  double deep_result = Math_interpreter_evaluate_expression(deep_expression, &deep_error);
+  if(!is_result_correct(1.0, deep_result, false, deep_error)){
+
+    fprintf(stderr, "\nDeep expression test failed. Output: %lf; Expected output: %lf\n", deep_result, 1.0);
+    fail++;
+  }
+
+  // Formatter: shortest text, and every double reads back as itself
+  struct{ double value; char *text; } formats[] = {
+                    {0.1          , "0.1"},
+                    {-0.0         , "-0"},
+                    {123.25       , "123.25"},
+                    {0.001        , "0.001"},
+                    {1e-5         , "1e-05"},
+                    {1e16         , "10000000000000000"},
+                    {1e21         , "1e+21"},
+                    {1e23         , "1e+23"},
+                    {0x1p-24      , "5.960464477539063e-08"},
+                    {1.0/3        , "0.3333333333333333"},
+                    {5e-324       , "5e-324"},
+                    {1.7976931348623157e308, "1.7976931348623157e+308"},
+                    {NAN          , "nan"},
+                    {-INFINITY    , "-inf"}
+                  };
+
+  char text[FORMAT_DOUBLE_SIZE];
+  for(unsigned int i=0; i<sizeof(formats)/sizeof(formats[0]); i++){
+
+    Format_double(formats[i].value, text);
+    if(strcmp(text, formats[i].text) != 0){
+
+      fprintf(stderr, "\nFormat test failed. Output: %s; Expected output: %s\n", text, formats[i].text);
+      fail++;
+    }
+  }
+
+  srand(42);
+  for(int i=0; i<100000; i++){
+
+    uint64_t bits = ((uint64_t) rand() << 42) ^ ((uint64_t) rand() << 21) ^ (uint64_t) rand() ^ ((uint64_t) rand() << 62);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if(isnan(value))
+      continue;
+
+    Format_double(value, text);
+    double read_back = strtod(text, NULL);
+    if(memcmp(&value, &read_back, sizeof(value)) != 0){
+
+      fprintf(stderr, "\nFormat test failed. Output: %s; Expected output: %.17g\n", text, value);
+      fail++;
+      break;
+    }
+
+    // The nearest number with one digit less does not read back as the double (the zeros at the ends are not counted)
+    int digit_count = 0, significant_count = 0;
+    for(const char *c = text; *c && *c != 'e'; c++){
+      if(*c >= '0' && *c <= '9' && (digit_count || *c != '0')){
+        digit_count++;
+        if(*c != '0')
+          significant_count = digit_count;
+      }
+    }
+
+    if(significant_count > 1){
+
+      char shorter[FORMAT_DOUBLE_SIZE + 8];
+      snprintf(shorter, sizeof(shorter), "%.*e", significant_count - 2, value);
+      read_back = strtod(shorter, NULL);
+      if(memcmp(&value, &read_back, sizeof(value)) == 0){
+
+        fprintf(stderr, "\nFormat test failed. Output: %s; Expected output: %s\n", text, shorter);
+        fail++;
+        break;
+      }
+    }
+  }
+
+  double bulk_values[] = {1.5, -2, 1e100};
+  char bulk_text[3*FORMAT_DOUBLE_SIZE+1];
+  size_t bulk_length = Format_doubles(bulk_values, 3, '\n', bulk_text);
+  if(strcmp(bulk_text, "1.5\n-2\n1e+100\n") != 0 || bulk_length != strlen(bulk_text)){
+
+    fprintf(stderr, "\nFormat test failed. Output: %s\n", bulk_text);
+    fail++;
+  }
+
+  // Incremental evaluation: after each typed or erased char the result is the one of the whole text
+  const char *typed = "-(2.5e+1-3)*sqrt(16)^2%7+1_0/4(2)";
+  IncrementalExpr incremental;
+  Incremental_init(&incremental);
+
+  for(size_t i=0; i<2*strlen(typed); i++){
+
+    if(i < strlen(typed))
+      Incremental_append(&incremental, &typed[i], 1);
+    else
+      Incremental_remove(&incremental, 1);
+
+    bool error = false;
+    double expected = Math_interpreter_evaluate_expression((char *) Incremental_text(&incremental), &error);
+    double result = 0.0;
+    bool ok = Incremental_result(&incremental, &result, NULL);
+
+    if(ok == error || (ok && result != expected)){
+      fprintf(stderr, "\nIncremental test failed for %s. Output: %lf; Expected output: %lf\n", Incremental_text(&incremental), result, expected);
+      fail++;
+    }
+  }
+  Incremental_free(&incremental);
+
+  // Streaming lexer: numbers, exponents and names split between chunks give the same tokens as the whole expression
+  const char *streamed = "2x+1.5e-3*sqrt(0x1.8p1)(rate)-1_000%.5";
+  Token *whole = Lexer_tokenize(streamed, NULL);
+  size_t streamed_length = strlen(streamed);
+
+  for(size_t chunk=1; whole && chunk<=streamed_length; chunk++){
+
+    StreamTokens received = {.count = 0};
+    LexerStream stream;
+    Lexer_stream_init(&stream, stream_sink, &received);
+
+    bool ok = true;
+    for(size_t i=0; ok && i<streamed_length; i+=chunk)
+      ok = Lexer_stream_feed(&stream, &streamed[i], streamed_length-i < chunk ? streamed_length-i : chunk);
+    ok = ok && Lexer_stream_finish(&stream);
+    Lexer_stream_free(&stream);
+
+    for(size_t i=0; ok && i<received.count; i++){
+      ok = whole[i].kind == received.tokens[i].kind && whole[i].offset == received.tokens[i].offset &&
+           whole[i].length == received.tokens[i].length && whole[i].value == received.tokens[i].value;
+    }
+
+    if(!ok || received.tokens[received.count-1].kind != TOK_END || whole[received.count-1].kind != TOK_END){
+      fprintf(stderr, "\nStreaming lexer test failed with chunks of %zu chars\n", chunk);
+      fail++;
+    }
+  }
+  free(whole);
+
+  // Number parser: correctly rounded like strtod, separators, hex floats and partial reads
+  struct{ char *text; size_t used; double value; } numbers[] = {
+                    {"0.1"                      ,  3, 0.1},
+                    {"1e-9"                     ,  4, 1e-9},
+                    {"2e"                       ,  1, 2.0},
+                    {"2e+x"                     ,  1, 2.0},
+                    {"1_000_000"                ,  9, 1e6},
+                    {"1__0"                     ,  1, 1.0},
+                    {"5."                       ,  1, 5.0},
+                    {"0xff"                     ,  4, 255.0},
+                    {"0x1.8p-1"                 ,  8, 0.75},
+                    {"0x"                       ,  1, 0.0},
+                    {"2.2250738585072011e-308"  , 23, 2.2250738585072011e-308},
+                    {"4.9406564584124654e-324"  , 23, 4.9406564584124654e-324},
+                    {"2.4703282292062328e-324"  , 23, 4.9406564584124654e-324},
+                    {"9007199254740993"         , 16, 9007199254740992.0},
+                    {"1.7976931348623158e308"   , 22, 1.7976931348623157e308},
+                    {"1e309"                    ,  5, INFINITY},
+                    {"0x1p-1075"                ,  9, 0.0},
+                    {"0x1.0000000000001p-1074"  , 23, 4.9406564584124654e-324},
+                    {"123456789012345678901234567890", 30, 1.2345678901234568e29},
+                    {"."                        ,  0, 0.0}
+                  };
+
+  for(unsigned int i=0; i<sizeof(numbers)/sizeof(numbers[0]); i++){
+
+    double value = 0.0;
+    size_t used = Number_parse(numbers[i].text, strlen(numbers[i].text), &value);
+    if(used != numbers[i].used || (used > 0 && value != numbers[i].value)){
+
+      fprintf(stderr, "\nNumber test failed for %s. Output: %.17g (%zu chars); Expected output: %.17g (%zu chars)\n", numbers[i].text, value, used, numbers[i].value, numbers[i].used);
+      fail++;
+    }
+  }
+
+  srand(7);
+  for(int i=0; i<100000; i++){
+
+    char number[64];
+    int length = 0;
+    int digits = 1 + rand()%25;
+    for(int j=0; j<digits; j++){
+      number[length++] = '0' + rand()%10;
+      if(j == digits/2 && j < digits-1 && rand()%2)
+        number[length++] = '.';
+    }
+    length += snprintf(&number[length], 16, "e%d", rand()%700 - 350);
+
+    double value = 0.0;
+    double expected = strtod(number, NULL);
+    if(Number_parse(number, length, &value) != (size_t) length || memcmp(&value, &expected, sizeof(value)) != 0){
+
+      fprintf(stderr, "\nNumber test failed for %s. Output: %.17g; Expected output: %.17g\n", number, value, expected);
+      fail++;
+      break;
+    }
+  }
+
+  // Arbitrary precision: exact decimals, many digits and the same special values as doubles
+  struct{ char *expression; unsigned int digits; char *text; } precise[] = {
+                    {".1*3"        , 50, "0.3"},
+                    {"2/3"         , 50, "0.66666666666666666666666666666666666666666666666667"},
+                    {"sqrt(2)"     , 50, "1.4142135623730950488016887242096980785696718753769"},
+                    {"2^100"       , 50, "1267650600228229401496703205376"},
+                    {"2^-3"        , 10, "0.125"},
+                    {"3^1.25"      , 40, "3.94822203885747738245765670539099716548"},
+                    {"-7.5%2"      , 10, "-1.5"},
+                    {"1e-30*3"     , 10, "3e-30"},
+                    {"2^200"       , 10, "1.606938044e+60"},
+                    {"1/0"         , 10, "nan"},
+                    {"sqrt(-1)"    , 10, "nan"},
+                    {"   "         , 10, "0"},
+                    {"x+1"         , 10, NULL}
+                  };
+
+  char precise_text[BIGNUM_TEXT_SIZE(50)];
+  for(unsigned int i=0; i<sizeof(precise)/sizeof(precise[0]); i++){
+
+    size_t written = Math_evaluate_precise(precise[i].expression, strlen(precise[i].expression), precise[i].digits, precise_text, NULL);
+    if(precise[i].text ? written == 0 || strcmp(precise_text, precise[i].text) != 0 : written != 0){
+
+      fprintf(stderr, "\nPrecise test failed for %s. Output: %s; Expected output: %s\n", precise[i].expression, written ? precise_text : "error", precise[i].text ? precise[i].text : "error");
+      fail++;
+    }
+  }
+
+  // (10^n - 1)^2 = 99..9800..01, big enough for the NTT multiplication
+  unsigned int nines = 50000;
+  char *square = malloc(nines + 8);
+  char *square_text = malloc(BIGNUM_TEXT_SIZE(2*nines));
+  char *square_expected = malloc(2*nines + 1);
+
+  if(square && square_text && square_expected){
+
+    square_text[0] = '\0';
+    memset(square_expected, '9', nines-1);
+    square_expected[nines-1] = '8';
+    memset(&square_expected[nines], '0', nines-1);
+    strcpy(&square_expected[2*nines-1], "1");
+
+    square[0] = '(';
+    memset(&square[1], '9', nines);
+    strcpy(&square[nines+1], ")^2");
+
+    Math_evaluate_precise(square, strlen(square), 2*nines, square_text, NULL);
+    if(strcmp(square_text, square_expected) != 0){
+      fprintf(stderr, "\nPrecise test failed for (10^%u-1)^2\n", nines);
+      fail++;
+    }
+  }
+
+  free(square);
+  free(square_text);
+  free(square_expected);
+
+  // Exact rationals: decimals and integer powers are exact, roots only when they are rational, the rest falls back to doubles
+  struct{ char *expression; char *text; } rational[] = {
+                    {".1*10"                   , "1"},
+                    {".1+.2-.3"                , "0"},
+                    {"1/3+1/6"                 , "1/2"},
+                    {"-7.5%2"                  , "-3/2"},
+                    {"(2/3)^-3"                , "27/8"},
+                    {"sqrt(9/4)"               , "3/2"},
+                    {"8^(2/3)"                 , "4"},
+                    {"(-27)^(1/3)"             , "nan"},
+                    {"1.5e-3*2"                , "3/1000"},
+                    {"0x1.8p1"                 , "3"},
+                    {"(1/7)^22*7^22"           , "1"},
+                    {"9223372036854775807+1"   , "9.223372036854776e+18"},
+                    {"sqrt(2)"                 , "1.4142135623730951"},
+                    {"2^0.5"                   , "1.4142135623730951"},
+                    {"1/0"                     , "nan"},
+                    {"   "                     , "0"},
+                    {"x+1"                     , NULL}
+                  };
+
+  char rational_text[RATIONAL_TEXT_SIZE];
+  for(unsigned int i=0; i<sizeof(rational)/sizeof(rational[0]); i++){
+
+    Rational value;
+    bool ok = Math_evaluate_rational(rational[i].expression, strlen(rational[i].expression), &value, NULL);
+    if(ok)
+      Rational_to_text(value, rational_text);
+
+    if(rational[i].text ? !ok || strcmp(rational_text, rational[i].text) != 0 : ok){
+
+      fprintf(stderr, "\nRational test failed for %s. Output: %s; Expected output: %s\n", rational[i].expression, ok ? rational_text : "error", rational[i].text ? rational[i].text : "error");
+      fail++;
+    }
+  }
+
+  // Same arena reused by many evaluations, the long expression does not fit in the first block
+  char long_expression[2048];
+  long_expression[0] = '\0';
+  for(int i=0; i<200; i++)
+    strcat(long_expression, "1+");
+  strcat(long_expression, "(2*3)");
+
+  Arena arena;
+  Arena_init(&arena, NULL, 0);
+
+  for(int i=0; i<3; i++){
+
+    bool error=false;
+    double result = Math_interpreter_evaluate_expression_arena(long_expression, &arena, &error);
+    if(!is_result_correct(206.0, result, false, error)){
+
+      fprintf(stderr, "\nArena test failed. Output: %lf; Expected output: %lf\n", result, 206.0);
+      fail++;
+    }
+  }
+  Arena_free(&arena);
+
   if(fail!=0){
 
     fprintf(stderr, "\n%d test(s) failed.\n", fail);